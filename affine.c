@@ -0,0 +1,357 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "affine.h"
+#include "geometrie.h"
+#include "parallele.h"
+
+/*
+ * Transformation par l'inverse : pour chaque pixel de sortie (i, j), la position source est
+ *   u = A i + B j + C,  v = D i + E j + F
+ * Le long d'une ligne, u et v avancent de A et D à chaque pixel ; ils sont tenus en virgule
+ * fixe 32.32 sur 64 bits, si bien que la boucle interne ne fait ni multiplication flottante
+ * ni conversion. L'intervalle de la ligne qui tombe dans l'image source est calculé une fois
+ * par ligne, la boucle interne n'a donc aucun test de bord : les lectures qui débordent d'au
+ * plus deux pixels tombent dans la bordure répliquée de l'image.
+ */
+
+#define VIRGULE 32
+#define UN ((int64_t)1 << VIRGULE)
+
+// Poids bilinéaires sur 10 bits : 255 * 1024 * 1024 tient sur 32 bits signés
+// (une version SSE2 de la boucle n'a rien gagné, le coût est dans les quatre lectures par pixel)
+#define BITS_BILIN 10
+#define UN_BILIN (1 << BITS_BILIN)
+
+// Poids bicubiques sur 10 bits, tabulés par 1/256 de pixel
+#define BITS_BICUB 10
+#define PAS_BICUB 256
+
+struct contexteAffine
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    double A, B, C, D, E, F;
+    enum interpolation interp;
+    const int16_t (*poids)[4];
+};
+
+void affineIdentite(struct affine *t)
+{
+    static const double identite[6] = {1, 0, 0, 0, 1, 0};
+    memcpy(t->m, identite, sizeof(identite));
+}
+
+void affineComposer(struct affine *t, const struct affine *suivante)
+{
+    const double *s = suivante->m;
+    double a[6];
+    memcpy(a, t->m, sizeof(a));
+
+    t->m[0] = s[0] * a[0] + s[1] * a[3];
+    t->m[1] = s[0] * a[1] + s[1] * a[4];
+    t->m[2] = s[0] * a[2] + s[1] * a[5] + s[2];
+    t->m[3] = s[3] * a[0] + s[4] * a[3];
+    t->m[4] = s[3] * a[1] + s[4] * a[4];
+    t->m[5] = s[3] * a[2] + s[4] * a[5] + s[5];
+}
+
+/**
+ * Arrondit les valeurs très proches de -1, 0 ou 1, pour que les multiples de 90° soient exacts
+ */
+static double nettoyer(double v)
+{
+    double r = round(v);
+    return fabs(v - r) < 1e-12 ? r : v;
+}
+
+void affineRotation(struct affine *t, double degres)
+{
+    double radians = degres * M_PI / 180.0;
+    double c = nettoyer(cos(radians));
+    double s = nettoyer(sin(radians));
+    struct affine r = {{c, -s, 0, s, c, 0}};
+    affineComposer(t, &r);
+}
+
+void affineEchelle(struct affine *t, double sx, double sy)
+{
+    struct affine e = {{sx, 0, 0, 0, sy, 0}};
+    affineComposer(t, &e);
+}
+
+void affineCisaillement(struct affine *t, double kx, double ky)
+{
+    struct affine c = {{1, kx, 0, ky, 1, 0}};
+    affineComposer(t, &c);
+}
+
+void affineTranslation(struct affine *t, double tx, double ty)
+{
+    struct affine d = {{1, 0, tx, 0, 1, ty}};
+    affineComposer(t, &d);
+}
+
+int affineInverser(const struct affine *t, struct affine *inverse)
+{
+    const double *m = t->m;
+    double det = m[0] * m[4] - m[1] * m[3];
+    if (fabs(det) < 1e-12)
+    {
+        return -1;
+    }
+
+    double i0 = m[4] / det, i1 = -m[1] / det;
+    double i3 = -m[3] / det, i4 = m[0] / det;
+    inverse->m[0] = i0;
+    inverse->m[1] = i1;
+    inverse->m[2] = -(i0 * m[2] + i1 * m[5]);
+    inverse->m[3] = i3;
+    inverse->m[4] = i4;
+    inverse->m[5] = -(i3 * m[2] + i4 * m[5]);
+    return 0;
+}
+
+/**
+ * Restreint [*debut, *fin[ aux k tels que bas <= p0 + pente * k <= haut
+ */
+static void restreindre(double p0, double pente, double bas, double haut, int *debut, int *fin)
+{
+    double kmin, kmax;
+    if (pente == 0)
+    {
+        if (p0 < bas || p0 > haut)
+        {
+            *fin = *debut;
+        }
+        return;
+    }
+    kmin = (bas - p0) / pente;
+    kmax = (haut - p0) / pente;
+    if (kmin > kmax)
+    {
+        double tmp = kmin;
+        kmin = kmax;
+        kmax = tmp;
+    }
+
+    if (kmin > *debut)
+    {
+        *debut = kmin >= *fin ? *fin : (int)ceil(kmin);
+    }
+    if (kmax + 1 < *fin)
+    {
+        *fin = kmax < *debut ? *debut : (int)floor(kmax) + 1;
+    }
+}
+
+static void ligneProche(unsigned char *dst, int n, const unsigned char *base, int stride, int64_t u, int64_t v,
+                        int64_t du, int64_t dv)
+{
+    u += UN / 2;
+    v += UN / 2;
+    for (int x = 0; x < n; x++)
+    {
+        dst[x] = base[(v >> VIRGULE) * stride + (u >> VIRGULE)];
+        u += du;
+        v += dv;
+    }
+}
+
+static void ligneBilineaire(unsigned char *dst, int n, const unsigned char *base, int stride, int64_t u, int64_t v,
+                            int64_t du, int64_t dv)
+{
+    const int decalage = VIRGULE - BITS_BILIN;
+    for (int x = 0; x < n; x++)
+    {
+        const unsigned char *p = base + (v >> VIRGULE) * stride + (u >> VIRGULE);
+        int fx = (int)(u >> decalage) & (UN_BILIN - 1);
+        int fy = (int)(v >> decalage) & (UN_BILIN - 1);
+        int h = p[0] * (UN_BILIN - fx) + p[1] * fx;
+        int b = p[stride] * (UN_BILIN - fx) + p[stride + 1] * fx;
+        dst[x] = (unsigned char)((h * (UN_BILIN - fy) + b * fy + (1 << (2 * BITS_BILIN - 1))) >> (2 * BITS_BILIN));
+        u += du;
+        v += dv;
+    }
+}
+
+static void ligneBicubique(unsigned char *dst, int n, const unsigned char *base, int stride, int64_t u, int64_t v,
+                           int64_t du, int64_t dv, const int16_t (*poids)[4])
+{
+    const int decalage = VIRGULE - 8;
+    for (int x = 0; x < n; x++)
+    {
+        const unsigned char *p = base + ((v >> VIRGULE) - 1) * stride + (u >> VIRGULE) - 1;
+        const int16_t *wx = poids[(u >> decalage) & (PAS_BICUB - 1)];
+        const int16_t *wy = poids[(v >> decalage) & (PAS_BICUB - 1)];
+        int somme = 0;
+        for (int k = 0; k < 4; k++, p += stride)
+        {
+            somme += (p[0] * wx[0] + p[1] * wx[1] + p[2] * wx[2] + p[3] * wx[3]) * wy[k];
+        }
+        somme = (somme + (1 << (2 * BITS_BICUB - 1))) >> (2 * BITS_BICUB);
+        dst[x] = (unsigned char)(somme < 0 ? 0 : somme > 255 ? 255 : somme);
+        u += du;
+        v += dv;
+    }
+}
+
+/**
+ * Poids de Catmull-Rom des pixels -1, 0, 1 et 2 pour chaque fraction t, de somme exacte
+ */
+static void poidsBicubiques(int16_t (*poids)[4])
+{
+    for (int i = 0; i < PAS_BICUB; i++)
+    {
+        double t = (double)i / PAS_BICUB;
+        double w[4] = {((-0.5 * t + 1.0) * t - 0.5) * t, (1.5 * t - 2.5) * t * t + 1.0,
+                       ((-1.5 * t + 2.0) * t + 0.5) * t, (0.5 * t - 0.5) * t * t};
+        int somme = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            poids[i][k] = (int16_t)lround(w[k] * (1 << BITS_BICUB));
+            somme += poids[i][k];
+        }
+        poids[i][t < 0.5 ? 1 : 2] += (int16_t)((1 << BITS_BICUB) - somme);
+    }
+}
+
+static int tuileAffine(const struct tuile *t, void *arg)
+{
+    const struct contexteAffine *ctx = arg;
+    const struct imageNB *img = ctx->img;
+    const unsigned char *base = img->color;
+    int n = t->x1 - t->x0;
+    int64_t du = llround(ctx->A * UN);
+    int64_t dv = llround(ctx->D * UN);
+
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        unsigned char *dst = imageRow(ctx->dest, y) + t->x0;
+        double u0 = ctx->A * t->x0 + ctx->B * y + ctx->C;
+        double v0 = ctx->D * t->x0 + ctx->E * y + ctx->F;
+
+        // Pixels de la ligne dont le centre source est dans l'image
+        int debut = 0, fin = n;
+        restreindre(u0, ctx->A, -0.5, img->width - 0.5, &debut, &fin);
+        restreindre(v0, ctx->D, -0.5, img->height - 0.5, &debut, &fin);
+
+        if (fin <= debut)
+        {
+            memset(dst, 0, (size_t)n);
+            continue;
+        }
+        memset(dst, 0, (size_t)debut);
+        memset(dst + fin, 0, (size_t)(n - fin));
+
+        int64_t u = llround((u0 + ctx->A * debut) * UN);
+        int64_t v = llround((v0 + ctx->D * debut) * UN);
+        switch (ctx->interp)
+        {
+        case INTERP_PROCHE:
+            ligneProche(dst + debut, fin - debut, base, img->stride, u, v, du, dv);
+            break;
+        case INTERP_BILINEAIRE:
+            ligneBilineaire(dst + debut, fin - debut, base, img->stride, u, v, du, dv);
+            break;
+        case INTERP_BICUBIQUE:
+            ligneBicubique(dst + debut, fin - debut, base, img->stride, u, v, du, dv, ctx->poids);
+            break;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Indique si la transformation est une permutation signée des axes, sans translation
+ */
+static int permutationSignee(const struct affine *t)
+{
+    const double *m = t->m;
+    for (int k = 0; k < 6; k++)
+    {
+        if (m[k] != 0 && m[k] != 1 && m[k] != -1)
+        {
+            return 0;
+        }
+    }
+    return m[2] == 0 && m[5] == 0 && fabs(m[0]) + fabs(m[1]) == 1 && fabs(m[3]) + fabs(m[4]) == 1 &&
+           fabs(m[0]) == fabs(m[4]);
+}
+
+int transformerAffine(struct imageNB *img, struct imageNB *dest, const struct affine *t, enum interpolation interp,
+                      enum cadre cadre)
+{
+    struct affine inv;
+    if (dest == img || img->border < 3 || interp < INTERP_PROCHE || interp > INTERP_BICUBIQUE ||
+        affineInverser(t, &inv) != 0)
+    {
+        printf("Invalid parameters for transformerAffine\n");
+        return -1;
+    }
+
+    // Symétries et quarts de tour : chaque pixel de sortie est un pixel source, copié sans
+    // interpolation (le cadre source ne change rien tant que les dimensions sont conservées)
+    if (permutationSignee(t) && (cadre == CADRE_ENGLOBANT || t->m[1] == 0 || img->width == img->height))
+    {
+        return permuterImage(img, dest, (int)t->m[0], (int)t->m[1], (int)t->m[3], (int)t->m[4]);
+    }
+
+    // Taille de sortie : rectangle englobant les quatre coins de l'image transformée
+    double w = img->width, h = img->height;
+    double centreX = 0, centreY = 0;
+    double largeur = w, hauteur = h;
+    if (cadre == CADRE_ENGLOBANT)
+    {
+        const double coins[4][2] = {{-w / 2, -h / 2}, {w / 2, -h / 2}, {-w / 2, h / 2}, {w / 2, h / 2}};
+        double minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+        for (int k = 0; k < 4; k++)
+        {
+            double x = t->m[0] * coins[k][0] + t->m[1] * coins[k][1] + t->m[2];
+            double y = t->m[3] * coins[k][0] + t->m[4] * coins[k][1] + t->m[5];
+            minX = fmin(minX, x);
+            maxX = fmax(maxX, x);
+            minY = fmin(minY, y);
+            maxY = fmax(maxY, y);
+        }
+        largeur = fmax(1.0, ceil(maxX - minX - 1e-6));
+        hauteur = fmax(1.0, ceil(maxY - minY - 1e-6));
+        centreX = (minX + maxX) / 2;
+        centreY = (minY + maxY) / 2;
+    }
+    if (largeur * hauteur > (double)(1 << 30))
+    {
+        printf("Invalid parameters for transformerAffine: output too large\n");
+        return -1;
+    }
+
+    if (reallocImage(dest, (int)largeur, (int)hauteur) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+    fillBorder(img);
+
+    // Pixel de sortie (i, j) -> coordonnées centrées (X, Y) -> inverse -> pixel source (u, v)
+    double offX = centreX - (largeur - 1) / 2, offY = centreY - (hauteur - 1) / 2;
+    double cxS = (w - 1) / 2, cyS = (h - 1) / 2;
+    struct contexteAffine ctx;
+    ctx.img = img;
+    ctx.dest = dest;
+    ctx.A = inv.m[0];
+    ctx.B = inv.m[1];
+    ctx.C = inv.m[0] * offX + inv.m[1] * offY + inv.m[2] + cxS;
+    ctx.D = inv.m[3];
+    ctx.E = inv.m[4];
+    ctx.F = inv.m[3] * offX + inv.m[4] * offY + inv.m[5] + cyS;
+    ctx.interp = interp;
+
+    int16_t poids[PAS_BICUB][4];
+    poidsBicubiques(poids);
+    ctx.poids = (const int16_t (*)[4])poids;
+
+    return executerTuiles(dest->width, dest->height, 0, tuileAffine, &ctx);
+}
@@ -0,0 +1,103 @@
+#ifndef _AFFINE_H_
+#define _AFFINE_H_
+
+#include "image.h"
+
+/**
+ * Transformation affine, en coordonnées centrées sur le milieu de l'image :
+ *   x' = m[0] x + m[1] y + m[2]
+ *   y' = m[3] x + m[4] y + m[5]
+ * L'axe y est dirigé vers le bas, un angle positif tourne donc dans le sens horaire.
+ */
+struct affine
+{
+    double m[6];
+};
+
+/**
+ * Méthode d'échantillonnage de l'image source
+ */
+enum interpolation
+{
+    INTERP_PROCHE,
+    INTERP_BILINEAIRE,
+    INTERP_BICUBIQUE
+};
+
+/**
+ * Taille de l'image de sortie
+ */
+enum cadre
+{
+    CADRE_ENGLOBANT, // rectangle englobant l'image transformée (la translation est ignorée)
+    CADRE_SOURCE     // même taille que l'image source
+};
+
+/**
+ * Fonction qui initialise une transformation à l'identité
+ * @param t
+ */
+void affineIdentite(struct affine *t);
+
+/**
+ * Fonction qui compose deux transformations : t devient "suivante après t"
+ * @param t
+ * @param suivante
+ */
+void affineComposer(struct affine *t, const struct affine *suivante);
+
+/**
+ * Fonction qui ajoute une rotation à la transformation
+ * @param t
+ * @param degres
+ */
+void affineRotation(struct affine *t, double degres);
+
+/**
+ * Fonction qui ajoute un changement d'échelle à la transformation
+ * @param t
+ * @param sx
+ * @param sy
+ */
+void affineEchelle(struct affine *t, double sx, double sy);
+
+/**
+ * Fonction qui ajoute un cisaillement à la transformation (x' = x + kx y, y' = y + ky x)
+ * @param t
+ * @param kx
+ * @param ky
+ */
+void affineCisaillement(struct affine *t, double kx, double ky);
+
+/**
+ * Fonction qui ajoute une translation à la transformation
+ * @param t
+ * @param tx
+ * @param ty
+ */
+void affineTranslation(struct affine *t, double tx, double ty);
+
+/**
+ * Fonction qui inverse une transformation
+ * @param t
+ * @param inverse
+ * @return 0 si la transformation est inversible, -1 sinon
+ */
+int affineInverser(const struct affine *t, struct affine *inverse);
+
+/**
+ * Fonction qui applique une transformation affine à une image
+ * Pour chaque pixel de sortie, la position source est obtenue par la transformation inverse,
+ * avancée de façon incrémentale le long de la ligne. Les pixels qui tombent hors de l'image
+ * source sont noirs. Le calcul est réparti en tuiles sur tous les threads.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param t
+ * @param interp
+ * @param cadre
+ * @return 0 si la transformation a réussi, -1 sinon
+ */
+int transformerAffine(struct imageNB *img, struct imageNB *dest, const struct affine *t, enum interpolation interp,
+                      enum cadre cadre);
+
+#endif
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <time.h>
+
+#include "attente.h"
+#include "reserve.h"
+
+/**
+ * Nombre d'essais avant de céder le processeur, puis avant de dormir
+ */
+#define ATTENTE_BOUCLE 64
+#define ATTENTE_CEDER 256
+
+/**
+ * Durée d'un sommeil quand la file reste pleine ou vide (en nanosecondes)
+ */
+#define ATTENTE_SOMMEIL 50000
+
+/**
+ * Une case : son numéro de séquence, suivi de l'élément
+ */
+static atomic_size_t *sequence(struct fileAttente *f, size_t position)
+{
+    return (atomic_size_t *)(f->cases + (position & f->masque) * f->pas);
+}
+
+static void *contenu(struct fileAttente *f, size_t position)
+{
+    return f->cases + (position & f->masque) * f->pas + sizeof(atomic_size_t);
+}
+
+int fileInit(struct fileAttente *f, int capacite, size_t tailleElement)
+{
+    size_t n = 2;
+    while (n < (size_t)capacite)
+    {
+        n *= 2;
+    }
+
+    // Une case par ligne de cache (ou plus) : deux threads voisins ne se gênent pas
+    f->pas = (sizeof(atomic_size_t) + tailleElement + 63) / 64 * 64;
+    f->masque = n - 1;
+    f->tailleElement = tailleElement;
+    f->cases = reservePrendre(n * f->pas);
+    if (f->cases == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        atomic_init(sequence(f, i), i);
+    }
+
+    atomic_init(&f->tete, 0);
+    atomic_init(&f->queue, 0);
+    atomic_init(&f->depots, 0);
+    atomic_init(&f->sommeProfondeur, 0);
+    atomic_init(&f->profondeurMax, 0);
+    atomic_init(&f->attentesPleine, 0);
+    atomic_init(&f->attentesVide, 0);
+    return 0;
+}
+
+void fileLiberer(struct fileAttente *f)
+{
+    reserveRendre(f->cases);
+    f->cases = NULL;
+}
+
+int fileDeposer(struct fileAttente *f, const void *element)
+{
+    size_t position = atomic_load_explicit(&f->queue, memory_order_relaxed);
+    for (;;)
+    {
+        size_t seq = atomic_load_explicit(sequence(f, position), memory_order_acquire);
+        intptr_t ecart = (intptr_t)seq - (intptr_t)position;
+        if (ecart == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&f->queue, &position, position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (ecart < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            position = atomic_load_explicit(&f->queue, memory_order_relaxed);
+        }
+    }
+
+    memcpy(contenu(f, position), element, f->tailleElement);
+    atomic_store_explicit(sequence(f, position), position + 1, memory_order_release);
+
+    // Profondeur vue par le producteur, pour les mesures
+    size_t tete = atomic_load_explicit(&f->tete, memory_order_relaxed);
+    size_t profondeur = position + 1 > tete ? position + 1 - tete : 0;
+    atomic_fetch_add_explicit(&f->depots, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&f->sommeProfondeur, profondeur, memory_order_relaxed);
+    size_t max = atomic_load_explicit(&f->profondeurMax, memory_order_relaxed);
+    while (profondeur > max &&
+           !atomic_compare_exchange_weak_explicit(&f->profondeurMax, &max, profondeur, memory_order_relaxed,
+                                                  memory_order_relaxed))
+    {
+    }
+    return 0;
+}
+
+int fileRetirer(struct fileAttente *f, void *element)
+{
+    size_t position = atomic_load_explicit(&f->tete, memory_order_relaxed);
+    for (;;)
+    {
+        size_t seq = atomic_load_explicit(sequence(f, position), memory_order_acquire);
+        intptr_t ecart = (intptr_t)seq - (intptr_t)(position + 1);
+        if (ecart == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&f->tete, &position, position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (ecart < 0)
+        {
+            return -1;
+        }
+        else
+        {
+            position = atomic_load_explicit(&f->tete, memory_order_relaxed);
+        }
+    }
+
+    memcpy(element, contenu(f, position), f->tailleElement);
+    atomic_store_explicit(sequence(f, position), position + f->masque + 1, memory_order_release);
+    return 0;
+}
+
+/**
+ * Patiente après l'essai numéro `essai` : boucle courte, puis sched_yield, puis sommeil
+ */
+static void patienter(int essai)
+{
+    if (essai < ATTENTE_BOUCLE)
+    {
+        return;
+    }
+    if (essai < ATTENTE_CEDER)
+    {
+        sched_yield();
+        return;
+    }
+    struct timespec duree = {0, ATTENTE_SOMMEIL};
+    nanosleep(&duree, NULL);
+}
+
+void fileDeposerAttendre(struct fileAttente *f, const void *element)
+{
+    if (fileDeposer(f, element) == 0)
+    {
+        return;
+    }
+    atomic_fetch_add_explicit(&f->attentesPleine, 1, memory_order_relaxed);
+    for (int essai = 0; fileDeposer(f, element) != 0; essai++)
+    {
+        patienter(essai);
+    }
+}
+
+void fileRetirerAttendre(struct fileAttente *f, void *element)
+{
+    if (fileRetirer(f, element) == 0)
+    {
+        return;
+    }
+    atomic_fetch_add_explicit(&f->attentesVide, 1, memory_order_relaxed);
+    for (int essai = 0; fileRetirer(f, element) != 0; essai++)
+    {
+        patienter(essai);
+    }
+}
+
+void fileStats(struct fileAttente *f, struct statsFile *stats)
+{
+    stats->capacite = f->masque + 1;
+    stats->depots = atomic_load(&f->depots);
+    stats->profondeurMoyenne = stats->depots > 0 ? (double)atomic_load(&f->sommeProfondeur) / stats->depots : 0;
+    stats->profondeurMax = atomic_load(&f->profondeurMax);
+    stats->attentesPleine = atomic_load(&f->attentesPleine);
+    stats->attentesVide = atomic_load(&f->attentesVide);
+}
@@ -0,0 +1,97 @@
+#ifndef _ATTENTE_H_
+#define _ATTENTE_H_
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+/**
+ * File d'attente bornée sans verrou, pour plusieurs producteurs et plusieurs consommateurs
+ *
+ * Les éléments (de taille fixe) sont copiés dans un anneau de cases ; chaque case porte un
+ * numéro de séquence qui indique si elle attend un dépôt ou un retrait (file de Vyukov).
+ * fileDeposer et fileRetirer ne bloquent jamais ; les variantes ...Attendre patientent
+ * (boucle courte, puis sched_yield, puis sommeil) et comptent ces attentes.
+ */
+struct fileAttente
+{
+    unsigned char *cases;
+    size_t pas;
+    size_t masque;
+    size_t tailleElement;
+
+    _Alignas(64) atomic_size_t tete;
+    _Alignas(64) atomic_size_t queue;
+
+    _Alignas(64) atomic_size_t depots;
+    atomic_size_t sommeProfondeur;
+    atomic_size_t profondeurMax;
+    atomic_size_t attentesPleine;
+    atomic_size_t attentesVide;
+};
+
+/**
+ * Mesures d'une file depuis sa création
+ */
+struct statsFile
+{
+    size_t capacite;
+    size_t depots;
+    double profondeurMoyenne;
+    size_t profondeurMax;
+    size_t attentesPleine;
+    size_t attentesVide;
+};
+
+/**
+ * Fonction qui crée une file
+ * @param f
+ * @param capacite nombre de cases, arrondi à la puissance de deux supérieure (au moins 2)
+ * @param tailleElement
+ * @return 0 si la file est prête, -1 sinon
+ */
+int fileInit(struct fileAttente *f, int capacite, size_t tailleElement);
+
+/**
+ * Fonction qui libère une file
+ * @param f
+ */
+void fileLiberer(struct fileAttente *f);
+
+/**
+ * Fonction qui copie un élément à la fin de la file, si elle n'est pas pleine
+ * @param f
+ * @param element
+ * @return 0 si l'élément a été déposé, -1 si la file est pleine
+ */
+int fileDeposer(struct fileAttente *f, const void *element);
+
+/**
+ * Fonction qui retire l'élément en tête de la file, si elle n'est pas vide
+ * @param f
+ * @param element reçoit la copie de l'élément
+ * @return 0 si un élément a été retiré, -1 si la file est vide
+ */
+int fileRetirer(struct fileAttente *f, void *element);
+
+/**
+ * Fonction qui dépose un élément, en attendant qu'une case se libère
+ * @param f
+ * @param element
+ */
+void fileDeposerAttendre(struct fileAttente *f, const void *element);
+
+/**
+ * Fonction qui retire un élément, en attendant qu'il y en ait un
+ * @param f
+ * @param element
+ */
+void fileRetirerAttendre(struct fileAttente *f, void *element);
+
+/**
+ * Fonction qui relève les mesures d'une file
+ * @param f
+ * @param stats
+ */
+void fileStats(struct fileAttente *f, struct statsFile *stats);
+
+#endif
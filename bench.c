@@ -0,0 +1,526 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "image.h"
+#include "operations.h"
+#include "geometrie.h"
+#include "echelle.h"
+#include "convolution.h"
+#include "median.h"
+#include "morphologie.h"
+#include "seuil.h"
+#include "parallele.h"
+
+/*
+ * Banc d'essai des opérations du menu sur des images synthétiques.
+ * Chaque mesure est répétée jusqu'à un budget de temps ; le fichier de résultats (CSV) peut
+ * servir de référence à une exécution suivante (-c) pour repérer les régressions.
+ */
+
+#define BENCH_TAILLES_MAX 16
+#define BENCH_MESURES_MAX 1000
+#define BENCH_REFERENCES_MAX 1024
+
+struct banc
+{
+    const char *nom;
+    int (*executer)(struct imageNB *img, struct imageNB *dest);
+};
+
+struct mesure
+{
+    char nom[32];
+    int largeur;
+    int hauteur;
+    int repetitions;
+    double moyenne; // secondes
+    double ecartType;
+    double min;
+    double nsParPixel;
+    double goParSeconde;
+};
+
+static int sobelStandard[2][3][3] = {{{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}}, {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}}};
+
+static int benchSobel(struct imageNB *img, struct imageNB *dest)
+{
+    return sobel(img, dest, sobelStandard[0], sobelStandard[1]);
+}
+
+static int benchTranslation(struct imageNB *img, struct imageNB *dest)
+{
+    return translation(img, dest, img->width / 3);
+}
+
+static int benchSeuillage(struct imageNB *img, struct imageNB *dest)
+{
+    return seuillage(img, dest, 128);
+}
+
+static int benchRedimensionner(struct imageNB *img, struct imageNB *dest)
+{
+    return redimensionner(img, dest, (int)(img->width * 0.37), (int)(img->height * 0.37));
+}
+
+static int benchVignette(struct imageNB *img, struct imageNB *dest)
+{
+    return vignette(img, dest, img->width / 8);
+}
+
+static int benchHistogramme(struct imageNB *img, struct imageNB *dest)
+{
+    return histogramme(img, dest);
+}
+
+static int benchContraste(struct imageNB *img, struct imageNB *dest)
+{
+    return contraste(img, dest, 20);
+}
+
+static int benchLuminosite(struct imageNB *img, struct imageNB *dest)
+{
+    return luminosite(img, dest, -20);
+}
+
+static int benchFlouter(struct imageNB *img, struct imageNB *dest)
+{
+    return flouter(img, dest);
+}
+
+static int benchPivoter(struct imageNB *img, struct imageNB *dest)
+{
+    return pivoter(img, dest, 30.0f, true);
+}
+
+static int benchPivoterQuart(struct imageNB *img, struct imageNB *dest)
+{
+    return pivoterQuart(img, dest, 1);
+}
+
+static int benchTransposer(struct imageNB *img, struct imageNB *dest)
+{
+    return transposer(img, dest);
+}
+
+static int benchNegatif(struct imageNB *img, struct imageNB *dest)
+{
+    return negatif(img, dest);
+}
+
+static int benchPixeliser(struct imageNB *img, struct imageNB *dest)
+{
+    return pixeliser(img, dest, 8);
+}
+
+static int benchNettete(struct imageNB *img, struct imageNB *dest)
+{
+    return convoluerPredefini(img, dest, NOYAU_NETTETE);
+}
+
+static int benchNoyau(struct imageNB *img, struct imageNB *dest)
+{
+    // Le même noyau par le chemin générique, pour mesurer le gain de la spécialisation
+    return convoluer(img, dest, noyauPredefini(NOYAU_NETTETE));
+}
+
+static int benchLisser(struct imageNB *img, struct imageNB *dest)
+{
+    return convoluerPredefini(img, dest, NOYAU_GAUSSIEN_5);
+}
+
+static int benchFourier(struct imageNB *img, struct imageNB *dest)
+{
+    // Moyenne 31 x 31, au-delà de la portée du calcul direct
+    static double coefs[31 * 31];
+    for (int i = 0; i < 31 * 31; i++)
+    {
+        coefs[i] = 1.0 / (31 * 31);
+    }
+    struct noyauReel k = {31, 31, coefs, 0};
+    return convoluerReel(img, dest, &k, 0, METHODE_FOURIER);
+}
+
+static int benchMedian(struct imageNB *img, struct imageNB *dest)
+{
+    return median(img, dest, 1);
+}
+
+static int benchMedian7(struct imageNB *img, struct imageNB *dest)
+{
+    return median(img, dest, 7);
+}
+
+static int benchEroder(struct imageNB *img, struct imageNB *dest)
+{
+    return eroder(img, dest, 1, 1);
+}
+
+static int benchEroder7(struct imageNB *img, struct imageNB *dest)
+{
+    return eroder(img, dest, 7, 7);
+}
+
+static int benchOtsu(struct imageNB *img, struct imageNB *dest)
+{
+    return seuillageOtsu(img, dest);
+}
+
+static int benchSauvola(struct imageNB *img, struct imageNB *dest)
+{
+    return seuillageLocal(img, dest, SEUIL_SAUVOLA, 7, SAUVOLA_K);
+}
+
+static int benchMasque(struct imageNB *img, struct imageNB *dest)
+{
+    (void)dest;
+    struct masque m;
+    if (masqueLocal(img, &m, SEUIL_SAUVOLA, 7, SAUVOLA_K) != 0)
+    {
+        return -1;
+    }
+    masqueLiberer(&m);
+    return 0;
+}
+
+static const struct banc bancs[] = {
+    {"sobel", benchSobel},
+    {"translation", benchTranslation},
+    {"seuillage", benchSeuillage},
+    {"redimensionner", benchRedimensionner},
+    {"vignette", benchVignette},
+    {"histogramme", benchHistogramme},
+    {"contraste", benchContraste},
+    {"luminosite", benchLuminosite},
+    {"flouter", benchFlouter},
+    {"pivoter", benchPivoter},
+    {"pivoterQuart", benchPivoterQuart},
+    {"transposer", benchTransposer},
+    {"negatif", benchNegatif},
+    {"pixeliser", benchPixeliser},
+    {"nettete", benchNettete},
+    {"noyau", benchNoyau},
+    {"lisser", benchLisser},
+    {"fourier", benchFourier},
+    {"median", benchMedian},
+    {"median7", benchMedian7},
+    {"eroder", benchEroder},
+    {"eroder7", benchEroder7},
+    {"otsu", benchOtsu},
+    {"sauvola", benchSauvola},
+    {"masque", benchMasque},
+};
+
+#define NB_BANCS (int)(sizeof(bancs) / sizeof(bancs[0]))
+
+static double maintenant(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Image synthétique reproductible : dégradé, damier et bruit
+ */
+static int imageSynthetique(struct imageNB *img, int taille)
+{
+    if (allocImage(img, taille, taille, IMAGE_BORDURE) != 0)
+    {
+        return -1;
+    }
+    uint32_t graine = 2463534242u;
+    for (int y = 0; y < taille; y++)
+    {
+        unsigned char *ligne = imageRow(img, y);
+        for (int x = 0; x < taille; x++)
+        {
+            graine ^= graine << 13;
+            graine ^= graine >> 17;
+            graine ^= graine << 5;
+            int v = (x + y) * 255 / (2 * taille) + (((x >> 5) ^ (y >> 5)) & 1) * 64 + (int)(graine & 31);
+            ligne[x] = (unsigned char)(v > 255 ? 255 : v);
+        }
+    }
+    return 0;
+}
+
+static void usage(const char *programme)
+{
+    printf("Usage: %s [-s tailles] [-b secondes] [-r repetitions] [-t threads] [-f operation] [-o resultats.csv]\n"
+           "          [-c reference.csv] [-x seuil]\n",
+           programme);
+    printf("  -s  cotes des images carrees, separes par des virgules (defaut 256,512,...,16384)\n");
+    printf("  -b  budget de temps par mesure (defaut 0.5 s), au moins -r repetitions (defaut 3)\n");
+    printf("  -f  ne mesure que les operations dont le nom contient ce texte\n");
+    printf("  -c  compare aux resultats d'une execution precedente ; code de sortie 2 si une\n");
+    printf("      operation est plus lente que la reference de plus de -x (defaut 0.10 = 10 %%)\n");
+    printf("\nOperations :");
+    for (int i = 0; i < NB_BANCS; i++)
+    {
+        printf(" %s", bancs[i].nom);
+    }
+    printf("\n");
+}
+
+/**
+ * Mesure une opération : une exécution à blanc, puis des répétitions jusqu'au budget
+ */
+static int mesurer(const struct banc *b, struct imageNB *img, struct imageNB *dest, double budget, int minRepetitions,
+                   struct mesure *m)
+{
+    if (b->executer(img, dest) != 0)
+    {
+        return -1;
+    }
+
+    double somme = 0, sommeCarres = 0, min = INFINITY;
+    int n = 0;
+    double debutBudget = maintenant();
+    while (n < minRepetitions || (maintenant() - debutBudget < budget && n < BENCH_MESURES_MAX))
+    {
+        double debut = maintenant();
+        if (b->executer(img, dest) != 0)
+        {
+            return -1;
+        }
+        double duree = maintenant() - debut;
+        somme += duree;
+        sommeCarres += duree * duree;
+        min = duree < min ? duree : min;
+        n++;
+    }
+
+    double pixels = (double)img->width * img->height;
+    double octets = pixels + (double)dest->width * dest->height;
+    snprintf(m->nom, sizeof(m->nom), "%s", b->nom);
+    m->largeur = img->width;
+    m->hauteur = img->height;
+    m->repetitions = n;
+    m->moyenne = somme / n;
+    m->ecartType = sqrt(fmax(0.0, sommeCarres / n - m->moyenne * m->moyenne));
+    m->min = min;
+    m->nsParPixel = m->moyenne * 1e9 / pixels;
+    m->goParSeconde = octets / m->moyenne / 1e9;
+    return 0;
+}
+
+static void ecrireEnTeteCSV(FILE *f)
+{
+    fprintf(f, "operation,largeur,hauteur,repetitions,moyenne_ms,ecart_type_ms,min_ms,ns_par_pixel,go_par_s\n");
+}
+
+static void ecrireMesureCSV(FILE *f, const struct mesure *m)
+{
+    fprintf(f, "%s,%d,%d,%d,%.6f,%.6f,%.6f,%.4f,%.4f\n", m->nom, m->largeur, m->hauteur, m->repetitions,
+            m->moyenne * 1e3, m->ecartType * 1e3, m->min * 1e3, m->nsParPixel, m->goParSeconde);
+}
+
+/**
+ * Charge un fichier de résultats précédent
+ * @return le nombre de mesures lues, ou -1 si le fichier est illisible
+ */
+static int chargerReference(const char *nomFichier, struct mesure *refs, int max)
+{
+    FILE *f = fopen(nomFichier, "r");
+    if (f == NULL)
+    {
+        printf("--> %s not found \n", nomFichier);
+        return -1;
+    }
+
+    char ligne[512];
+    int n = 0;
+    while (n < max && fgets(ligne, sizeof(ligne), f) != NULL)
+    {
+        struct mesure *m = &refs[n];
+        double moyenne, ecartType, min;
+        if (sscanf(ligne, "%31[^,],%d,%d,%d,%lf,%lf,%lf,%lf,%lf", m->nom, &m->largeur, &m->hauteur, &m->repetitions,
+                   &moyenne, &ecartType, &min, &m->nsParPixel, &m->goParSeconde) == 9)
+        {
+            m->moyenne = moyenne / 1e3;
+            m->ecartType = ecartType / 1e3;
+            m->min = min / 1e3;
+            n++;
+        }
+    }
+    fclose(f);
+    return n;
+}
+
+static const struct mesure *trouverReference(const struct mesure *refs, int nb, const struct mesure *m)
+{
+    for (int i = 0; i < nb; i++)
+    {
+        if (strcmp(refs[i].nom, m->nom) == 0 && refs[i].largeur == m->largeur && refs[i].hauteur == m->hauteur)
+        {
+            return &refs[i];
+        }
+    }
+    return NULL;
+}
+
+static int lireTailles(const char *texte, int *tailles)
+{
+    int nb = 0;
+    const char *p = texte;
+    while (*p != '\0' && nb < BENCH_TAILLES_MAX)
+    {
+        char *fin;
+        long v = strtol(p, &fin, 10);
+        if (fin == p || v <= 0 || v > 65536)
+        {
+            return -1;
+        }
+        tailles[nb++] = (int)v;
+        p = (*fin == ',') ? fin + 1 : fin;
+    }
+    return nb;
+}
+
+int main(int argc, char **argv)
+{
+    int tailles[BENCH_TAILLES_MAX] = {256, 512, 1024, 2048, 4096, 8192, 16384};
+    int nbTailles = 7;
+    double budget = 0.5;
+    int minRepetitions = 3;
+    double seuil = 0.10;
+    const char *filtre = NULL;
+    const char *sortie = NULL;
+    const char *reference = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:b:r:t:f:o:c:x:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 's':
+                if ((nbTailles = lireTailles(optarg, tailles)) <= 0)
+                {
+                    printf("Invalid sizes: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'b':
+                budget = atof(optarg);
+                break;
+            case 'r':
+                minRepetitions = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 't':
+                if (parallelInit(atoi(optarg)) != 0)
+                {
+                    return 1;
+                }
+                break;
+            case 'f':
+                filtre = optarg;
+                break;
+            case 'o':
+                sortie = optarg;
+                break;
+            case 'c':
+                reference = optarg;
+                break;
+            case 'x':
+                seuil = atof(optarg);
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    static struct mesure refs[BENCH_REFERENCES_MAX];
+    int nbRefs = 0;
+    if (reference != NULL && (nbRefs = chargerReference(reference, refs, BENCH_REFERENCES_MAX)) < 0)
+    {
+        return 1;
+    }
+
+    FILE *csv = NULL;
+    if (sortie != NULL)
+    {
+        csv = fopen(sortie, "w");
+        if (csv == NULL)
+        {
+            printf("Unable to create file: %s \n", sortie);
+            return 1;
+        }
+        ecrireEnTeteCSV(csv);
+    }
+
+    printf("%d threads\n", parallelThreads());
+    printf("%-16s %11s %6s %12s %12s %10s %8s%s\n", "operation", "taille", "rep", "moyenne ms", "ecart ms", "ns/px",
+           "Go/s", reference != NULL ? "   vs ref" : "");
+
+    int regressions = 0;
+    for (int t = 0; t < nbTailles; t++)
+    {
+        struct imageNB img = {0};
+        struct imageNB dest = {0};
+        if (imageSynthetique(&img, tailles[t]) != 0)
+        {
+            printf("Skipping size %d: not enough memory\n", tailles[t]);
+            continue;
+        }
+
+        for (int i = 0; i < NB_BANCS; i++)
+        {
+            if (filtre != NULL && strstr(bancs[i].nom, filtre) == NULL)
+            {
+                continue;
+            }
+
+            struct mesure m;
+            if (mesurer(&bancs[i], &img, &dest, budget, minRepetitions, &m) != 0)
+            {
+                printf("%-16s %5d x %-5d failed\n", bancs[i].nom, img.width, img.height);
+                continue;
+            }
+
+            printf("%-16s %5d x %-5d %6d %12.3f %12.3f %10.3f %8.2f", m.nom, m.largeur, m.hauteur, m.repetitions,
+                   m.moyenne * 1e3, m.ecartType * 1e3, m.nsParPixel, m.goParSeconde);
+            const struct mesure *ref = trouverReference(refs, nbRefs, &m);
+            if (ref != NULL)
+            {
+                double rapport = m.moyenne / ref->moyenne;
+                bool lent = rapport > 1.0 + seuil;
+                regressions += lent;
+                printf("   %+6.1f %%%s", (rapport - 1.0) * 100, lent ? "  REGRESSION" : "");
+            }
+            printf("\n");
+            fflush(stdout);
+
+            if (csv != NULL)
+            {
+                ecrireMesureCSV(csv, &m);
+                fflush(csv);
+            }
+        }
+
+        freeImageMemory(&img);
+        freeImageMemory(&dest);
+    }
+
+    if (csv != NULL)
+    {
+        fclose(csv);
+    }
+    parallelFin();
+
+    if (regressions > 0)
+    {
+        printf("%d regression(s) above %.0f %%\n", regressions, seuil * 100);
+        return 2;
+    }
+    return 0;
+}
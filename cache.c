@@ -0,0 +1,422 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "pgm.h"
+#include "parallele.h"
+#include "reserve.h"
+#include "trace.h"
+
+/**
+ * Lignes hachées par tâche
+ */
+#define CACHE_BANDE 64
+
+/**
+ * Longueur maximale du chemin d'un fichier du niveau disque
+ */
+#define CACHE_CHEMIN 4096
+
+#define PREMIER_A 0x9E3779B97F4A7C15ULL
+#define PREMIER_B 0xC2B2AE3D27D4EB4FULL
+
+struct entreeCache
+{
+    struct cleCache cle;
+    struct imageNB img;
+    size_t octets;
+    struct entreeCache *precedente;
+    struct entreeCache *suivante;
+};
+
+static struct
+{
+    pthread_mutex_t verrou;
+    size_t limite;
+    char *dossier;
+    struct entreeCache *tete; // la plus récemment utilisée
+    struct entreeCache *queue;
+    struct statsCache stats;
+    atomic_uint temporaires;
+} cache = {.verrou = PTHREAD_MUTEX_INITIALIZER};
+
+struct contexteHachage
+{
+    const struct imageNB *img;
+    int bord; // marge hachée autour de l'image : sa bordure pour une vue, 0 sinon
+    uint64_t *bandes; // deux valeurs par bande
+};
+
+static inline uint64_t rotation(uint64_t v, int k)
+{
+    return (v << k) | (v >> (64 - k));
+}
+
+/**
+ * Finaliseur de MurmurHash3 : chaque bit de v influence tous les bits du résultat
+ */
+static inline uint64_t melanger(uint64_t v)
+{
+    v ^= v >> 33;
+    v *= 0xFF51AFD7ED558CCDULL;
+    v ^= v >> 33;
+    v *= 0xC4CEB9FE1A85EC53ULL;
+    v ^= v >> 33;
+    return v;
+}
+
+/**
+ * Ajoute n octets aux deux états h, huit octets à la fois ; les deux chaînes de
+ * multiplications sont indépendantes et s'exécutent en même temps
+ */
+static void hacher(const unsigned char *octets, size_t n, uint64_t h[2])
+{
+    uint64_t a = h[0], b = h[1];
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t mot;
+        memcpy(&mot, octets + i, 8);
+        a = rotation(a ^ mot, 29) * PREMIER_A;
+        b = rotation(b + mot, 31) * PREMIER_B;
+    }
+    uint64_t reste = 0;
+    memcpy(&reste, octets + i, n - i);
+    h[0] = rotation(a ^ reste ^ n, 29) * PREMIER_A;
+    h[1] = rotation(b + reste + n, 31) * PREMIER_B;
+}
+
+static void tacheHachage(void *arg, int k)
+{
+    const struct contexteHachage *ctx = arg;
+    const struct imageNB *img = ctx->img;
+    int bord = ctx->bord;
+    int lignes = img->height + 2 * bord;
+    int y0 = k * CACHE_BANDE - bord;
+    int y1 = ((k + 1) * CACHE_BANDE < lignes ? (k + 1) * CACHE_BANDE : lignes) - bord;
+    uint64_t h[2] = {PREMIER_A, PREMIER_B};
+    for (int y = y0; y < y1; y++)
+    {
+        hacher(imageRow(img, y) - bord, (size_t)img->width + 2 * bord, h);
+    }
+    ctx->bandes[2 * k] = h[0];
+    ctx->bandes[2 * k + 1] = h[1];
+}
+
+void cacheCle(const struct imageNB *img, const char *recette, struct cleCache *cle)
+{
+    struct traceZone zone;
+    traceOuvrir(&zone, "cache key");
+
+    // Les filtres d'une vue lisent sa bordure, prise dans l'image d'origine : elle fait
+    // partie des pixels dont dépend le résultat
+    int bord = img->vue ? img->border : 0;
+    uint64_t h[2] = {melanger(((uint64_t)img->width << 32) ^ (uint64_t)img->height),
+                     melanger(((uint64_t)bord << 32) ^ (uint64_t)img->vmax)};
+    int nbBandes = (img->height + 2 * bord + CACHE_BANDE - 1) / CACHE_BANDE;
+    uint64_t *bandes = reservePrendre((size_t)nbBandes * 2 * sizeof(uint64_t));
+    if (bandes != NULL)
+    {
+        struct contexteHachage ctx = {img, bord, bandes};
+        parallelFor(nbBandes, tacheHachage, &ctx);
+        for (int k = 0; k < nbBandes; k++)
+        {
+            h[0] = melanger(h[0] ^ bandes[2 * k]);
+            h[1] = melanger(h[1] + bandes[2 * k + 1]);
+        }
+        reserveRendre(bandes);
+    }
+    else
+    {
+        // Sans mémoire pour les bandes, toute l'image à la suite
+        for (int y = -bord; y < img->height + bord; y++)
+        {
+            hacher(imageRow(img, y) - bord, (size_t)img->width + 2 * bord, h);
+        }
+    }
+    hacher((const unsigned char *)recette, strlen(recette), h);
+    cle->h[0] = melanger(h[0] ^ rotation(h[1], 17));
+    cle->h[1] = melanger(h[1] + h[0]);
+    traceFermer(&zone);
+}
+
+size_t cacheMemoireDefaut(void)
+{
+    const char *env = getenv("IMAGE_CACHE");
+    if (env != NULL && env[0] != '\0')
+    {
+        return (size_t)strtoull(env, NULL, 10) << 20;
+    }
+    return CACHE_MEMOIRE_DEFAUT;
+}
+
+/**
+ * Retire une entrée de la liste, le verrou étant pris
+ */
+static void detacher(struct entreeCache *e)
+{
+    if (e->precedente != NULL)
+    {
+        e->precedente->suivante = e->suivante;
+    }
+    else
+    {
+        cache.tete = e->suivante;
+    }
+    if (e->suivante != NULL)
+    {
+        e->suivante->precedente = e->precedente;
+    }
+    else
+    {
+        cache.queue = e->precedente;
+    }
+}
+
+/**
+ * Place une entrée en tête de liste (la plus récente), le verrou étant pris
+ */
+static void placerEnTete(struct entreeCache *e)
+{
+    e->precedente = NULL;
+    e->suivante = cache.tete;
+    if (cache.tete != NULL)
+    {
+        cache.tete->precedente = e;
+    }
+    cache.tete = e;
+    if (cache.queue == NULL)
+    {
+        cache.queue = e;
+    }
+}
+
+/**
+ * Cherche une entrée du niveau mémoire, le verrou étant pris
+ */
+static struct entreeCache *trouver(const struct cleCache *cle)
+{
+    for (struct entreeCache *e = cache.tete; e != NULL; e = e->suivante)
+    {
+        if (e->cle.h[0] == cle->h[0] && e->cle.h[1] == cle->h[1])
+        {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Libère les entrées les moins récentes jusqu'à ne plus occuper que `limite` octets,
+ * le verrou étant pris
+ */
+static void evincer(size_t limite)
+{
+    while (cache.queue != NULL && cache.stats.octets > limite)
+    {
+        struct entreeCache *e = cache.queue;
+        detacher(e);
+        cache.stats.octets -= e->octets;
+        cache.stats.evictions++;
+        freeImageMemory(&e->img);
+        free(e);
+    }
+}
+
+int cacheActiver(size_t octets, const char *dossier)
+{
+    char *copie = NULL;
+    if (dossier != NULL)
+    {
+        if (mkdir(dossier, 0755) != 0 && errno != EEXIST)
+        {
+            printf("Unable to create cache directory: %s\n", dossier);
+            return -1;
+        }
+        copie = strdup(dossier);
+        if (copie == NULL)
+        {
+            printf("ERROR allocating memory\n");
+            return -1;
+        }
+    }
+
+    pthread_mutex_lock(&cache.verrou);
+    free(cache.dossier);
+    cache.dossier = copie;
+    cache.limite = octets;
+    evincer(octets);
+    pthread_mutex_unlock(&cache.verrou);
+    return 0;
+}
+
+int cacheActif(void)
+{
+    pthread_mutex_lock(&cache.verrou);
+    int actif = cache.limite > 0 || cache.dossier != NULL;
+    pthread_mutex_unlock(&cache.verrou);
+    return actif;
+}
+
+/**
+ * Chemin du fichier d'une clé dans le niveau disque, le verrou étant pris
+ * @return 0 si le chemin tient dans le tampon, -1 sinon
+ */
+static int chemin(const struct cleCache *cle, char *texte, size_t taille)
+{
+    int n = snprintf(texte, taille, "%s/%016llx%016llx.pgm", cache.dossier, (unsigned long long)cle->h[0],
+                     (unsigned long long)cle->h[1]);
+    return n > 0 && (size_t)n < taille ? 0 : -1;
+}
+
+/**
+ * Range un résultat dans le niveau mémoire, s'il n'y est pas déjà
+ * @return 1 si la clé était déjà présente, 0 sinon
+ */
+static int rangerMemoire(const struct cleCache *cle, struct imageNB *img)
+{
+    pthread_mutex_lock(&cache.verrou);
+    if (trouver(cle) != NULL)
+    {
+        pthread_mutex_unlock(&cache.verrou);
+        return 1;
+    }
+    size_t octets = reserveCapacite(img->data);
+    struct entreeCache *e = octets <= cache.limite ? calloc(1, sizeof(*e)) : NULL;
+    if (e != NULL)
+    {
+        e->cle = *cle;
+        e->octets = octets;
+        copyImage(img, &e->img);
+        placerEnTete(e);
+        cache.stats.octets += octets;
+        cache.stats.ajouts++;
+        evincer(cache.limite);
+    }
+    pthread_mutex_unlock(&cache.verrou);
+    return 0;
+}
+
+int cacheChercher(const struct cleCache *cle, struct imageNB *dest)
+{
+    pthread_mutex_lock(&cache.verrou);
+    struct entreeCache *e = trouver(cle);
+    if (e != NULL)
+    {
+        detacher(e);
+        placerEnTete(e);
+        copyImage(&e->img, dest);
+        cache.stats.succesMemoire++;
+        pthread_mutex_unlock(&cache.verrou);
+        return 1;
+    }
+    char fichier[CACHE_CHEMIN];
+    int disque = cache.dossier != NULL && chemin(cle, fichier, sizeof(fichier)) == 0;
+    pthread_mutex_unlock(&cache.verrou);
+
+    // Niveau disque, sans le verrou : la lecture peut être longue
+    int trouve = 0;
+    if (disque && access(fichier, R_OK) == 0)
+    {
+        struct traceZone zone;
+        traceOuvrir(&zone, "cache read");
+        // Lu à part : dest n'est remplacée que par un fichier complet
+        struct fluxPGM flux;
+        struct imageNB lu = {0};
+        if (ouvrirFluxPGM(&flux, fichier) == 0)
+        {
+            trouve = lireBandePGM(&flux, &lu, 0, flux.height) == 0;
+            lu.vmax = flux.vmax;
+            fermerFluxPGM(&flux);
+        }
+        if (trouve)
+        {
+            copyImage(&lu, dest);
+        }
+        freeImageMemory(&lu);
+        traceFermer(&zone);
+    }
+    if (trouve)
+    {
+        rangerMemoire(cle, dest);
+    }
+
+    pthread_mutex_lock(&cache.verrou);
+    if (trouve)
+    {
+        cache.stats.succesDisque++;
+    }
+    else
+    {
+        cache.stats.echecs++;
+    }
+    pthread_mutex_unlock(&cache.verrou);
+    return trouve;
+}
+
+void cacheAjouter(const struct cleCache *cle, struct imageNB *img)
+{
+    if (img->data == NULL || rangerMemoire(cle, img))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&cache.verrou);
+    char fichier[CACHE_CHEMIN];
+    int disque = cache.dossier != NULL && chemin(cle, fichier, sizeof(fichier)) == 0;
+    pthread_mutex_unlock(&cache.verrou);
+    if (!disque || access(fichier, F_OK) == 0)
+    {
+        return;
+    }
+
+    // Écrit sous un nom propre à ce processus et à cet appel, puis renomme d'un coup : un
+    // autre processus ne lit jamais un fichier incomplet
+    struct traceZone zone;
+    traceOuvrir(&zone, "cache write");
+    char temporaire[CACHE_CHEMIN + 32];
+    snprintf(temporaire, sizeof(temporaire), "%s.%d.%u.tmp", fichier, (int)getpid(),
+             atomic_fetch_add(&cache.temporaires, 1));
+    struct fluxPGM flux;
+    if (creerFluxPGM(&flux, temporaire, img->width, img->height) == 0)
+    {
+        int resultat = ecrireBandePGM(&flux, img, 0, img->height);
+        if (fermerFluxPGM(&flux) != 0 || resultat != 0 || rename(temporaire, fichier) != 0)
+        {
+            unlink(temporaire);
+        }
+    }
+    traceFermer(&zone);
+}
+
+void cacheStats(struct statsCache *stats)
+{
+    pthread_mutex_lock(&cache.verrou);
+    *stats = cache.stats;
+    pthread_mutex_unlock(&cache.verrou);
+}
+
+void cacheAfficherStats(FILE *sortie)
+{
+    struct statsCache s;
+    cacheStats(&s);
+    fprintf(sortie, "Result cache: %llu hits (%llu memory, %llu disk), %llu misses, %.1f MB in memory\n",
+            (unsigned long long)(s.succesMemoire + s.succesDisque), (unsigned long long)s.succesMemoire,
+            (unsigned long long)s.succesDisque, (unsigned long long)s.echecs, s.octets / (1024.0 * 1024.0));
+}
+
+void cacheDesactiver(void)
+{
+    pthread_mutex_lock(&cache.verrou);
+    evincer(0);
+    free(cache.dossier);
+    cache.dossier = NULL;
+    cache.limite = 0;
+    pthread_mutex_unlock(&cache.verrou);
+}
@@ -0,0 +1,110 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+/**
+ * Taille par défaut du niveau mémoire du cache (IMAGE_CACHE, en Mo, la remplace)
+ */
+#define CACHE_MEMOIRE_DEFAUT ((size_t)64 << 20)
+
+/**
+ * Cache des résultats, adressé par leur contenu
+ *
+ * Un résultat est rangé sous une clé de 128 bits calculée à partir des pixels de l'image
+ * d'entrée (hachés en parallèle, par bandes de lignes), de sa taille et d'une recette qui
+ * décrit l'opération et ses paramètres (par exemple "sobel:1 seuillage:128"). Le niveau
+ * mémoire garde les résultats les plus récemment utilisés dans une limite d'octets ; il
+ * partage les pixels avec les images (copyImage), sans copie ni à l'ajout ni à la lecture.
+ * Le niveau disque, facultatif, garde chaque résultat dans un fichier .pgm nommé d'après
+ * sa clé, écrit sous un nom temporaire puis renommé : plusieurs processus peuvent partager
+ * le même dossier.
+ */
+struct cleCache
+{
+    uint64_t h[2];
+};
+
+/**
+ * Compteurs du cache depuis son activation
+ */
+struct statsCache
+{
+    uint64_t succesMemoire;
+    uint64_t succesDisque;
+    uint64_t echecs;
+    uint64_t ajouts;
+    uint64_t evictions;
+    size_t octets; // occupés par le niveau mémoire
+};
+
+/**
+ * Fonction qui active le cache
+ * @param octets limite du niveau mémoire (0 le désactive)
+ * @param dossier dossier du niveau disque, créé s'il n'existe pas (NULL pour s'en passer)
+ * @return 0 si le cache est prêt, -1 sinon
+ */
+int cacheActiver(size_t octets, const char *dossier);
+
+/**
+ * Fonction qui renvoie la limite du niveau mémoire demandée par IMAGE_CACHE (en Mo), ou
+ * CACHE_MEMOIRE_DEFAUT
+ * @return
+ */
+size_t cacheMemoireDefaut(void);
+
+/**
+ * Fonction qui indique si l'un des deux niveaux du cache est actif
+ * @return
+ */
+int cacheActif(void);
+
+/**
+ * Fonction qui calcule la clé du résultat d'une recette appliquée à une image
+ * Pour une vue, la bordure (le voisinage lu par les filtres) est hachée avec les pixels.
+ * @param img
+ * @param recette
+ * @param cle
+ */
+void cacheCle(const struct imageNB *img, const char *recette, struct cleCache *cle);
+
+/**
+ * Fonction qui cherche un résultat, en mémoire puis sur disque
+ * Un résultat trouvé sur disque est aussi rangé en mémoire.
+ * @param cle
+ * @param dest image initialisée, qui reçoit le résultat (ses pixels sont partagés avec le cache)
+ * @return 1 si le résultat a été trouvé, 0 sinon
+ */
+int cacheChercher(const struct cleCache *cle, struct imageNB *dest);
+
+/**
+ * Fonction qui range un résultat dans les deux niveaux
+ * Les pixels sont partagés, pas copiés : une modification ultérieure de img lui en donne
+ * ses propres pixels (voir modifierImage), le cache garde les siens.
+ * @param cle
+ * @param img
+ */
+void cacheAjouter(const struct cleCache *cle, struct imageNB *img);
+
+/**
+ * Fonction qui renvoie les compteurs du cache
+ * @param stats
+ */
+void cacheStats(struct statsCache *stats);
+
+/**
+ * Fonction qui affiche les compteurs du cache sur une ligne
+ * @param sortie
+ */
+void cacheAfficherStats(FILE *sortie);
+
+/**
+ * Fonction qui vide le niveau mémoire et désactive le cache
+ */
+void cacheDesactiver(void);
+
+#endif
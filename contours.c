@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "contours.h"
+#include "simd.h"
+#include "parallele.h"
+
+/*
+ * Décomposition séparable du filtre de Sobel, pour les lignes r0, r1, r2 (y-1, y, y+1) :
+ *   gx = (r0[x+1] - r0[x-1]) + 2 (r1[x+1] - r1[x-1]) + (r2[x+1] - r2[x-1])
+ *   gy = (r2[x-1] - r0[x-1]) + 2 (r2[x] - r0[x]) + (r2[x+1] - r0[x+1])
+ * Les termes nuls du noyau 3x3 ne sont jamais calculés. |gx| et |gy| <= 1020 : tout tient
+ * sur 16 bits, sauf gx² + gy² qui est calculé en 32 bits pour la norme L2.
+ */
+
+/**
+ * tan(22,5°) en virgule fixe 0.16 ; tan(67,5°) = 2 + tan(22,5°)
+ */
+#define TAN_22_5 27146
+
+/**
+ * Quantifie la direction du gradient sans trigonométrie, avec exactement les mêmes
+ * seuils entiers que les versions SIMD
+ */
+static unsigned char quantifierDirection(int gx, int gy)
+{
+    int ax = abs(gx);
+    int ay = abs(gy);
+    int t1 = (ax * TAN_22_5) >> 16;
+    if (ay <= t1)
+    {
+        return DIRECTION_0;
+    }
+    if (ay >= 2 * ax + t1)
+    {
+        return DIRECTION_90;
+    }
+    return ((gx ^ gy) >= 0) ? DIRECTION_45 : DIRECTION_135;
+}
+
+static unsigned char magnitudeScalaire(int gx, int gy, enum normeGradient norme)
+{
+    int m;
+    if (norme == NORME_L2)
+    {
+        m = (int)(sqrtf((float)(gx * gx + gy * gy)) + 0.5f);
+    }
+    else
+    {
+        m = abs(gx) + abs(gy);
+    }
+    return (m > 255) ? 255 : (unsigned char)m;
+}
+
+/**
+ * Version scalaire, utilisée pour la fin des lignes et sans SIMD
+ */
+static void sobelLigneScalaire(const unsigned char *r0, const unsigned char *r1, const unsigned char *r2,
+                               unsigned char *mag, unsigned char *dir, int x, int n,
+                               enum normeGradient norme)
+{
+    for (; x < n; x++)
+    {
+        int gx = (r0[x + 1] - r0[x - 1]) + 2 * (r1[x + 1] - r1[x - 1]) + (r2[x + 1] - r2[x - 1]);
+        int gy = (r2[x - 1] - r0[x - 1]) + 2 * (r2[x] - r0[x]) + (r2[x + 1] - r0[x + 1]);
+        if (mag != NULL)
+        {
+            mag[x] = magnitudeScalaire(gx, gy, norme);
+        }
+        if (dir != NULL)
+        {
+            dir[x] = quantifierDirection(gx, gy);
+        }
+    }
+}
+
+#ifdef SIMD_X86
+/**
+ * 8 pixels par itération en SSE2
+ */
+static int sobelLigneSSE2(const unsigned char *r0, const unsigned char *r1, const unsigned char *r2,
+                          unsigned char *mag, unsigned char *dir, int n, enum normeGradient norme)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+    for (; x + 8 <= n; x += 8)
+    {
+#define CHARGER(r, d) _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)((r) + x + (d))), zero)
+        __m128i a0 = CHARGER(r0, -1), b0 = CHARGER(r0, 0), c0 = CHARGER(r0, 1);
+        __m128i a1 = CHARGER(r1, -1), c1 = CHARGER(r1, 1);
+        __m128i a2 = CHARGER(r2, -1), b2 = CHARGER(r2, 0), c2 = CHARGER(r2, 1);
+#undef CHARGER
+
+        __m128i d1 = _mm_sub_epi16(c1, a1);
+        __m128i gx = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(c0, a0), _mm_sub_epi16(c2, a2)), _mm_add_epi16(d1, d1));
+        __m128i db = _mm_sub_epi16(b2, b0);
+        __m128i gy = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(a2, a0), _mm_sub_epi16(c2, c0)), _mm_add_epi16(db, db));
+
+        __m128i ax = _mm_max_epi16(gx, _mm_sub_epi16(zero, gx));
+        __m128i ay = _mm_max_epi16(gy, _mm_sub_epi16(zero, gy));
+
+        if (dir != NULL)
+        {
+            // Même arbre de décision que quantifierDirection, sans branchement
+            __m128i t1 = _mm_mulhi_epu16(ax, _mm_set1_epi16(TAN_22_5));
+            __m128i t2 = _mm_add_epi16(_mm_add_epi16(ax, ax), t1);
+            __m128i pas0 = _mm_cmpgt_epi16(ay, t1);
+            __m128i pas90 = _mm_cmpgt_epi16(t2, ay);
+            __m128i oppose = _mm_srai_epi16(_mm_xor_si128(gx, gy), 15);
+            __m128i diag = _mm_or_si128(_mm_set1_epi16(DIRECTION_45), _mm_and_si128(oppose, _mm_set1_epi16(2)));
+            __m128i code = _mm_or_si128(_mm_and_si128(pas90, diag), _mm_andnot_si128(pas90, _mm_set1_epi16(DIRECTION_90)));
+            code = _mm_and_si128(pas0, code);
+            _mm_storel_epi64((__m128i *)(dir + x), _mm_packus_epi16(code, code));
+        }
+        if (mag == NULL)
+        {
+            continue;
+        }
+
+        __m128i m;
+        if (norme == NORME_L2)
+        {
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(gx, gy), _mm_unpacklo_epi16(gx, gy));
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(gx, gy), _mm_unpackhi_epi16(gx, gy));
+            lo = _mm_cvtps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(lo)));
+            hi = _mm_cvtps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(hi)));
+            m = _mm_packs_epi32(lo, hi);
+        }
+        else
+        {
+            m = _mm_adds_epi16(ax, ay);
+        }
+        _mm_storel_epi64((__m128i *)(mag + x), _mm_packus_epi16(m, m));
+    }
+    return x;
+}
+
+/**
+ * 16 pixels par itération en AVX2
+ */
+CIBLE_AVX2 static int sobelLigneAVX2(const unsigned char *r0, const unsigned char *r1, const unsigned char *r2,
+                                     unsigned char *mag, unsigned char *dir, int n,
+                                     enum normeGradient norme)
+{
+    int x = 0;
+    for (; x + 16 <= n; x += 16)
+    {
+#define CHARGER(r, d) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)((r) + x + (d))))
+        __m256i a0 = CHARGER(r0, -1), b0 = CHARGER(r0, 0), c0 = CHARGER(r0, 1);
+        __m256i a1 = CHARGER(r1, -1), c1 = CHARGER(r1, 1);
+        __m256i a2 = CHARGER(r2, -1), b2 = CHARGER(r2, 0), c2 = CHARGER(r2, 1);
+#undef CHARGER
+
+        __m256i d1 = _mm256_sub_epi16(c1, a1);
+        __m256i gx = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(c0, a0), _mm256_sub_epi16(c2, a2)),
+                                      _mm256_add_epi16(d1, d1));
+        __m256i db = _mm256_sub_epi16(b2, b0);
+        __m256i gy = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(a2, a0), _mm256_sub_epi16(c2, c0)),
+                                      _mm256_add_epi16(db, db));
+
+        __m256i ax = _mm256_abs_epi16(gx);
+        __m256i ay = _mm256_abs_epi16(gy);
+
+        if (dir != NULL)
+        {
+            __m256i t1 = _mm256_mulhi_epu16(ax, _mm256_set1_epi16(TAN_22_5));
+            __m256i t2 = _mm256_add_epi16(_mm256_add_epi16(ax, ax), t1);
+            __m256i pas0 = _mm256_cmpgt_epi16(ay, t1);
+            __m256i pas90 = _mm256_cmpgt_epi16(t2, ay);
+            __m256i oppose = _mm256_srai_epi16(_mm256_xor_si256(gx, gy), 15);
+            __m256i diag = _mm256_or_si256(_mm256_set1_epi16(DIRECTION_45), _mm256_and_si256(oppose, _mm256_set1_epi16(2)));
+            __m256i code = _mm256_blendv_epi8(_mm256_set1_epi16(DIRECTION_90), diag, pas90);
+            code = _mm256_and_si256(pas0, code);
+            __m256i codes = _mm256_permute4x64_epi64(_mm256_packus_epi16(code, code), 0xD8);
+            _mm_storeu_si128((__m128i *)(dir + x), _mm256_castsi256_si128(codes));
+        }
+        if (mag == NULL)
+        {
+            continue;
+        }
+
+        __m256i m;
+        if (norme == NORME_L2)
+        {
+            // unpack/pack travaillent par demi-registre : l'ordre des pixels est conservé
+            __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi16(gx, gy), _mm256_unpacklo_epi16(gx, gy));
+            __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi16(gx, gy), _mm256_unpackhi_epi16(gx, gy));
+            lo = _mm256_cvtps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(lo)));
+            hi = _mm256_cvtps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(hi)));
+            m = _mm256_packs_epi32(lo, hi);
+        }
+        else
+        {
+            m = _mm256_adds_epi16(ax, ay);
+        }
+        __m256i octets = _mm256_permute4x64_epi64(_mm256_packus_epi16(m, m), 0xD8);
+        _mm_storeu_si128((__m128i *)(mag + x), _mm256_castsi256_si128(octets));
+    }
+    return x;
+}
+#endif
+
+void sobelGradientTuile(const struct imageNB *img, struct imageNB *magnitude, struct imageNB *direction,
+                        enum normeGradient norme, int x0, int y0, int x1, int y1)
+{
+    int n = x1 - x0;
+
+#ifdef SIMD_X86
+    int avx2 = cpuAVX2();
+#endif
+
+    for (int y = y0; y < y1; y++)
+    {
+        const unsigned char *r0 = imageRow(img, y - 1) + x0;
+        const unsigned char *r1 = imageRow(img, y) + x0;
+        const unsigned char *r2 = imageRow(img, y + 1) + x0;
+        unsigned char *mag = magnitude != NULL ? imageRow(magnitude, y) + x0 : NULL;
+        unsigned char *dir = direction != NULL ? imageRow(direction, y) + x0 : NULL;
+        int x = 0;
+
+#ifdef SIMD_X86
+        x = avx2 ? sobelLigneAVX2(r0, r1, r2, mag, dir, n, norme)
+                 : sobelLigneSSE2(r0, r1, r2, mag, dir, n, norme);
+#endif
+        sobelLigneScalaire(r0, r1, r2, mag, dir, x, n, norme);
+    }
+}
+
+struct contexteSobel
+{
+    const struct imageNB *img;
+    struct imageNB *magnitude;
+    struct imageNB *direction;
+    enum normeGradient norme;
+};
+
+static int tuileSobel(const struct tuile *t, void *arg)
+{
+    struct contexteSobel *ctx = arg;
+    sobelGradientTuile(ctx->img, ctx->magnitude, ctx->direction, ctx->norme, t->x0, t->y0, t->x1, t->y1);
+    return 0;
+}
+
+int sobelGradient(struct imageNB *img, struct imageNB *magnitude, struct imageNB *direction, enum normeGradient norme)
+{
+    if (img->border < 1)
+    {
+        printf("sobelGradient needs an image with a border\n");
+        return -1;
+    }
+    if (magnitude != NULL)
+    {
+        if (reallocImage(magnitude, img->width, img->height) != 0)
+        {
+            return -1;
+        }
+        magnitude->vmax = 255;
+    }
+    if (direction != NULL)
+    {
+        if (reallocImage(direction, img->width, img->height) != 0)
+        {
+            return -1;
+        }
+        direction->vmax = 255;
+    }
+
+    // La bordure répliquée définit le résultat sur les pixels du bord
+    fillBorder(img);
+
+    struct contexteSobel ctx = {img, magnitude, direction, norme};
+    return executerTuiles(img->width, img->height, 1, tuileSobel, &ctx);
+}
@@ -0,0 +1,54 @@
+#ifndef _CONTOURS_H_
+#define _CONTOURS_H_
+
+#include "image.h"
+
+/**
+ * Norme utilisée pour la magnitude du gradient
+ */
+enum normeGradient
+{
+    NORME_L1, // |gx| + |gy|
+    NORME_L2  // sqrt(gx² + gy²)
+};
+
+/**
+ * Codes de direction du gradient, quantifiée sur 4 secteurs de 45°
+ */
+enum directionGradient
+{
+    DIRECTION_0 = 0,   // gradient horizontal (contour vertical)
+    DIRECTION_45 = 1,  // gx et gy de même signe
+    DIRECTION_90 = 2,  // gradient vertical (contour horizontal)
+    DIRECTION_135 = 3  // gx et gy de signes opposés
+};
+
+/**
+ * Fonction qui calcule le filtre de Sobel avec la décomposition séparable
+ * [1 2 1] x [-1 0 1], en AVX2 ou SSE2 quand c'est possible
+ * Les bords sont traités en répliquant les pixels du bord (la bordure de img est remplie).
+ * La magnitude est saturée à 255. Le calcul est réparti en tuiles sur tous les threads.
+ * @param img
+ * @param magnitude image de sortie (initialisée), ou NULL
+ * @param direction image de sortie des codes enum directionGradient (initialisée), ou NULL
+ * @param norme
+ * @return 0 si le calcul a réussi, -1 sinon
+ */
+int sobelGradient(struct imageNB *img, struct imageNB *magnitude, struct imageNB *direction, enum normeGradient norme);
+
+/**
+ * Fonction qui calcule le filtre de Sobel sur le rectangle [x0, x1[ x [y0, y1[
+ * Les images de sortie doivent déjà être allouées et la bordure de img remplie.
+ * @param img
+ * @param magnitude
+ * @param direction
+ * @param norme
+ * @param x0
+ * @param y0
+ * @param x1
+ * @param y1
+ */
+void sobelGradientTuile(const struct imageNB *img, struct imageNB *magnitude, struct imageNB *direction,
+                        enum normeGradient norme, int x0, int y0, int x1, int y1);
+
+#endif
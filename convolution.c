@@ -0,0 +1,709 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "convolution.h"
+#include "simd.h"
+#include "fourier.h"
+#include "parallele.h"
+#include "trace.h"
+#include "reserve.h"
+#include "pgm.h"
+
+#define RAYON_MAX (CONVOLUTION_TAILLE_MAX / 2)
+
+/**
+ * Force l'expansion du corps générique dans chaque version spécialisée
+ */
+#define TOUJOURS_EN_LIGNE inline __attribute__((always_inline))
+
+/**
+ * Convolution d'une ligne : lignes[j] pointe sur le pixel 0 de la ligne y + j - hauteur / 2,
+ * tampon a au moins n + CONVOLUTION_TAILLE_MAX entiers
+ */
+typedef void (*ligneConvolution)(const unsigned char *const *lignes, unsigned char *dst, int n, int32_t *tampon);
+
+/**
+ * Un coefficient non nul d'un noyau quelconque
+ */
+struct prise
+{
+    int ligne;
+    int dx;
+    int coef;
+};
+
+struct contexteConvolution
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    int rayonY;
+    ligneConvolution ligne;
+    const struct noyau *k[2];
+    struct prise prises[2][CONVOLUTION_TAILLE_MAX * CONVOLUTION_TAILLE_MAX];
+    int nbPrises[2];
+};
+
+/**
+ * Coût relatif d'un papillon de la transformée de Fourier et d'une multiplication-addition
+ * du calcul direct (mesuré)
+ */
+#define COUT_PAPILLON 7.0
+
+/**
+ * Un coefficient non nul d'un noyau réel, en corrélation
+ */
+struct priseReelle
+{
+    int ligne;
+    int dx;
+    float coef;
+};
+
+struct contexteReel
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    int largeur;
+    int hauteur;
+    const struct priseReelle *prises;
+    int nbPrises;
+    double biais;
+};
+
+static TOUJOURS_EN_LIGNE unsigned char finir(int somme, int decalage, int biais, int absolu)
+{
+    int v = decalage > 0 ? (somme + (1 << (decalage - 1))) >> decalage : somme;
+    if (absolu)
+    {
+        v = v < 0 ? -v : v;
+    }
+    v += biais;
+    return (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+/**
+ * Corps générique d'un noyau plein
+ */
+static TOUJOURS_EN_LIGNE void ligneGenerique(const unsigned char *const *lignes, unsigned char *restrict dst, int n,
+                                             const int *coefs, int largeur, int hauteur, int decalage, int biais,
+                                             int absolu)
+{
+    int r = largeur / 2;
+    for (int x = 0; x < n; x++)
+    {
+        int somme = 0;
+        for (int j = 0; j < hauteur; j++)
+        {
+            for (int i = 0; i < largeur; i++)
+            {
+                somme += coefs[j * largeur + i] * lignes[j][x + i - r];
+            }
+        }
+        dst[x] = finir(somme, decalage, biais, absolu);
+    }
+}
+
+/**
+ * Corps générique d'un noyau séparable colonne x ligne : passe verticale sur les n + 2 r
+ * colonnes voisines, dans tampon, puis passe horizontale
+ */
+static TOUJOURS_EN_LIGNE void ligneSeparable(const unsigned char *const *lignes, unsigned char *restrict dst, int n,
+                                             int32_t *restrict tampon, const int *coefs, int taille, int decalage)
+{
+    int r = taille / 2;
+    for (int x = 0; x < n + 2 * r; x++)
+    {
+        int somme = 0;
+        for (int j = 0; j < taille; j++)
+        {
+            somme += coefs[j] * lignes[j][x - r];
+        }
+        tampon[x] = somme;
+    }
+    for (int x = 0; x < n; x++)
+    {
+        int somme = 0;
+        for (int i = 0; i < taille; i++)
+        {
+            somme += coefs[i] * tampon[x + i];
+        }
+        dst[x] = finir(somme, decalage, 0, 0);
+    }
+}
+
+/**
+ * Version spécialisée d'un noyau plein : nom, côtés, décalage, biais, absolu, coefficients
+ */
+#define NOYAU_PLEIN(nom, largeur, hauteur, decalage, biais, absolu, ...)                                          \
+    static void nom(const unsigned char *const *lignes, unsigned char *dst, int n, int32_t *tampon)               \
+    {                                                                                                             \
+        static const int coefs[(largeur) * (hauteur)] = {__VA_ARGS__};                                            \
+        (void)tampon;                                                                                             \
+        ligneGenerique(lignes, dst, n, coefs, largeur, hauteur, decalage, biais, absolu);                         \
+    }
+
+/**
+ * Version spécialisée d'un noyau séparable symétrique (même vecteur sur les deux axes)
+ */
+#define NOYAU_SEPARABLE(nom, taille, decalage, ...)                                                               \
+    static void nom(const unsigned char *const *lignes, unsigned char *dst, int n, int32_t *tampon)               \
+    {                                                                                                             \
+        static const int coefs[taille] = {__VA_ARGS__};                                                           \
+        ligneSeparable(lignes, dst, n, tampon, coefs, taille, decalage);                                          \
+    }
+
+NOYAU_PLEIN(ligneNettete, 3, 3, 0, 0, 0, 0, -1, 0, -1, 5, -1, 0, -1, 0)
+NOYAU_PLEIN(ligneRelief, 3, 3, 0, 128, 0, -2, -1, 0, -1, 1, 1, 0, 1, 2)
+NOYAU_PLEIN(ligneLaplacien, 3, 3, 0, 0, 1, 0, 1, 0, 1, -4, 1, 0, 1, 0)
+NOYAU_SEPARABLE(ligneGaussien3, 3, 4, 1, 2, 1)
+NOYAU_SEPARABLE(ligneGaussien5, 5, 8, 1, 4, 6, 4, 1)
+
+/**
+ * Les mêmes noyaux, décrits pour convoluer (dans l'ordre de enum noyauPredefini)
+ */
+static const struct noyau predefinis[] = {
+    {3, 3, {0, -1, 0, -1, 5, -1, 0, -1, 0}, 0, 0, 0},
+    {3, 3, {-2, -1, 0, -1, 1, 1, 0, 1, 2}, 0, 128, 0},
+    {3, 3, {0, 1, 0, 1, -4, 1, 0, 1, 0}, 0, 0, 1},
+    {3, 3, {1, 2, 1, 2, 4, 2, 1, 2, 1}, 4, 0, 0},
+    {5, 5, {1, 4, 6, 4, 1, 4, 16, 24, 16, 4, 6, 24, 36, 24, 6, 4, 16, 24, 16, 4, 1, 4, 6, 4, 1}, 8, 0, 0},
+};
+
+static const ligneConvolution specialisees[] = {ligneNettete, ligneRelief, ligneLaplacien, ligneGaussien3,
+                                               ligneGaussien5};
+
+/**
+ * Liste des coefficients non nuls d'un noyau
+ */
+static int listerPrises(const struct noyau *k, struct prise *prises)
+{
+    int nb = 0;
+    for (int j = 0; j < k->hauteur; j++)
+    {
+        for (int i = 0; i < k->largeur; i++)
+        {
+            int c = k->coefs[j * k->largeur + i];
+            if (c != 0)
+            {
+                prises[nb++] = (struct prise){j, i - k->largeur / 2, c};
+            }
+        }
+    }
+    return nb;
+}
+
+/**
+ * Somme de chaque coefficient non nul multiplié par la ligne décalée correspondante
+ */
+static void accumuler(const unsigned char *const *lignes, int32_t *restrict somme, int n, const struct prise *prises,
+                      int nbPrises)
+{
+    for (int x = 0; x < n; x++)
+    {
+        somme[x] = 0;
+    }
+    int p = 0;
+#ifdef SIMD_X86
+    // Deux coefficients à la fois : les pixels des deux lignes sont entrelacés et madd fait
+    // ca * a + cb * b sur 32 bits (les coefficients tiennent sur 16 bits)
+    const __m128i zero = _mm_setzero_si128();
+    for (; p + 1 < nbPrises; p += 2)
+    {
+        const unsigned char *a = lignes[prises[p].ligne] + prises[p].dx;
+        const unsigned char *b = lignes[prises[p + 1].ligne] + prises[p + 1].dx;
+        __m128i c = _mm_set1_epi32((uint16_t)prises[p].coef | ((uint32_t)(uint16_t)prises[p + 1].coef << 16));
+        int x = 0;
+        for (; x + 16 <= n; x += 16)
+        {
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + x));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + x));
+            __m128i lo = _mm_unpacklo_epi8(va, vb);
+            __m128i hi = _mm_unpackhi_epi8(va, vb);
+            __m128i d[4] = {_mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), c),
+                            _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), c),
+                            _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), c),
+                            _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), c)};
+            for (int k = 0; k < 4; k++)
+            {
+                __m128i *s = (__m128i *)(somme + x + 4 * k);
+                _mm_storeu_si128(s, _mm_add_epi32(_mm_loadu_si128(s), d[k]));
+            }
+        }
+        for (; x < n; x++)
+        {
+            somme[x] += prises[p].coef * a[x] + prises[p + 1].coef * b[x];
+        }
+    }
+#endif
+    for (; p < nbPrises; p++)
+    {
+        const unsigned char *restrict src = lignes[prises[p].ligne] + prises[p].dx;
+        int c = prises[p].coef;
+        for (int x = 0; x < n; x++)
+        {
+            somme[x] += c * src[x];
+        }
+    }
+}
+
+static int tuileConvolution(const struct tuile *t, void *arg)
+{
+    const struct contexteConvolution *ctx = arg;
+    const unsigned char *lignes[CONVOLUTION_TAILLE_MAX];
+    int32_t tampons[2][TUILE_LARGEUR_MAX + CONVOLUTION_TAILLE_MAX];
+    int n = t->x1 - t->x0;
+    int hauteur = 2 * ctx->rayonY + 1;
+
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        for (int j = 0; j < hauteur; j++)
+        {
+            lignes[j] = imageRow(ctx->img, y + j - ctx->rayonY) + t->x0;
+        }
+        unsigned char *dst = imageRow(ctx->dest, y) + t->x0;
+
+        if (ctx->ligne != NULL)
+        {
+            ctx->ligne(lignes, dst, n, tampons[0]);
+            continue;
+        }
+
+        // Noyau quelconque (ou paire de noyaux d'un gradient)
+        const struct noyau *k = ctx->k[0];
+        accumuler(lignes, tampons[0], n, ctx->prises[0], ctx->nbPrises[0]);
+        if (ctx->k[1] == NULL)
+        {
+            for (int x = 0; x < n; x++)
+            {
+                dst[x] = finir(tampons[0][x], k->decalage, k->biais, k->absolu);
+            }
+            continue;
+        }
+        accumuler(lignes, tampons[1], n, ctx->prises[1], ctx->nbPrises[1]);
+        for (int x = 0; x < n; x++)
+        {
+            int gx = tampons[0][x], gy = tampons[1][x];
+            int m = (gx < 0 ? -gx : gx) + (gy < 0 ? -gy : gy);
+            dst[x] = (unsigned char)(m > 255 ? 255 : m);
+        }
+    }
+    return 0;
+}
+
+static int noyauValide(const struct noyau *k)
+{
+    if (k == NULL || k->largeur < 1 || k->hauteur < 1 || k->largeur % 2 == 0 || k->hauteur % 2 == 0 ||
+        k->largeur > CONVOLUTION_TAILLE_MAX || k->hauteur > CONVOLUTION_TAILLE_MAX || k->decalage < 0 ||
+        k->decalage > 30)
+    {
+        return 0;
+    }
+    for (int i = 0; i < k->largeur * k->hauteur; i++)
+    {
+        if (k->coefs[i] < INT16_MIN || k->coefs[i] > INT16_MAX)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Prépare dest et la bordure de img, puis lance les tuiles
+ */
+static int executerConvolution(struct imageNB *img, struct imageNB *dest, struct contexteConvolution *ctx, int rayonX)
+{
+    if (img->border < rayonX || img->border < ctx->rayonY)
+    {
+        printf("Convolution kernel larger than the image border\n");
+        return -1;
+    }
+    if (reallocImage(dest, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+
+    // La bordure répliquée définit le résultat sur les pixels du bord
+    fillBorder(img);
+
+    ctx->img = img;
+    ctx->dest = dest;
+    int halo = rayonX > ctx->rayonY ? rayonX : ctx->rayonY;
+    return executerTuiles(img->width, img->height, halo, tuileConvolution, ctx);
+}
+
+const struct noyau *noyauPredefini(enum noyauPredefini noyau)
+{
+    return &predefinis[noyau];
+}
+
+int convoluerPredefini(struct imageNB *img, struct imageNB *dest, enum noyauPredefini noyau)
+{
+    if (img == NULL || img->color == NULL || dest == img || noyau < NOYAU_NETTETE || noyau > NOYAU_GAUSSIEN_5)
+    {
+        printf("Invalid parameters for convoluerPredefini\n");
+        return -1;
+    }
+    struct contexteConvolution ctx = {0};
+    ctx.rayonY = predefinis[noyau].hauteur / 2;
+    ctx.ligne = specialisees[noyau];
+    return executerConvolution(img, dest, &ctx, predefinis[noyau].largeur / 2);
+}
+
+int convoluer(struct imageNB *img, struct imageNB *dest, const struct noyau *k)
+{
+    if (img == NULL || img->color == NULL || dest == img || !noyauValide(k))
+    {
+        // Côtés impairs, CONVOLUTION_TAILLE_MAX au plus
+        printf("Invalid parameters for convoluer (odd sizes, at most %dx%d)\n", CONVOLUTION_TAILLE_MAX,
+               CONVOLUTION_TAILLE_MAX);
+        return -1;
+    }
+    struct contexteConvolution ctx = {0};
+    ctx.rayonY = k->hauteur / 2;
+    ctx.k[0] = k;
+    ctx.nbPrises[0] = listerPrises(k, ctx.prises[0]);
+    return executerConvolution(img, dest, &ctx, k->largeur / 2);
+}
+
+int convoluerGradient(struct imageNB *img, struct imageNB *dest, const struct noyau *kx, const struct noyau *ky)
+{
+    if (img == NULL || img->color == NULL || dest == img || !noyauValide(kx) || !noyauValide(ky) ||
+        kx->hauteur != ky->hauteur)
+    {
+        printf("Invalid parameters for convoluerGradient\n");
+        return -1;
+    }
+    struct contexteConvolution ctx = {0};
+    ctx.rayonY = kx->hauteur / 2;
+    ctx.k[0] = kx;
+    ctx.k[1] = ky;
+    ctx.nbPrises[0] = listerPrises(kx, ctx.prises[0]);
+    ctx.nbPrises[1] = listerPrises(ky, ctx.prises[1]);
+    int rayonX = kx->largeur > ky->largeur ? kx->largeur / 2 : ky->largeur / 2;
+    return executerConvolution(img, dest, &ctx, rayonX);
+}
+
+/**
+ * Calcul direct : pour chaque ligne du noyau qui a des coefficients non nuls, la ligne source
+ * (bords répliqués) est convertie en flottants une fois, puis chaque coefficient est ajouté à
+ * toute la ligne d'accumulateurs
+ */
+static int tuileReelle(const struct tuile *t, void *arg)
+{
+    const struct contexteReel *ctx = arg;
+    const struct imageNB *img = ctx->img;
+    int n = t->x1 - t->x0;
+    int x0 = t->x0 - ctx->largeur / 2;
+    float somme[TUILE_LARGEUR_MAX];
+    float ligne[TUILE_LARGEUR_MAX + NOYAU_REEL_TAILLE_MAX];
+
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        memset(somme, 0, (size_t)n * sizeof(float));
+        int chargee = -1;
+        for (int p = 0; p < ctx->nbPrises; p++)
+        {
+            const struct priseReelle *prise = &ctx->prises[p];
+            if (prise->ligne != chargee)
+            {
+                int sy = y + prise->ligne - ctx->hauteur / 2;
+                sy = sy < 0 ? 0 : sy >= img->height ? img->height - 1 : sy;
+                const unsigned char *src = imageRow(img, sy);
+                for (int i = 0; i < n + ctx->largeur - 1; i++)
+                {
+                    int sx = x0 + i;
+                    ligne[i] = src[sx < 0 ? 0 : sx >= img->width ? img->width - 1 : sx];
+                }
+                chargee = prise->ligne;
+            }
+            const float *restrict source = ligne + prise->dx;
+            float *restrict acc = somme;
+            float c = prise->coef;
+            for (int x = 0; x < n; x++)
+            {
+                acc[x] += c * source[x];
+            }
+        }
+
+        unsigned char *dst = imageRow(ctx->dest, y) + t->x0;
+        for (int x = 0; x < n; x++)
+        {
+            dst[x] = arrondirPixel(somme[x] + ctx->biais);
+        }
+    }
+    return 0;
+}
+
+static int convoluerDirect(const struct imageNB *img, struct imageNB *dest, const struct noyauReel *k,
+                           int correlation, int nonNuls)
+{
+    struct priseReelle *prises = reservePrendre((size_t)nonNuls * sizeof(struct priseReelle));
+    if (prises == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    // Coefficients en corrélation (retournés pour une convolution), par ligne du noyau
+    int nb = 0;
+    int total = k->largeur * k->hauteur;
+    for (int i = 0; i < total; i++)
+    {
+        double c = correlation ? k->coefs[i] : k->coefs[total - 1 - i];
+        if (c != 0)
+        {
+            prises[nb++] = (struct priseReelle){i / k->largeur, i % k->largeur, (float)c};
+        }
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "direct convolution");
+    struct contexteReel ctx = {img, dest, k->largeur, k->hauteur, prises, nb, k->biais};
+    int halo = k->largeur > k->hauteur ? k->largeur / 2 : k->hauteur / 2;
+    int resultat = executerTuiles(img->width, img->height, halo, tuileReelle, &ctx);
+    traceFermer(&zone);
+    reserveRendre(prises);
+    return resultat;
+}
+
+int convoluerReel(struct imageNB *img, struct imageNB *dest, const struct noyauReel *k, int correlation,
+                  enum methodeConvolution methode)
+{
+    if (img == NULL || img->color == NULL || dest == img || k == NULL || k->coefs == NULL || k->largeur < 1 ||
+        k->hauteur < 1 || k->largeur % 2 == 0 || k->hauteur % 2 == 0 || k->largeur > NOYAU_REEL_TAILLE_MAX ||
+        k->hauteur > NOYAU_REEL_TAILLE_MAX || methode < METHODE_AUTO || methode > METHODE_FOURIER)
+    {
+        printf("Invalid parameters for convoluerReel\n");
+        return -1;
+    }
+    int nonNuls = 0;
+    for (int i = 0; i < k->largeur * k->hauteur; i++)
+    {
+        nonNuls += k->coefs[i] != 0;
+    }
+
+    // Coûts estimés : une multiplication-addition par coefficient non nul et par pixel, ou les
+    // transformées des blocs de la taille la plus avantageuse
+    int taille = 0;
+    double fourier = coutFourier(img->width, img->height, k->largeur, k->hauteur, &taille);
+    if (methode == METHODE_AUTO)
+    {
+        double direct = (double)img->width * img->height * nonNuls;
+        methode = fourier >= 0 && fourier * COUT_PAPILLON < direct ? METHODE_FOURIER : METHODE_DIRECTE;
+    }
+
+    if (reallocImage(dest, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+    if (nonNuls == 0)
+    {
+        clearImage(dest, arrondirPixel(k->biais));
+        return 0;
+    }
+    if (methode == METHODE_FOURIER)
+    {
+        return convoluerFourier(img, dest, k, correlation, taille);
+    }
+    return convoluerDirect(img, dest, k, correlation, nonNuls);
+}
+
+uint64_t empreinteCoefs(const double *coefs, size_t nb)
+{
+    // FNV-1a sur les octets des coefficients
+    const unsigned char *octets = (const unsigned char *)coefs;
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < nb * sizeof(double); i++)
+    {
+        h = (h ^ octets[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static int coteNoyauValide(double cote)
+{
+    return cote >= 1 && cote <= NOYAU_REEL_TAILLE_MAX && cote == (int)cote && (int)cote % 2 == 1;
+}
+
+/**
+ * Noyau normalisé d'après les pixels d'une image .pgm
+ */
+static int chargerMotif(const char *nomFichier, struct noyauReel *k)
+{
+    struct fluxPGM flux;
+    if (ouvrirFluxPGM(&flux, nomFichier) != 0)
+    {
+        return -1;
+    }
+    if (!coteNoyauValide(flux.width) || !coteNoyauValide(flux.height))
+    {
+        printf("Invalid kernel file: %s (odd sizes, at most %d)\n", nomFichier, NOYAU_REEL_TAILLE_MAX);
+        fermerFluxPGM(&flux);
+        return -1;
+    }
+    struct imageNB motif = {0};
+    int resultat = lireRegionPGM(&flux, &motif, 0, 0, flux.width, flux.height);
+    fermerFluxPGM(&flux);
+
+    double *coefs = NULL;
+    if (resultat == 0)
+    {
+        coefs = reservePrendre((size_t)motif.width * motif.height * sizeof(double));
+        if (coefs == NULL)
+        {
+            printf("ERROR allocating memory\n");
+            resultat = -1;
+        }
+    }
+    if (resultat == 0)
+    {
+        double somme = 0;
+        for (int y = 0; y < motif.height; y++)
+        {
+            const unsigned char *src = imageRow(&motif, y);
+            for (int x = 0; x < motif.width; x++)
+            {
+                coefs[y * motif.width + x] = src[x];
+                somme += src[x];
+            }
+        }
+        if (somme == 0)
+        {
+            printf("Invalid kernel file: %s (all pixels are 0)\n", nomFichier);
+            resultat = -1;
+        }
+        for (int i = 0; resultat == 0 && i < motif.width * motif.height; i++)
+        {
+            coefs[i] /= somme;
+        }
+    }
+    if (resultat == 0)
+    {
+        k->largeur = motif.width;
+        k->hauteur = motif.height;
+        k->coefs = coefs;
+    }
+    else
+    {
+        reserveRendre(coefs);
+    }
+    freeImageMemory(&motif);
+    return resultat;
+}
+
+/**
+ * Noyau écrit en texte : largeur, hauteur puis les coefficients
+ */
+static int chargerTexte(const char *nomFichier, struct noyauReel *k)
+{
+    FILE *fichier = fopen(nomFichier, "r");
+    if (fichier == NULL)
+    {
+        printf("--> %s not found \n", nomFichier);
+        return -1;
+    }
+
+    double cotes[2];
+    int nbCotes = 0;
+    double *coefs = NULL;
+    size_t attendus = 0, lus = 0;
+    int resultat = 0;
+    char *ligne = NULL;
+    size_t capacite = 0;
+    while (resultat == 0 && getline(&ligne, &capacite, fichier) != -1)
+    {
+        char *commentaire = strchr(ligne, '#');
+        if (commentaire != NULL)
+        {
+            *commentaire = '\0';
+        }
+        for (char *pos = ligne; resultat == 0;)
+        {
+            while (isspace((unsigned char)*pos))
+            {
+                pos++;
+            }
+            if (*pos == '\0')
+            {
+                break;
+            }
+            char *fin;
+            double valeur = strtod(pos, &fin);
+            if (fin == pos || !isfinite(valeur))
+            {
+                resultat = -1;
+                break;
+            }
+            pos = fin;
+
+            if (nbCotes < 2)
+            {
+                cotes[nbCotes++] = valeur;
+                if (nbCotes == 2)
+                {
+                    if (!coteNoyauValide(cotes[0]) || !coteNoyauValide(cotes[1]))
+                    {
+                        resultat = -1;
+                        break;
+                    }
+                    attendus = (size_t)cotes[0] * (size_t)cotes[1];
+                    coefs = reservePrendre(attendus * sizeof(double));
+                    if (coefs == NULL)
+                    {
+                        printf("ERROR allocating memory\n");
+                        free(ligne);
+                        fclose(fichier);
+                        return -1;
+                    }
+                }
+            }
+            else if (lus < attendus)
+            {
+                coefs[lus++] = valeur;
+            }
+            else
+            {
+                resultat = -1;
+            }
+        }
+    }
+    free(ligne);
+    fclose(fichier);
+
+    if (resultat != 0 || nbCotes < 2 || lus != attendus)
+    {
+        printf("Invalid kernel file: %s (width height, then width x height coefficients; odd sizes, at most %d)\n",
+               nomFichier, NOYAU_REEL_TAILLE_MAX);
+        reserveRendre(coefs);
+        return -1;
+    }
+    k->largeur = (int)cotes[0];
+    k->hauteur = (int)cotes[1];
+    k->coefs = coefs;
+    return 0;
+}
+
+int chargerNoyauReel(const char *nomFichier, struct noyauReel *k)
+{
+    k->coefs = NULL;
+    k->biais = 0;
+    size_t n = strlen(nomFichier);
+    if (n >= 4 && strcasecmp(nomFichier + n - 4, ".pgm") == 0)
+    {
+        return chargerMotif(nomFichier, k);
+    }
+    return chargerTexte(nomFichier, k);
+}
+
+void libererNoyauReel(struct noyauReel *k)
+{
+    reserveRendre((void *)k->coefs);
+    k->coefs = NULL;
+}
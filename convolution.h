@@ -0,0 +1,171 @@
+#ifndef _CONVOLUTION_H_
+#define _CONVOLUTION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+/**
+ * Côté maximal d'un noyau de convolution (impair ; le rayon doit tenir dans la bordure)
+ */
+#define CONVOLUTION_TAILLE_MAX 15
+
+/**
+ * Noyau de convolution à coefficients entiers
+ *
+ * coefs[j * largeur + i], entre -32768 et 32767, multiplie le pixel
+ * (x + i - largeur / 2, y + j - hauteur / 2). La sortie vaut (somme + 2^(decalage - 1))
+ * >> decalage, dont on prend la valeur absolue si `absolu`, plus `biais`, saturée entre 0
+ * et 255.
+ */
+struct noyau
+{
+    int largeur;
+    int hauteur;
+    int coefs[CONVOLUTION_TAILLE_MAX * CONVOLUTION_TAILLE_MAX];
+    int decalage;
+    int biais;
+    int absolu;
+};
+
+/**
+ * Noyaux prédéfinis, compilés chacun en une version spécialisée
+ */
+enum noyauPredefini
+{
+    NOYAU_NETTETE,    // renforcement : 5 au centre, -1 sur les 4 voisins
+    NOYAU_RELIEF,     // estampage diagonal, centré sur 128
+    NOYAU_LAPLACIEN,  // |laplacien| à 4 voisins
+    NOYAU_GAUSSIEN_3, // binomial [1 2 1]² / 16, séparable
+    NOYAU_GAUSSIEN_5  // binomial [1 4 6 4 1]² / 256, séparable
+};
+
+/**
+ * Fonction qui renvoie la description d'un noyau prédéfini
+ * @param noyau
+ * @return
+ */
+const struct noyau *noyauPredefini(enum noyauPredefini noyau);
+
+/**
+ * Fonction qui applique un noyau prédéfini
+ * Chaque noyau a sa propre boucle, obtenue à la compilation à partir d'un même corps
+ * générique : les coefficients étant des constantes, le compilateur déroule les boucles sur
+ * le noyau, supprime les coefficients nuls et vectorise la boucle sur les pixels ; les
+ * noyaux séparables font une passe verticale puis une passe horizontale. Les bords sont
+ * traités en répliquant les pixels du bord. Le calcul est réparti en tuiles sur tous les
+ * threads.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param noyau
+ * @return 0 si la convolution a réussi, -1 sinon
+ */
+int convoluerPredefini(struct imageNB *img, struct imageNB *dest, enum noyauPredefini noyau);
+
+/**
+ * Fonction qui applique un noyau quelconque, de côtés impairs et au plus CONVOLUTION_TAILLE_MAX
+ * Les coefficients nuls sont écartés une fois pour toutes ; chaque coefficient restant est
+ * ajouté à toute une ligne d'accumulateurs, deux coefficients par instruction en SSE2.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param k
+ * @return 0 si la convolution a réussi, -1 sinon
+ */
+int convoluer(struct imageNB *img, struct imageNB *dest, const struct noyau *k);
+
+/**
+ * Fonction qui calcule la norme L1 d'un gradient donné par deux noyaux :
+ * min(|kx * img| + |ky * img|, 255), sans biais ni décalage
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param kx
+ * @param ky
+ * @return 0 si le calcul a réussi, -1 sinon
+ */
+int convoluerGradient(struct imageNB *img, struct imageNB *dest, const struct noyau *kx, const struct noyau *ky);
+
+/**
+ * Côté maximal d'un noyau réel (impair)
+ */
+#define NOYAU_REEL_TAILLE_MAX 511
+
+/**
+ * Noyau de convolution à coefficients réels, de côtés impairs, pour les grands noyaux
+ * (fonctions d'étalement, filtres adaptés)
+ *
+ * coefs[j * largeur + i] est le coefficient (i - largeur / 2, j - hauteur / 2). La sortie
+ * vaut la somme pondérée plus `biais`, arrondie et saturée entre 0 et 255.
+ */
+struct noyauReel
+{
+    int largeur;
+    int hauteur;
+    const double *coefs;
+    double biais;
+};
+
+/**
+ * Fonction qui arrondit une valeur réelle au pixel le plus proche, saturé entre 0 et 255
+ * @param v
+ * @return
+ */
+static inline unsigned char arrondirPixel(double v)
+{
+    return (unsigned char)(v <= 0 ? 0 : v >= 255 ? 255 : (int)(v + 0.5));
+}
+
+/**
+ * Calcul d'une convolution par noyau réel
+ */
+enum methodeConvolution
+{
+    METHODE_AUTO,    // la moins coûteuse des deux, selon les tailles de l'image et du noyau
+    METHODE_DIRECTE, // somme des coefficients non nuls, en flottants
+    METHODE_FOURIER  // produit des spectres, par blocs (voir fourier.h)
+};
+
+/**
+ * Fonction qui applique un noyau réel, en convolution ou en corrélation
+ * En corrélation, le coefficient (i, j) multiplie le pixel (x + i, y + j) (comme
+ * convoluer) ; en convolution, le pixel (x - i, y - j). Les bords sont traités en répliquant
+ * les pixels du bord. Avec METHODE_AUTO, le calcul direct (proportionnel au nombre de
+ * coefficients non nuls) est comparé au calcul par transformée de Fourier (proportionnel à
+ * log de la taille des blocs) ; les deux méthodes donnent le même résultat, à l'arrondi près.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param k
+ * @param correlation 1 pour une corrélation, 0 pour une convolution
+ * @param methode
+ * @return 0 si la convolution a réussi, -1 sinon
+ */
+int convoluerReel(struct imageNB *img, struct imageNB *dest, const struct noyauReel *k, int correlation,
+                  enum methodeConvolution methode);
+
+/**
+ * Fonction qui calcule l'empreinte (FNV-1a) de coefficients réels, pour reconnaître un noyau
+ * @param coefs
+ * @param nb
+ * @return
+ */
+uint64_t empreinteCoefs(const double *coefs, size_t nb);
+
+/**
+ * Fonction qui charge un noyau réel depuis un fichier
+ * Une image .pgm donne un noyau de sa taille, normalisé (somme des coefficients à 1) : en
+ * corrélation, c'est le filtre adapté au motif qu'elle contient. Tout autre fichier est un
+ * texte : la largeur et la hauteur, puis les coefficients ligne par ligne, séparés par des
+ * blancs ; '#' commence un commentaire. Les côtés sont impairs, NOYAU_REEL_TAILLE_MAX au plus.
+ * @param nomFichier
+ * @param k reçoit le noyau, à libérer avec libererNoyauReel
+ * @return 0 si le noyau est valide, -1 sinon
+ */
+int chargerNoyauReel(const char *nomFichier, struct noyauReel *k);
+
+/**
+ * Fonction qui libère les coefficients d'un noyau chargé par chargerNoyauReel
+ * @param k
+ */
+void libererNoyauReel(struct noyauReel *k);
+
+#endif
@@ -0,0 +1,555 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "dallage.h"
+#include "lz.h"
+#include "parallele.h"
+#include "reserve.h"
+#include "trace.h"
+
+#define DALLAGE_MAGIQUE "IMT1"
+
+/**
+ * Nombre de dalles compressées ensemble, en parallèle, avant d'être écrites
+ */
+#define DALLAGE_LOT 64
+
+/**
+ * Erreurs relevées par les tâches de lecture et d'écriture des dalles
+ */
+enum erreurDalle
+{
+    DALLE_OK = 0,
+    DALLE_MEMOIRE,
+    DALLE_LECTURE,
+    DALLE_CORROMPUE
+};
+
+struct contexteEcriture
+{
+    const struct imageNB *img;
+    int cote;
+    int colonnes;
+    int premiere; // première dalle du lot
+    uint8_t *blocs[DALLAGE_LOT];
+    struct entreeDalle *index;
+    atomic_int erreur;
+};
+
+struct contexteLecture
+{
+    struct dallage *d;
+    struct imageNB *img;
+    int x0, y0, x1, y1;
+    int c0, l0;     // première dalle touchée
+    int nbColonnes; // dalles touchées par ligne de dalles
+    atomic_int erreur;
+    atomic_ullong octets;
+};
+
+static void ecrire32(uint8_t *p, uint32_t v)
+{
+    for (int k = 0; k < 4; k++)
+    {
+        p[k] = (uint8_t)(v >> (8 * k));
+    }
+}
+
+static void ecrire64(uint8_t *p, uint64_t v)
+{
+    ecrire32(p, (uint32_t)v);
+    ecrire32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint32_t lire32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t lire64(const uint8_t *p)
+{
+    return lire32(p) | (uint64_t)lire32(p + 4) << 32;
+}
+
+/**
+ * Écrit n octets à la position donnée, en reprenant après les écritures partielles
+ */
+static int ecrireA(int fd, const void *tampon, size_t n, off_t position)
+{
+    const char *p = tampon;
+    while (n > 0)
+    {
+        ssize_t e = pwrite(fd, p, n, position);
+        if (e < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        p += e;
+        n -= (size_t)e;
+        position += e;
+    }
+    return 0;
+}
+
+/**
+ * Lit n octets à la position donnée, en reprenant après les lectures partielles
+ */
+static int lireA(int fd, void *tampon, size_t n, off_t position)
+{
+    char *p = tampon;
+    while (n > 0)
+    {
+        ssize_t e = pread(fd, p, n, position);
+        if (e < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (e <= 0)
+        {
+            return -1;
+        }
+        p += e;
+        n -= (size_t)e;
+        position += e;
+    }
+    return 0;
+}
+
+/**
+ * Rectangle de la dalle (colonne, ligne), rognée à l'image width x height
+ */
+static void rectangleDalle(int colonne, int ligne, int cote, int width, int height, int *x0, int *y0,
+                           int *largeur, int *hauteur)
+{
+    *x0 = colonne * cote;
+    *y0 = ligne * cote;
+    *largeur = width - *x0 < cote ? width - *x0 : cote;
+    *hauteur = height - *y0 < cote ? height - *y0 : cote;
+}
+
+int estNomDallage(const char *nomImage)
+{
+    size_t n = strlen(nomImage);
+    return n >= 4 && strcasecmp(nomImage + n - 4, ".imt") == 0;
+}
+
+/**
+ * Compresse la dalle premiere + k dans ctx->blocs[k] et remplit son entrée (sauf la position)
+ */
+static void compresserDalle(void *arg, int k)
+{
+    struct contexteEcriture *ctx = arg;
+    const struct imageNB *img = ctx->img;
+    int i = ctx->premiere + k;
+    int x0, y0, largeur, hauteur;
+    rectangleDalle(i % ctx->colonnes, i / ctx->colonnes, ctx->cote, img->width, img->height, &x0, &y0, &largeur,
+                   &hauteur);
+
+    size_t n = (size_t)largeur * hauteur;
+    uint8_t *brut = reservePrendre(n);
+    uint8_t *bloc = reservePrendre(n);
+    ctx->blocs[k] = NULL;
+    if (brut == NULL || bloc == NULL)
+    {
+        reserveRendre(brut);
+        reserveRendre(bloc);
+        atomic_store(&ctx->erreur, DALLE_MEMOIRE);
+        return;
+    }
+    for (int y = 0; y < hauteur; y++)
+    {
+        memcpy(brut + (size_t)y * largeur, imageRow(img, y0 + y) + x0, (size_t)largeur);
+    }
+
+    // Une dalle compressée doit gagner au moins un octet, sinon elle reste brute
+    size_t taille = lzCompresser(brut, n, bloc, n - 1);
+    struct entreeDalle *e = &ctx->index[i];
+    if (taille == 0)
+    {
+        ctx->blocs[k] = brut;
+        reserveRendre(bloc);
+        e->taille = (uint32_t)n;
+        e->mode = DALLE_BRUTE;
+    }
+    else
+    {
+        ctx->blocs[k] = bloc;
+        reserveRendre(brut);
+        e->taille = (uint32_t)taille;
+        e->mode = DALLE_LZ;
+    }
+}
+
+int saveDallage(const struct imageNB *img, const char *nomImage, int cote, size_t *octets)
+{
+    cote = cote == 0 ? DALLAGE_COTE_DEFAUT : cote;
+    if (img == NULL || img->color == NULL || cote < DALLAGE_COTE_MIN || cote > DALLAGE_COTE_MAX)
+    {
+        printf("Invalid parameters for saveDallage\n");
+        return -1;
+    }
+    int colonnes = (img->width + cote - 1) / cote;
+    int lignes = (img->height + cote - 1) / cote;
+    size_t nbDalles = (size_t)colonnes * lignes;
+    if (nbDalles > INT_MAX)
+    {
+        printf("Invalid parameters for saveDallage\n");
+        return -1;
+    }
+
+    size_t tailleIndex = DALLAGE_EN_TETE + nbDalles * DALLAGE_ENTREE;
+    struct contexteEcriture ctx = {.img = img, .cote = cote, .colonnes = colonnes};
+    ctx.index = reservePrendre(nbDalles * sizeof(*ctx.index));
+    uint8_t *enTete = reservePrendre(tailleIndex);
+    if (ctx.index == NULL || enTete == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        reserveRendre(ctx.index);
+        reserveRendre(enTete);
+        return -1;
+    }
+    memset(ctx.index, 0, nbDalles * sizeof(*ctx.index));
+    int fd = open(nomImage, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        printf("Unable to create file: %s \n", nomImage);
+        reserveRendre(ctx.index);
+        reserveRendre(enTete);
+        return -1;
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "save tiles");
+    atomic_init(&ctx.erreur, DALLE_OK);
+
+    // Les dalles suivent l'index, écrit en dernier avec l'en-tête
+    int resultat = 0;
+    uint64_t position = tailleIndex;
+    for (int premiere = 0; premiere < (int)nbDalles && resultat == 0; premiere += DALLAGE_LOT)
+    {
+        int nb = (int)nbDalles - premiere < DALLAGE_LOT ? (int)nbDalles - premiere : DALLAGE_LOT;
+        ctx.premiere = premiere;
+        parallelFor(nb, compresserDalle, &ctx);
+        for (int k = 0; k < nb; k++)
+        {
+            struct entreeDalle *e = &ctx.index[premiere + k];
+            if (ctx.blocs[k] == NULL)
+            {
+                resultat = -1;
+                continue;
+            }
+            if (resultat == 0 && ecrireA(fd, ctx.blocs[k], e->taille, (off_t)position) != 0)
+            {
+                resultat = -1;
+            }
+            e->position = position;
+            position += e->taille;
+            reserveRendre(ctx.blocs[k]);
+        }
+    }
+
+    if (resultat == 0)
+    {
+        memcpy(enTete, DALLAGE_MAGIQUE, 4);
+        ecrire32(enTete + 4, (uint32_t)img->width);
+        ecrire32(enTete + 8, (uint32_t)img->height);
+        ecrire32(enTete + 12, (uint32_t)cote);
+        ecrire32(enTete + 16, (uint32_t)img->vmax);
+        ecrire32(enTete + 20, (uint32_t)nbDalles);
+        memset(enTete + 24, 0, DALLAGE_EN_TETE - 24);
+        for (size_t i = 0; i < nbDalles; i++)
+        {
+            uint8_t *p = enTete + DALLAGE_EN_TETE + i * DALLAGE_ENTREE;
+            ecrire64(p, ctx.index[i].position);
+            ecrire32(p + 8, ctx.index[i].taille);
+            ecrire32(p + 12, ctx.index[i].mode);
+        }
+        resultat = ecrireA(fd, enTete, tailleIndex, 0);
+    }
+    if (close(fd) != 0)
+    {
+        resultat = -1;
+    }
+    if (resultat == 0)
+    {
+        traceOctets(0, (size_t)position);
+        *octets = (size_t)position;
+    }
+    traceFermer(&zone);
+
+    if (atomic_load(&ctx.erreur) == DALLE_MEMOIRE)
+    {
+        printf("ERROR allocating memory\n");
+    }
+    else if (resultat != 0)
+    {
+        printf("Unable to write file: %s \n", nomImage);
+    }
+    reserveRendre(ctx.index);
+    reserveRendre(enTete);
+    return resultat;
+}
+
+/**
+ * Vérifie l'en-tête lu et remplit la géométrie de d
+ */
+static int lireEnTete(struct dallage *d, const uint8_t *enTete, const char *nomImage)
+{
+    uint32_t width = lire32(enTete + 4), height = lire32(enTete + 8), cote = lire32(enTete + 12);
+    uint32_t vmax = lire32(enTete + 16), nbDalles = lire32(enTete + 20);
+    if (width == 0 || height == 0 || width > INT_MAX || height > INT_MAX || cote < DALLAGE_COTE_MIN ||
+        cote > DALLAGE_COTE_MAX || vmax == 0 || vmax > 255)
+    {
+        printf("Unsupported IMT header in %s (%u x %u, tile %u, maxval %u)\n", nomImage, width, height, cote, vmax);
+        return -1;
+    }
+    uint64_t colonnes = (width + (uint64_t)cote - 1) / cote;
+    uint64_t lignes = (height + (uint64_t)cote - 1) / cote;
+    if (colonnes * lignes != nbDalles || nbDalles > INT_MAX)
+    {
+        printf("Unsupported IMT header in %s (%u tiles)\n", nomImage, nbDalles);
+        return -1;
+    }
+    d->width = (int)width;
+    d->height = (int)height;
+    d->cote = (int)cote;
+    d->vmax = (int)vmax;
+    d->colonnes = (int)colonnes;
+    d->lignes = (int)lignes;
+    return 0;
+}
+
+/**
+ * Décode l'index et vérifie chaque entrée : dans le fichier, après l'index, et de la taille
+ * de sa dalle pour une dalle brute
+ */
+static int lireIndex(struct dallage *d, const uint8_t *octets, uint64_t debut, uint64_t tailleFichier)
+{
+    for (int i = 0; i < d->colonnes * d->lignes; i++)
+    {
+        const uint8_t *p = octets + (size_t)i * DALLAGE_ENTREE;
+        struct entreeDalle *e = &d->index[i];
+        e->position = lire64(p);
+        e->taille = lire32(p + 8);
+        e->mode = lire32(p + 12);
+
+        int x0, y0, largeur, hauteur;
+        rectangleDalle(i % d->colonnes, i / d->colonnes, d->cote, d->width, d->height, &x0, &y0, &largeur,
+                       &hauteur);
+        if (e->position < debut || e->position > tailleFichier || e->taille > tailleFichier - e->position ||
+            (e->mode != DALLE_BRUTE && e->mode != DALLE_LZ) ||
+            (e->mode == DALLE_BRUTE && e->taille != (uint64_t)largeur * hauteur))
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int ouvrirDallage(struct dallage *d, const char *nomImage)
+{
+    d->index = NULL;
+    d->octetsLus = 0;
+    d->fd = open(nomImage, O_RDONLY);
+    if (d->fd < 0)
+    {
+        printf("--> %s not found \n", nomImage);
+        return -1;
+    }
+
+    uint8_t enTete[DALLAGE_EN_TETE];
+    struct stat st;
+    if (fstat(d->fd, &st) != 0 || lireA(d->fd, enTete, sizeof(enTete), 0) != 0 ||
+        memcmp(enTete, DALLAGE_MAGIQUE, 4) != 0)
+    {
+        printf("Unknown format\n");
+        fermerDallage(d);
+        return -1;
+    }
+    if (lireEnTete(d, enTete, nomImage) != 0)
+    {
+        fermerDallage(d);
+        return -1;
+    }
+
+    size_t nbDalles = (size_t)d->colonnes * d->lignes;
+    uint64_t debut = DALLAGE_EN_TETE + (uint64_t)nbDalles * DALLAGE_ENTREE;
+    if (debut > (uint64_t)st.st_size)
+    {
+        printf("Truncated IMT file: %s\n", nomImage);
+        fermerDallage(d);
+        return -1;
+    }
+    d->index = reservePrendre(nbDalles * sizeof(*d->index));
+    uint8_t *octets = reservePrendre(nbDalles * DALLAGE_ENTREE);
+    if (d->index == NULL || octets == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        reserveRendre(octets);
+        fermerDallage(d);
+        return -1;
+    }
+    int resultat = lireA(d->fd, octets, nbDalles * DALLAGE_ENTREE, DALLAGE_EN_TETE);
+    if (resultat == 0)
+    {
+        resultat = lireIndex(d, octets, debut, (uint64_t)st.st_size);
+    }
+    reserveRendre(octets);
+    if (resultat != 0)
+    {
+        printf("Corrupted IMT index in %s\n", nomImage);
+        fermerDallage(d);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Lit la k-ième dalle touchée par le rectangle et en copie l'intersection dans l'image
+ */
+static void lireDalle(void *arg, int k)
+{
+    struct contexteLecture *ctx = arg;
+    struct dallage *d = ctx->d;
+    int colonne = ctx->c0 + k % ctx->nbColonnes;
+    int ligne = ctx->l0 + k / ctx->nbColonnes;
+    const struct entreeDalle *e = &d->index[(size_t)ligne * d->colonnes + colonne];
+    int dx0, dy0, largeur, hauteur;
+    rectangleDalle(colonne, ligne, d->cote, d->width, d->height, &dx0, &dy0, &largeur, &hauteur);
+
+    size_t n = (size_t)largeur * hauteur;
+    uint8_t *bloc = reservePrendre(e->taille > 0 ? e->taille : 1);
+    uint8_t *pixels = e->mode == DALLE_LZ ? reservePrendre(n) : bloc;
+    enum erreurDalle erreur = DALLE_OK;
+    if (bloc == NULL || pixels == NULL)
+    {
+        erreur = DALLE_MEMOIRE;
+    }
+    else if (lireA(d->fd, bloc, e->taille, (off_t)e->position) != 0)
+    {
+        erreur = DALLE_LECTURE;
+    }
+    else if (e->mode == DALLE_LZ && lzDecompresser(bloc, e->taille, pixels, n) != 0)
+    {
+        erreur = DALLE_CORROMPUE;
+    }
+
+    if (erreur == DALLE_OK)
+    {
+        int ix0 = ctx->x0 > dx0 ? ctx->x0 : dx0;
+        int ix1 = ctx->x1 < dx0 + largeur ? ctx->x1 : dx0 + largeur;
+        int iy0 = ctx->y0 > dy0 ? ctx->y0 : dy0;
+        int iy1 = ctx->y1 < dy0 + hauteur ? ctx->y1 : dy0 + hauteur;
+        for (int y = iy0; y < iy1; y++)
+        {
+            memcpy(imageRow(ctx->img, y - ctx->y0) + (ix0 - ctx->x0),
+                   pixels + (size_t)(y - dy0) * largeur + (ix0 - dx0), (size_t)(ix1 - ix0));
+        }
+        atomic_fetch_add_explicit(&ctx->octets, e->taille, memory_order_relaxed);
+    }
+    else
+    {
+        atomic_store(&ctx->erreur, erreur);
+    }
+    if (pixels != bloc)
+    {
+        reserveRendre(pixels);
+    }
+    reserveRendre(bloc);
+}
+
+int lireRegionDallage(struct dallage *d, struct imageNB *img, int x0, int y0, int x1, int y1)
+{
+    if (x0 < 0 || y0 < 0 || x1 > d->width || y1 > d->height || x1 <= x0 || y1 <= y0)
+    {
+        printf("Invalid parameters for lireRegionDallage\n");
+        return -1;
+    }
+    if (reallocImage(img, x1 - x0, y1 - y0) != 0)
+    {
+        return -1;
+    }
+    img->vmax = d->vmax;
+
+    struct contexteLecture ctx = {.d = d, .img = img, .x0 = x0, .y0 = y0, .x1 = x1, .y1 = y1};
+    ctx.c0 = x0 / d->cote;
+    ctx.l0 = y0 / d->cote;
+    ctx.nbColonnes = (x1 - 1) / d->cote - ctx.c0 + 1;
+    int nbLignes = (y1 - 1) / d->cote - ctx.l0 + 1;
+    atomic_init(&ctx.erreur, DALLE_OK);
+    atomic_init(&ctx.octets, 0);
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "read tiles");
+    parallelFor(ctx.nbColonnes * nbLignes, lireDalle, &ctx);
+    size_t octets = (size_t)atomic_load(&ctx.octets);
+    d->octetsLus += octets;
+    traceOctets(octets, 0);
+    traceFermer(&zone);
+
+    switch (atomic_load(&ctx.erreur))
+    {
+    case DALLE_OK:
+        return 0;
+    case DALLE_MEMOIRE:
+        printf("ERROR allocating memory\n");
+        break;
+    case DALLE_LECTURE:
+        printf("Truncated IMT file\n");
+        break;
+    default:
+        printf("Corrupted IMT tile\n");
+        break;
+    }
+    return -1;
+}
+
+void fermerDallage(struct dallage *d)
+{
+    if (d->fd >= 0)
+    {
+        close(d->fd);
+    }
+    reserveRendre(d->index);
+    d->fd = -1;
+    d->index = NULL;
+}
+
+int loadDallage(struct imageNB *img, const char *nomImage, size_t *octets)
+{
+    img->data = NULL;
+    img->color = NULL;
+
+    struct dallage d;
+    if (ouvrirDallage(&d, nomImage) != 0)
+    {
+        return -1;
+    }
+    struct traceZone zone;
+    traceOuvrir(&zone, "load");
+    int resultat = allocImage(img, d.width, d.height, IMAGE_BORDURE);
+    if (resultat == 0)
+    {
+        resultat = lireRegionDallage(&d, img, 0, 0, d.width, d.height);
+        if (resultat != 0)
+        {
+            freeImageMemory(img);
+        }
+    }
+    traceFermer(&zone);
+    *octets = DALLAGE_EN_TETE + (size_t)d.colonnes * d.lignes * DALLAGE_ENTREE + d.octetsLus;
+    fermerDallage(&d);
+    return resultat;
+}
@@ -0,0 +1,115 @@
+#ifndef _DALLAGE_H_
+#define _DALLAGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+/**
+ * Côtés minimal, par défaut et maximal des dalles, en pixels
+ */
+#define DALLAGE_COTE_MIN 16
+#define DALLAGE_COTE_DEFAUT 256
+#define DALLAGE_COTE_MAX 4096
+
+/**
+ * Image dallée (.imt), le format natif pour les très grandes images
+ *
+ * Le fichier commence par un en-tête de DALLAGE_EN_TETE octets (entiers petit-boutistes) :
+ * "IMT1", largeur, hauteur, côté des dalles, valeur maximale, nombre de dalles, puis 8 octets
+ * réservés. Suit l'index, une entrée de 16 octets par dalle, ligne de dalles par ligne de
+ * dalles : position dans le fichier (64 bits), taille (32 bits), mode (32 bits, 0 pour des
+ * pixels bruts, 1 pour un bloc lzCompresser). Chaque dalle est compressée seule : lire un
+ * rectangle ne lit et ne décompresse que les dalles qu'il touche, en parallèle. Les dalles du
+ * bord droit et du bord bas sont rognées à l'image.
+ */
+#define DALLAGE_EN_TETE 32
+#define DALLAGE_ENTREE 16
+
+enum modeDalle
+{
+    DALLE_BRUTE = 0,
+    DALLE_LZ = 1
+};
+
+struct entreeDalle
+{
+    uint64_t position;
+    uint32_t taille;
+    uint32_t mode;
+};
+
+/**
+ * Image dallée ouverte en lecture : l'en-tête et l'index sont en mémoire, pas les dalles
+ */
+struct dallage
+{
+    int fd;
+    int width;
+    int height;
+    int vmax;
+    int cote;
+    int colonnes; // dalles par ligne
+    int lignes;   // lignes de dalles
+    struct entreeDalle *index;
+    size_t octetsLus; // octets de dalles lus depuis l'ouverture
+};
+
+/**
+ * Fonction qui indique si un nom de fichier désigne une image dallée
+ * @param nomImage
+ * @return 1 si le nom se termine par .imt, 0 sinon
+ */
+int estNomDallage(const char *nomImage);
+
+/**
+ * Fonction pour enregistrer une image dallée
+ * Les dalles sont compressées en parallèle, par lots ; une dalle que la compression
+ * ne rapetisse pas est gardée brute.
+ * @param img
+ * @param nomImage
+ * @param cote côté des dalles (0 pour DALLAGE_COTE_DEFAUT)
+ * @param octets reçoit la taille du fichier
+ * @return 0 si l'enregistrement a réussi, -1 sinon
+ */
+int saveDallage(const struct imageNB *img, const char *nomImage, int cote, size_t *octets);
+
+/**
+ * Fonction qui ouvre une image dallée et lit son en-tête et son index
+ * Les positions et tailles de l'index sont vérifiées contre la taille du fichier.
+ * @param d
+ * @param nomImage
+ * @return 0 si l'ouverture a réussi, -1 sinon
+ */
+int ouvrirDallage(struct dallage *d, const char *nomImage);
+
+/**
+ * Fonction qui lit le rectangle [x0, x1[ x [y0, y1[ dans img, redimensionnée à
+ * (x1 - x0) x (y1 - y0) ; seules les dalles qui le touchent sont lues
+ * @param d
+ * @param img image initialisée
+ * @param x0
+ * @param y0
+ * @param x1
+ * @param y1
+ * @return 0 si la lecture a réussi, -1 sinon
+ */
+int lireRegionDallage(struct dallage *d, struct imageNB *img, int x0, int y0, int x1, int y1);
+
+/**
+ * Fonction qui ferme une image dallée ouverte par ouvrirDallage
+ * @param d
+ */
+void fermerDallage(struct dallage *d);
+
+/**
+ * Fonction pour charger une image dallée entière
+ * @param img
+ * @param nomImage
+ * @param octets reçoit le nombre d'octets lus
+ * @return 0 si le chargement a réussi, -1 sinon
+ */
+int loadDallage(struct imageNB *img, const char *nomImage, size_t *octets);
+
+#endif
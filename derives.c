@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "derives.h"
+#include "reserve.h"
+
+/**
+ * Renvoie les structures dérivées de img, créées vides au premier appel
+ */
+static struct derives *derives(struct imageNB *img)
+{
+    if (img->derives == NULL)
+    {
+        img->derives = reservePrendre(sizeof(struct derives));
+        if (img->derives == NULL)
+        {
+            printf("ERROR allocating memory\n");
+            return NULL;
+        }
+        memset(img->derives, 0, sizeof(struct derives));
+    }
+    return img->derives;
+}
+
+const struct integrale *integraleImage(struct imageNB *img)
+{
+    struct derives *d = derives(img);
+    if (d == NULL)
+    {
+        return NULL;
+    }
+    if (d->integrale.somme == NULL && integraleCalculer(img, &d->integrale) != 0)
+    {
+        return NULL;
+    }
+    return &d->integrale;
+}
+
+const struct integrale *integraleCarresImage(struct imageNB *img)
+{
+    struct derives *d = derives(img);
+    if (d == NULL)
+    {
+        return NULL;
+    }
+    if (d->carres.somme == NULL && integraleCarresCalculer(img, &d->carres) != 0)
+    {
+        return NULL;
+    }
+    return &d->carres;
+}
+
+const struct pyramide *pyramideImage(struct imageNB *img)
+{
+    struct derives *d = derives(img);
+    if (d == NULL)
+    {
+        return NULL;
+    }
+    if (d->pyramide.niveaux == 0 && pyramideCalculer(img, &d->pyramide) != 0)
+    {
+        return NULL;
+    }
+    return &d->pyramide;
+}
+
+void oublierDerives(struct imageNB *img)
+{
+    struct derives *d = img->derives;
+    if (d == NULL)
+    {
+        return;
+    }
+    img->derives = NULL;
+    integraleLiberer(&d->integrale);
+    integraleLiberer(&d->carres);
+    pyramideLiberer(&d->pyramide);
+    reserveRendre(d);
+}
@@ -0,0 +1,51 @@
+#ifndef _DERIVES_H_
+#define _DERIVES_H_
+
+#include "image.h"
+#include "integrale.h"
+#include "echelle.h"
+
+/**
+ * Structures calculées à partir des pixels d'une image et gardées avec elle (img->derives)
+ *
+ * Chacune est construite à la première demande et réutilisée par les suivantes sur la même
+ * image (pixélisations de tailles différentes, réductions successives...), jusqu'à ce que
+ * ses pixels changent : modifierImage, reallocImage et freeImageMemory appellent
+ * oublierDerives. Une même image ne doit pas être interrogée par deux threads à la fois.
+ */
+struct derives
+{
+    struct integrale integrale;
+    struct integrale carres;
+    struct pyramide pyramide;
+};
+
+/**
+ * Fonction qui renvoie la table des sommes d'une image, calculée à la première demande
+ * @param img
+ * @return la table, ou NULL en cas d'erreur
+ */
+const struct integrale *integraleImage(struct imageNB *img);
+
+/**
+ * Fonction qui renvoie la table des sommes des carrés d'une image, calculée à la première
+ * demande
+ * @param img
+ * @return la table, ou NULL en cas d'erreur
+ */
+const struct integrale *integraleCarresImage(struct imageNB *img);
+
+/**
+ * Fonction qui renvoie la pyramide d'une image, calculée à la première demande
+ * @param img
+ * @return la pyramide, ou NULL en cas d'erreur
+ */
+const struct pyramide *pyramideImage(struct imageNB *img);
+
+/**
+ * Fonction qui libère les structures dérivées des pixels d'une image
+ * @param img
+ */
+void oublierDerives(struct imageNB *img);
+
+#endif
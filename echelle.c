@@ -0,0 +1,493 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "echelle.h"
+#include "simd.h"
+#include "parallele.h"
+#include "reserve.h"
+#include "derives.h"
+#include "trace.h"
+
+/*
+ * Chaque pixel de sortie est une combinaison de "taille" pixels source consécutifs à partir
+ * de debut[i]. Les coefficients sont en virgule fixe sur 14 bits, de somme exacte ; les
+ * indices qui sortent de l'image sont ramenés sur le bord dès la construction de la table,
+ * si bien que les passes n'ont aucun test de bord. La table est complétée par des zéros
+ * jusqu'à un multiple de 8 coefficients pour la passe horizontale en SSE2.
+ */
+
+#define BITS_COEF 14
+#define UN_COEF (1 << BITS_COEF)
+
+struct coefficients
+{
+    int taille; // nombre de pixels source par pixel de sortie
+    int pas;    // taille arrondie au multiple de 8 supérieur
+    int *debut;
+    int16_t *poids;
+};
+
+struct contexteEchelle
+{
+    const struct imageNB *src;
+    struct imageNB *dst;
+    const struct coefficients *c;
+};
+
+static double sinc(double x)
+{
+    if (x == 0)
+    {
+        return 1.0;
+    }
+    x *= M_PI;
+    return sin(x) / x;
+}
+
+static double noyau(enum filtreEchelle filtre, double x)
+{
+    x = fabs(x);
+    if (filtre == ECHELLE_BILINEAIRE)
+    {
+        return x < 1.0 ? 1.0 - x : 0.0;
+    }
+    return x < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+}
+
+static void libererCoefficients(struct coefficients *c)
+{
+    reserveRendre(c->debut);
+    reserveRendre(c->poids);
+    c->debut = NULL;
+    c->poids = NULL;
+}
+
+/**
+ * Construit la table d'un axe de n pixels source vers m pixels de sortie
+ * La sortie couvre les `etendue` premiers pixels source (n en général ; moins pour un niveau
+ * de pyramide dont le dernier pixel déborde de l'image d'origine).
+ */
+static int construireCoefficients(struct coefficients *c, int n, double etendue, int m, enum filtreEchelle filtre)
+{
+    double s = etendue / m;
+    if (filtre == ECHELLE_AUTO)
+    {
+        filtre = s > 1.0 ? ECHELLE_MOYENNE : ECHELLE_LANCZOS;
+    }
+
+    double support;
+    if (filtre == ECHELLE_MOYENNE)
+    {
+        support = (s > 1.0 ? s : 1.0) / 2 + 0.5;
+    }
+    else
+    {
+        support = (filtre == ECHELLE_BILINEAIRE ? 1.0 : 3.0) * (s > 1.0 ? s : 1.0);
+    }
+    int tailleMax = 2 * (int)ceil(support) + 1;
+    c->taille = tailleMax < n ? tailleMax : n;
+    c->pas = (c->taille + 7) & ~7;
+    c->debut = reservePrendre((size_t)m * sizeof(int));
+    c->poids = reservePrendre((size_t)m * c->pas * sizeof(int16_t));
+    double *w = reservePrendre((size_t)c->taille * sizeof(double));
+    if (c->debut == NULL || c->poids == NULL || w == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        libererCoefficients(c);
+        reserveRendre(w);
+        return -1;
+    }
+    memset(c->poids, 0, (size_t)m * c->pas * sizeof(int16_t));
+
+    for (int i = 0; i < m; i++)
+    {
+        // Centre du pixel de sortie dans le repère des centres des pixels source
+        double centre = (i + 0.5) * s - 0.5;
+        int premier = (int)floor(centre - support) + 1;
+        int debut = premier < 0 ? 0 : premier;
+        if (debut > n - c->taille)
+        {
+            debut = n - c->taille;
+        }
+        c->debut[i] = debut;
+
+        memset(w, 0, (size_t)c->taille * sizeof(double));
+        double total = 0;
+        for (int k = premier; k < premier + tailleMax; k++)
+        {
+            double poids;
+            if (filtre == ECHELLE_MOYENNE)
+            {
+                // Recouvrement du pixel k avec l'empreinte du pixel de sortie
+                double a = i * s, b = (i + 1) * s;
+                if (s < 1.0)
+                {
+                    a = centre;
+                    b = centre + 1.0;
+                }
+                poids = fmin(b, k + 1.0) - fmax(a, (double)k);
+                poids = poids > 0 ? poids : 0;
+            }
+            else
+            {
+                poids = noyau(filtre, (k - centre) / (s > 1.0 ? s : 1.0));
+            }
+            int indice = k < 0 ? 0 : k >= n ? n - 1 : k;
+            w[indice - debut] += poids;
+            total += poids;
+        }
+
+        // Virgule fixe, le reste de l'arrondi va au plus gros coefficient
+        int16_t *p = c->poids + (size_t)i * c->pas;
+        int somme = 0, plusGros = 0;
+        for (int k = 0; k < c->taille; k++)
+        {
+            p[k] = (int16_t)lround(w[k] / total * UN_COEF);
+            somme += p[k];
+            if (abs(p[k]) > abs(p[plusGros]))
+            {
+                plusGros = k;
+            }
+        }
+        p[plusGros] += (int16_t)(UN_COEF - somme);
+    }
+
+    reserveRendre(w);
+    return 0;
+}
+
+static unsigned char saturer(int v)
+{
+    v = (v + (1 << (BITS_COEF - 1))) >> BITS_COEF;
+    return (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+/**
+ * Passe horizontale sur les lignes [y0, y1[ et les colonnes de sortie [x0, x1[
+ */
+static int tuileHorizontale(const struct tuile *t, void *arg)
+{
+    const struct contexteEchelle *ctx = arg;
+    const struct coefficients *c = ctx->c;
+
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        const unsigned char *src = imageRow(ctx->src, y);
+        unsigned char *dst = imageRow(ctx->dst, y);
+        for (int x = t->x0; x < t->x1; x++)
+        {
+            const unsigned char *s = src + c->debut[x];
+            const int16_t *p = c->poids + (size_t)x * c->pas;
+#ifdef SIMD_X86
+            // Les coefficients de complément sont nuls : lire jusqu'à 7 octets de plus reste
+            // dans la bordure de la ligne
+            __m128i somme = _mm_setzero_si128();
+            for (int k = 0; k < c->pas; k += 8)
+            {
+                __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(s + k)), _mm_setzero_si128());
+                somme = _mm_add_epi32(somme, _mm_madd_epi16(v, _mm_load_si128((const __m128i *)(p + k))));
+            }
+            somme = _mm_add_epi32(somme, _mm_shuffle_epi32(somme, _MM_SHUFFLE(1, 0, 3, 2)));
+            somme = _mm_add_epi32(somme, _mm_shuffle_epi32(somme, _MM_SHUFFLE(2, 3, 0, 1)));
+            dst[x] = saturer(_mm_cvtsi128_si32(somme));
+#else
+            int somme = 0;
+            for (int k = 0; k < c->taille; k++)
+            {
+                somme += s[k] * p[k];
+            }
+            dst[x] = saturer(somme);
+#endif
+        }
+    }
+    return 0;
+}
+
+/**
+ * Passe verticale : chaque ligne de sortie est une combinaison de lignes source entières
+ */
+static int tuileVerticale(const struct tuile *t, void *arg)
+{
+    const struct contexteEchelle *ctx = arg;
+    const struct coefficients *c = ctx->c;
+    const int stride = ctx->src->stride;
+
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        const unsigned char *src = imageRow(ctx->src, c->debut[y]);
+        const int16_t *p = c->poids + (size_t)y * c->pas;
+        unsigned char *dst = imageRow(ctx->dst, y);
+        int x = t->x0;
+#ifdef SIMD_X86
+        // Deux lignes source à la fois : octets entrelacés puis _mm_madd_epi16
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i arrondi = _mm_set1_epi32(1 << (BITS_COEF - 1));
+        for (; x + 16 <= t->x1; x += 16)
+        {
+            __m128i s0 = arrondi, s1 = arrondi, s2 = arrondi, s3 = arrondi;
+            for (int k = 0; k < c->taille; k += 2)
+            {
+                const unsigned char *l0 = src + (size_t)k * stride + x;
+                const unsigned char *l1 = k + 1 < c->taille ? l0 + stride : l0;
+                int16_t p1 = k + 1 < c->taille ? p[k + 1] : 0;
+                __m128i w = _mm_set1_epi32((uint16_t)p[k] | ((uint32_t)(uint16_t)p1 << 16));
+                __m128i a = _mm_loadu_si128((const __m128i *)l0);
+                __m128i b = _mm_loadu_si128((const __m128i *)l1);
+                __m128i lo = _mm_unpacklo_epi8(a, b);
+                __m128i hi = _mm_unpackhi_epi8(a, b);
+                s0 = _mm_add_epi32(s0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), w));
+                s1 = _mm_add_epi32(s1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), w));
+                s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), w));
+                s3 = _mm_add_epi32(s3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), w));
+            }
+            __m128i r0 = _mm_packs_epi32(_mm_srai_epi32(s0, BITS_COEF), _mm_srai_epi32(s1, BITS_COEF));
+            __m128i r1 = _mm_packs_epi32(_mm_srai_epi32(s2, BITS_COEF), _mm_srai_epi32(s3, BITS_COEF));
+            _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(r0, r1));
+        }
+#endif
+        for (; x < t->x1; x++)
+        {
+            int somme = 0;
+            for (int k = 0; k < c->taille; k++)
+            {
+                somme += src[(size_t)k * stride + x] * p[k];
+            }
+            dst[x] = saturer(somme);
+        }
+    }
+    return 0;
+}
+
+static int passe(const struct imageNB *src, struct imageNB *dst, int largeur, int hauteur,
+                 const struct coefficients *c, int (*noyauPasse)(const struct tuile *, void *))
+{
+    if (reallocImage(dst, largeur, hauteur) != 0)
+    {
+        return -1;
+    }
+    dst->vmax = src->vmax;
+    struct contexteEchelle ctx = {src, dst, c};
+    return executerTuiles(largeur, hauteur, 0, noyauPasse, &ctx);
+}
+
+/**
+ * Redimensionne les `etendueX` x `etendueY` premiers pixels de img (voir construireCoefficients)
+ */
+static int redimensionnerEtendue(struct imageNB *img, struct imageNB *dest, int largeur, int hauteur,
+                                 enum filtreEchelle filtre, double etendueX, double etendueY)
+{
+    int w = img->width, h = img->height;
+    struct coefficients cx = {0}, cy = {0};
+    struct imageNB tmp = {0};
+    int resultat = -1;
+
+    int memeLargeur = w == largeur && etendueX == w;
+    int memeHauteur = h == hauteur && etendueY == h;
+    if (memeLargeur && memeHauteur)
+    {
+        copyImage(img, dest);
+        return dest->data != NULL ? 0 : -1;
+    }
+    if (construireCoefficients(&cx, w, etendueX, largeur, filtre) == 0 &&
+        construireCoefficients(&cy, h, etendueY, hauteur, filtre) == 0)
+    {
+        fillBorder(img);
+        if (memeLargeur)
+        {
+            resultat = passe(img, dest, largeur, hauteur, &cy, tuileVerticale);
+        }
+        else if (memeHauteur)
+        {
+            resultat = passe(img, dest, largeur, hauteur, &cx, tuileHorizontale);
+        }
+        else
+        {
+            // Ordre des passes qui fait le moins de multiplications
+            double horizontaleDabord = (double)largeur * ((double)h * cx.taille + (double)hauteur * cy.taille);
+            double verticaleDabord = (double)hauteur * ((double)w * cy.taille + (double)largeur * cx.taille);
+            if (horizontaleDabord <= verticaleDabord)
+            {
+                resultat = passe(img, &tmp, largeur, h, &cx, tuileHorizontale);
+                if (resultat == 0)
+                {
+                    resultat = passe(&tmp, dest, largeur, hauteur, &cy, tuileVerticale);
+                }
+            }
+            else
+            {
+                resultat = passe(img, &tmp, w, hauteur, &cy, tuileVerticale);
+                if (resultat == 0)
+                {
+                    fillBorder(&tmp);
+                    resultat = passe(&tmp, dest, largeur, hauteur, &cx, tuileHorizontale);
+                }
+            }
+        }
+    }
+
+    libererCoefficients(&cx);
+    libererCoefficients(&cy);
+    freeImageMemory(&tmp);
+    return resultat;
+}
+
+int redimensionnerImage(struct imageNB *img, struct imageNB *dest, int largeur, int hauteur,
+                        enum filtreEchelle filtre)
+{
+    if (dest == img || largeur <= 0 || hauteur <= 0 || (double)largeur * hauteur > (double)(1 << 30) ||
+        filtre < ECHELLE_AUTO || filtre > ECHELLE_LANCZOS || img->border < 8)
+    {
+        printf("Invalid parameters for redimensionnerImage\n");
+        return -1;
+    }
+
+    // Forte réduction : départ du plus petit niveau de la pyramide qui garde au moins deux
+    // pixels par pixel de sortie (au-delà, le flou du niveau se voit), puis moyenne des pixels
+    // couverts. Le pixel i du niveau k couvre les pixels [i * 2^k, (i + 1) * 2^k[ de l'image :
+    // l'image y occupe w / 2^k pixels.
+    int w = img->width, h = img->height;
+    if (filtre == ECHELLE_AUTO && 4 * (double)largeur <= w && 4 * (double)hauteur <= h)
+    {
+        const struct pyramide *p = pyramideImage(img);
+        if (p == NULL)
+        {
+            return -1;
+        }
+        int k = 0;
+        while (k < p->niveaux && (w >> (k + 2)) >= largeur && (h >> (k + 2)) >= hauteur)
+        {
+            k++;
+        }
+        if (k > 0)
+        {
+            return redimensionnerEtendue((struct imageNB *)&p->niveau[k - 1], dest, largeur, hauteur, ECHELLE_MOYENNE,
+                                         ldexp(w, -k), ldexp(h, -k));
+        }
+    }
+    return redimensionnerEtendue(img, dest, largeur, hauteur, filtre, w, h);
+}
+
+struct contextePyramide
+{
+    const struct imageNB *src;
+    struct imageNB *dst;
+};
+
+/**
+ * Un niveau de la pyramide : moyenne arrondie de chaque carré de 2 x 2 pixels du niveau
+ * précédent, dont la bordure répète la dernière colonne et la dernière ligne
+ */
+static int tuileReduction(const struct tuile *t, void *arg)
+{
+    const struct contextePyramide *ctx = arg;
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        const unsigned char *l0 = imageRow(ctx->src, 2 * y);
+        const unsigned char *l1 = imageRow(ctx->src, 2 * y + 1);
+        unsigned char *dst = imageRow(ctx->dst, y);
+        int x = t->x0;
+#ifdef SIMD_X86
+        const __m128i pairs = _mm_set1_epi16(0x00ff);
+        const __m128i deux = _mm_set1_epi16(2);
+        for (; x + 16 <= t->x1; x += 16)
+        {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)(l0 + 2 * x));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(l0 + 2 * x + 16));
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(l1 + 2 * x));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(l1 + 2 * x + 16));
+            // Octets pairs + octets impairs des deux lignes, sur 16 bits
+            __m128i sa = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, pairs), _mm_srli_epi16(a0, 8)),
+                                       _mm_add_epi16(_mm_and_si128(a1, pairs), _mm_srli_epi16(a1, 8)));
+            __m128i sb = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(b0, pairs), _mm_srli_epi16(b0, 8)),
+                                       _mm_add_epi16(_mm_and_si128(b1, pairs), _mm_srli_epi16(b1, 8)));
+            sa = _mm_srli_epi16(_mm_add_epi16(sa, deux), 2);
+            sb = _mm_srli_epi16(_mm_add_epi16(sb, deux), 2);
+            _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(sa, sb));
+        }
+#endif
+        for (; x < t->x1; x++)
+        {
+            dst[x] = (unsigned char)((l0[2 * x] + l0[2 * x + 1] + l1[2 * x] + l1[2 * x + 1] + 2) >> 2);
+        }
+    }
+    return 0;
+}
+
+int pyramideCalculer(struct imageNB *img, struct pyramide *p)
+{
+    p->niveaux = 0;
+    if (img == NULL || img->color == NULL || img->border < 1)
+    {
+        printf("Invalid parameters for pyramideCalculer\n");
+        return -1;
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "pyramid");
+    struct imageNB *src = img;
+    int resultat = 0;
+    while ((src->width > 1 || src->height > 1) && p->niveaux < PYRAMIDE_NIVEAUX && resultat == 0)
+    {
+        struct imageNB *dst = &p->niveau[p->niveaux];
+        *dst = (struct imageNB){0};
+        int largeur = (src->width + 1) / 2;
+        int hauteur = (src->height + 1) / 2;
+        fillBorder(src);
+        resultat = reallocImage(dst, largeur, hauteur);
+        if (resultat == 0)
+        {
+            dst->vmax = img->vmax;
+            struct contextePyramide ctx = {src, dst};
+            resultat = executerTuiles(largeur, hauteur, 0, tuileReduction, &ctx);
+        }
+        p->niveaux++;
+        src = dst;
+    }
+    traceFermer(&zone);
+
+    if (resultat != 0)
+    {
+        pyramideLiberer(p);
+        return -1;
+    }
+    fillBorder(src);
+    return 0;
+}
+
+void pyramideLiberer(struct pyramide *p)
+{
+    for (int k = 0; k < p->niveaux; k++)
+    {
+        freeImageMemory(&p->niveau[k]);
+    }
+    p->niveaux = 0;
+}
+
+int vignette(struct imageNB *img, struct imageNB *dest, int cote)
+{
+    if (img == NULL || img->color == NULL || dest == img || cote < 1)
+    {
+        printf("Invalid parameters for vignette\n");
+        return -1;
+    }
+    if (img->width <= cote && img->height <= cote)
+    {
+        copyImage(img, dest);
+        return dest->data != NULL ? 0 : -1;
+    }
+
+    // Le plus grand côté devient `cote`, l'autre garde la proportion (au moins un pixel)
+    int largeur = cote, hauteur = cote;
+    if (img->width >= img->height)
+    {
+        hauteur = (int)((double)img->height * cote / img->width + 0.5);
+    }
+    else
+    {
+        largeur = (int)((double)img->width * cote / img->height + 0.5);
+    }
+    return redimensionnerImage(img, dest, largeur > 0 ? largeur : 1, hauteur > 0 ? hauteur : 1, ECHELLE_AUTO);
+}
@@ -0,0 +1,80 @@
+#ifndef _ECHELLE_H_
+#define _ECHELLE_H_
+
+#include "image.h"
+
+/**
+ * Filtre de rééchantillonnage
+ */
+enum filtreEchelle
+{
+    ECHELLE_AUTO,       // moyenne sur les axes réduits, Lanczos sur les axes agrandis
+    ECHELLE_MOYENNE,    // moyenne des pixels couverts, pondérée par la surface
+    ECHELLE_BILINEAIRE, // filtre triangle
+    ECHELLE_LANCZOS     // Lanczos à 3 lobes
+};
+
+/**
+ * Nombre maximal de niveaux d'une pyramide (une image de 2^24 pixels de côté)
+ */
+#define PYRAMIDE_NIVEAUX 24
+
+/**
+ * Pyramide d'images (mipmap)
+ *
+ * niveau[k] est l'image réduite de moitié k + 1 fois : chaque pixel est la moyenne arrondie
+ * de quatre pixels du niveau précédent, les dimensions impaires étant arrondies au-dessus
+ * (la dernière ligne ou colonne est répétée). Le dernier niveau fait 1 x 1 pixel.
+ */
+struct pyramide
+{
+    int niveaux;
+    struct imageNB niveau[PYRAMIDE_NIVEAUX];
+};
+
+/**
+ * Fonction qui redimensionne une image à une taille quelconque
+ * Le filtre est séparable : une passe horizontale puis une passe verticale (ou l'inverse,
+ * selon l'ordre le moins coûteux), chacune avec une table de coefficients calculée une fois
+ * par axe. En réduction, le filtre est élargi au facteur de réduction pour éviter le
+ * repliement. Les bords sont traités en répliquant les pixels du bord. Le calcul est réparti
+ * en tuiles sur tous les threads.
+ * Avec ECHELLE_AUTO, une réduction d'un facteur 4 ou plus sur les deux axes part du plus
+ * petit niveau de la pyramide de img (voir pyramideImage) qui a encore au moins deux pixels
+ * par pixel de sortie : la pyramide est construite une fois et sert aux réductions
+ * suivantes de la même image.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param largeur
+ * @param hauteur
+ * @param filtre
+ * @return 0 si le redimensionnement a réussi, -1 sinon
+ */
+int redimensionnerImage(struct imageNB *img, struct imageNB *dest, int largeur, int hauteur,
+                        enum filtreEchelle filtre);
+
+/**
+ * Fonction qui construit la pyramide d'une image
+ * @param img
+ * @param p pyramide à libérer avec pyramideLiberer
+ * @return 0 si la pyramide est prête, -1 sinon
+ */
+int pyramideCalculer(struct imageNB *img, struct pyramide *p);
+
+/**
+ * Fonction qui libère une pyramide
+ * @param p
+ */
+void pyramideLiberer(struct pyramide *p);
+
+/**
+ * Fonction qui réduit une image pour qu'elle tienne dans un carré, en gardant ses
+ * proportions (une image déjà assez petite est copiée)
+ * @param img
+ * @param dest image initialisée, différente de img
+ * @param cote
+ * @return 0 si la vignette est prête, -1 sinon
+ */
+int vignette(struct imageNB *img, struct imageNB *dest, int cote);
+
+#endif
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "flou.h"
+#include "simd.h"
+#include "parallele.h"
+#include "reserve.h"
+
+/*
+ * Flou boîte en deux passes, sans division par pixel :
+ *  - passe verticale : une somme par colonne, mise à jour à chaque ligne en ajoutant la
+ *    ligne qui entre et en retirant celle qui sort (boucle sur x, vectorisée par le compilateur) ;
+ *  - passe horizontale : sommes cumulées des sommes de colonnes (seule boucle séquentielle,
+ *    une addition par pixel), puis une différence par pixel, elle aussi vectorisée.
+ * Les sommes restent entières jusqu'au bout (au plus 255 * 255² pour FLOU_RAYON_MAX, moins
+ * de 2^24) et sont divisées une seule fois par un multiplicateur flottant. Comme la taille de
+ * la boîte est impaire, l'arrondi au plus proche est exact en simple précision.
+ */
+
+static int borner(int v, int min, int max)
+{
+    return (v < min) ? min : (v > max) ? max : v;
+}
+
+/**
+ * Passe verticale : somme[x] += entre[x] - sort[x]
+ */
+static void majColonnes(uint32_t *somme, const unsigned char *entre, const unsigned char *sort, int w)
+{
+    int x = 0;
+#ifdef SIMD_X86
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= w; x += 16)
+    {
+        __m128i e = _mm_loadu_si128((const __m128i *)(entre + x));
+        __m128i s = _mm_loadu_si128((const __m128i *)(sort + x));
+        // Différences sur 16 bits signés, puis extension sur 32 bits
+        __m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(e, zero), _mm_unpacklo_epi8(s, zero));
+        __m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(e, zero), _mm_unpackhi_epi8(s, zero));
+        __m128i d[4] = {_mm_srai_epi32(_mm_unpacklo_epi16(dlo, dlo), 16), _mm_srai_epi32(_mm_unpackhi_epi16(dlo, dlo), 16),
+                        _mm_srai_epi32(_mm_unpacklo_epi16(dhi, dhi), 16), _mm_srai_epi32(_mm_unpackhi_epi16(dhi, dhi), 16)};
+        for (int k = 0; k < 4; k++)
+        {
+            __m128i *p = (__m128i *)(somme + x + 4 * k);
+            _mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), d[k]));
+        }
+    }
+#endif
+    for (; x < w; x++)
+    {
+        somme[x] += entre[x] - sort[x];
+    }
+}
+
+/**
+ * Passe horizontale : dst[x] = arrondi((cumul[x + taille] - cumul[x]) * inverse)
+ */
+static void ecrireMoyennes(unsigned char *dst, const uint32_t *cumul, int taille, float inverse, int w)
+{
+    int x = 0;
+#ifdef SIMD_X86
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 inv = _mm_set1_ps(inverse);
+    const __m128 demi = _mm_set1_ps(0.5f);
+    for (; x + 8 <= w; x += 8)
+    {
+        __m128i s0 = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(cumul + x + taille)),
+                                   _mm_loadu_si128((const __m128i *)(cumul + x)));
+        __m128i s1 = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(cumul + x + 4 + taille)),
+                                   _mm_loadu_si128((const __m128i *)(cumul + x + 4)));
+        __m128i m0 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(s0), inv), demi));
+        __m128i m1 = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(s1), inv), demi));
+        __m128i m = _mm_packs_epi32(m0, m1);
+        _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(m, zero));
+    }
+#endif
+    for (; x < w; x++)
+    {
+        int32_t s = (int32_t)(cumul[x + taille] - cumul[x]);
+        dst[x] = (unsigned char)((float)s * inverse + 0.5f);
+    }
+}
+
+int flouBoiteTuile(const struct imageNB *img, struct imageNB *dest, int rayon, int x0, int y0, int x1, int y1)
+{
+    int w = img->width;
+    int h = img->height;
+    int taille = 2 * rayon + 1;
+    float inverse = 1.0f / ((float)taille * (float)taille);
+
+    // Sommes des colonnes x0 - rayon à x1 + rayon ; seules les colonnes réelles [a, b[ sont
+    // calculées, les autres répliquent celles du bord
+    int largeur = (x1 - x0) + 2 * rayon;
+    int a = x0 - rayon > 0 ? x0 - rayon : 0;
+    int b = x1 + rayon < w ? x1 + rayon : w;
+    int n = b - a;
+
+    // Les sommes cumulées suivent les sommes de colonnes (les dépassements de 32 bits
+    // s'annulent dans les différences)
+    uint32_t *colonnes = reservePrendre((2 * (size_t)largeur + 1) * sizeof(uint32_t));
+    if (colonnes == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    uint32_t *somme = colonnes + (a - (x0 - rayon));
+    uint32_t *cumul = colonnes + largeur;
+    int avant = a - (x0 - rayon);
+    int apres = (x1 + rayon) - b;
+
+    // Initialisation pour la ligne y0 : lignes y0 - rayon à y0 + rayon (bornées)
+    for (int x = 0; x < n; x++)
+    {
+        somme[x] = 0;
+    }
+    for (int k = -rayon; k <= rayon; k++)
+    {
+        const unsigned char *ligne = imageRow(img, borner(y0 + k, 0, h - 1)) + a;
+        for (int x = 0; x < n; x++)
+        {
+            somme[x] += ligne[x];
+        }
+    }
+
+    for (int y = y0; y < y1; y++)
+    {
+        if (y > y0)
+        {
+            const unsigned char *entre = imageRow(img, borner(y + rayon, 0, h - 1)) + a;
+            const unsigned char *sort = imageRow(img, borner(y - rayon - 1, 0, h - 1)) + a;
+            majColonnes(somme, entre, sort, n);
+        }
+
+        for (int i = 1; i <= avant; i++)
+        {
+            somme[-i] = somme[0];
+        }
+        for (int i = 0; i < apres; i++)
+        {
+            somme[n + i] = somme[n - 1];
+        }
+
+        cumul[0] = 0;
+        for (int i = 0; i < largeur; i++)
+        {
+            cumul[i + 1] = cumul[i] + colonnes[i];
+        }
+
+        ecrireMoyennes(imageRow(dest, y) + x0, cumul, taille, inverse, x1 - x0);
+    }
+
+    reserveRendre(colonnes);
+    return 0;
+}
+
+struct contexteFlou
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    int rayon;
+};
+
+static int tuileFlou(const struct tuile *t, void *arg)
+{
+    struct contexteFlou *ctx = arg;
+    return flouBoiteTuile(ctx->img, ctx->dest, ctx->rayon, t->x0, t->y0, t->x1, t->y1);
+}
+
+int flouBoite(struct imageNB *img, struct imageNB *dest, int rayon)
+{
+    // Au-delà de FLOU_RAYON_MAX, les sommes ne sont plus exactes en simple précision
+    if (rayon < 0 || rayon > FLOU_RAYON_MAX || dest == img)
+    {
+        printf("Invalid parameters for flouBoite (radius at most %d)\n", FLOU_RAYON_MAX);
+        return -1;
+    }
+    if (reallocImage(dest, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+
+    struct contexteFlou ctx = {img, dest, rayon};
+    return executerTuiles(img->width, img->height, rayon, tuileFlou, &ctx);
+}
+
+void rayonsGaussiens(double sigma, int n, int *rayons)
+{
+    // Tailles de boîtes idéales (Kovesi) : m boîtes de taille wl, les autres de taille wl + 2
+    double ideale = sqrt(12.0 * sigma * sigma / n + 1.0);
+    int wl = (int)floor(ideale);
+    if (wl % 2 == 0)
+    {
+        wl--;
+    }
+    if (wl < 1)
+    {
+        wl = 1;
+    }
+    int wu = wl + 2;
+    int m = (int)lround((12.0 * sigma * sigma - n * wl * wl - 4.0 * n * wl - 3.0 * n) / (-4.0 * wl - 4.0));
+
+    for (int i = 0; i < n; i++)
+    {
+        rayons[i] = ((i < m ? wl : wu) - 1) / 2;
+    }
+}
+
+int flouGaussien(struct imageNB *img, struct imageNB *dest, double sigma)
+{
+    if (sigma <= 0 || sigma > FLOU_RAYON_MAX || dest == img)
+    {
+        printf("Invalid parameters for flouGaussien (sigma at most %d)\n", FLOU_RAYON_MAX);
+        return -1;
+    }
+
+    int rayons[FLOU_PASSES_GAUSS];
+    rayonsGaussiens(sigma, FLOU_PASSES_GAUSS, rayons);
+
+    // Passes alternées entre dest et une image temporaire, la dernière dans dest
+    struct imageNB tmp = {0};
+    struct imageNB *source = img;
+    int resultat = 0;
+    for (int i = 0; i < FLOU_PASSES_GAUSS && resultat == 0; i++)
+    {
+        struct imageNB *cible = ((FLOU_PASSES_GAUSS - 1 - i) % 2 == 0) ? dest : &tmp;
+        resultat = flouBoite(source, cible, rayons[i]);
+        source = cible;
+    }
+
+    freeImageMemory(&tmp);
+    return resultat;
+}
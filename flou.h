@@ -0,0 +1,61 @@
+#ifndef _FLOU_H_
+#define _FLOU_H_
+
+#include "image.h"
+
+/**
+ * Nombre de passes de flou boîte utilisées pour approcher un flou gaussien
+ */
+#define FLOU_PASSES_GAUSS 3
+
+/**
+ * Rayon maximal d'un flou boîte : la somme d'une boîte (au plus 255 * 255²) reste exacte
+ * en simple précision, donc l'arrondi de la moyenne aussi
+ */
+#define FLOU_RAYON_MAX 127
+
+/**
+ * Fonction qui applique un flou boîte de taille (2 * rayon + 1)² à une image
+ * Le coût par pixel ne dépend pas du rayon (sommes glissantes). Les bords sont traités
+ * en répliquant les pixels du bord, quel que soit le rayon. Le calcul est réparti en tuiles
+ * sur tous les threads.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param rayon entre 0 et FLOU_RAYON_MAX
+ * @return 0 si le flou a réussi, -1 sinon
+ */
+int flouBoite(struct imageNB *img, struct imageNB *dest, int rayon);
+
+/**
+ * Fonction qui applique le flou boîte sur le rectangle [x0, x1[ x [y0, y1[
+ * dest doit déjà être allouée aux dimensions de img.
+ * @param img
+ * @param dest
+ * @param rayon entre 0 et FLOU_RAYON_MAX
+ * @param x0
+ * @param y0
+ * @param x1
+ * @param y1
+ * @return 0 si le flou a réussi, -1 sinon
+ */
+int flouBoiteTuile(const struct imageNB *img, struct imageNB *dest, int rayon, int x0, int y0, int x1, int y1);
+
+/**
+ * Fonction qui calcule les rayons de n flous boîte successifs équivalents à un flou
+ * gaussien d'écart-type sigma
+ * @param sigma
+ * @param n
+ * @param rayons tableau de n rayons
+ */
+void rayonsGaussiens(double sigma, int n, int *rayons);
+
+/**
+ * Fonction qui applique un flou gaussien approché par FLOU_PASSES_GAUSS flous boîte
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param sigma au plus FLOU_RAYON_MAX (chaque passe a un rayon proche de sigma)
+ * @return 0 si le flou a réussi, -1 sinon
+ */
+int flouGaussien(struct imageNB *img, struct imageNB *dest, double sigma);
+
+#endif
@@ -0,0 +1,587 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "fourier.h"
+#include "parallele.h"
+#include "reserve.h"
+#include "trace.h"
+
+/**
+ * Spectre d'un noyau pour une taille de bloc, gardé en cache
+ *
+ * re et im ont (n / 2 + 1) x n valeurs : la colonne k du demi-spectre des lignes commence à
+ * l'indice k * n. Le facteur 1 / (4 n²) des transformées non normalisées y est inclus.
+ */
+struct spectre
+{
+    int n;
+    int largeur;
+    int hauteur;
+    uint64_t empreinte;
+    double *coefs;
+    double *re;
+    double *im;
+    int utilisateurs;
+    int enCache;
+    unsigned long usage;
+};
+
+struct contexteFourier
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    const struct planFourier *plan;
+    const struct spectre *noyau;
+    int rayonX;
+    int rayonY;
+    int sortieX;
+    int sortieY;
+    int colonnes;
+    double biais;
+    atomic_int erreur;
+};
+
+static pthread_mutex_t verrouPlans = PTHREAD_MUTEX_INITIALIZER;
+static struct planFourier *plans[32];
+
+static pthread_mutex_t verrouSpectres = PTHREAD_MUTEX_INITIALIZER;
+static struct spectre *spectres[FOURIER_SPECTRES];
+static unsigned long horloge;
+
+static int log2Entier(int n)
+{
+    int l = 0;
+    while ((1 << l) < n)
+    {
+        l++;
+    }
+    return l;
+}
+
+static void libererPlan(struct planFourier *p)
+{
+    if (p != NULL)
+    {
+        free(p->permutation);
+        free(p->cosinus);
+        free(p->sinus);
+        free(p);
+    }
+}
+
+static struct planFourier *construirePlan(int n)
+{
+    struct planFourier *p = calloc(1, sizeof(*p));
+    if (p == NULL)
+    {
+        return NULL;
+    }
+    p->n = n;
+    p->permutation = malloc((size_t)n * sizeof(int));
+    p->cosinus = malloc((size_t)n * sizeof(double));
+    p->sinus = malloc((size_t)n * sizeof(double));
+    if (p->permutation == NULL || p->cosinus == NULL || p->sinus == NULL)
+    {
+        libererPlan(p);
+        return NULL;
+    }
+
+    int bits = log2Entier(n);
+    for (int i = 0; i < n; i++)
+    {
+        int r = 0;
+        for (int b = 0; b < bits; b++)
+        {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        p->permutation[i] = r;
+    }
+    // Étage de demi-taille m : exp(-i pi k / m) pour k de 0 à m - 1, à l'indice m - 1 + k
+    for (int m = 1; m < n; m *= 2)
+    {
+        for (int k = 0; k < m; k++)
+        {
+            p->cosinus[m - 1 + k] = cos(M_PI * k / m);
+            p->sinus[m - 1 + k] = -sin(M_PI * k / m);
+        }
+    }
+    return p;
+}
+
+const struct planFourier *planFourier(int n)
+{
+    if (n < 2 || n > FOURIER_TAILLE_MAX || (n & (n - 1)) != 0)
+    {
+        printf("Invalid parameters for planFourier\n");
+        return NULL;
+    }
+    int l = log2Entier(n);
+    pthread_mutex_lock(&verrouPlans);
+    if (plans[l] == NULL)
+    {
+        plans[l] = construirePlan(n);
+    }
+    const struct planFourier *p = plans[l];
+    pthread_mutex_unlock(&verrouPlans);
+    if (p == NULL)
+    {
+        printf("ERROR allocating memory\n");
+    }
+    return p;
+}
+
+/**
+ * Papillons d'un étage : (a, b) devient (a + w b, a - w b)
+ */
+static void papillons(double *restrict ar, double *restrict ai, double *restrict br, double *restrict bi,
+                      const double *restrict wr, const double *restrict wi, int m)
+{
+    for (int k = 0; k < m; k++)
+    {
+        double tr = wr[k] * br[k] - wi[k] * bi[k];
+        double ti = wr[k] * bi[k] + wi[k] * br[k];
+        br[k] = ar[k] - tr;
+        bi[k] = ai[k] - ti;
+        ar[k] += tr;
+        ai[k] += ti;
+    }
+}
+
+void transformerFourier(const struct planFourier *p, double *re, double *im)
+{
+    int n = p->n;
+    for (int i = 0; i < n; i++)
+    {
+        int j = p->permutation[i];
+        if (i < j)
+        {
+            double t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    // Deux premiers étages réunis (rotations 1 et -i, sans multiplication), puis les étages de
+    // demi-taille 4, 8, ...
+    if (n == 2)
+    {
+        double tr = re[1], ti = im[1];
+        re[1] = re[0] - tr;
+        im[1] = im[0] - ti;
+        re[0] += tr;
+        im[0] += ti;
+        return;
+    }
+    for (int a = 0; a < n; a += 4)
+    {
+        double r0 = re[a] + re[a + 1], i0 = im[a] + im[a + 1];
+        double r1 = re[a] - re[a + 1], i1 = im[a] - im[a + 1];
+        double r2 = re[a + 2] + re[a + 3], i2 = im[a + 2] + im[a + 3];
+        double r3 = re[a + 2] - re[a + 3], i3 = im[a + 2] - im[a + 3];
+        re[a] = r0 + r2;
+        im[a] = i0 + i2;
+        re[a + 2] = r0 - r2;
+        im[a + 2] = i0 - i2;
+        re[a + 1] = r1 + i3;
+        im[a + 1] = i1 - r3;
+        re[a + 3] = r1 - i3;
+        im[a + 3] = i1 + r3;
+    }
+    for (int m = 4; m < n; m *= 2)
+    {
+        for (int debut = 0; debut < n; debut += 2 * m)
+        {
+            papillons(re + debut, im + debut, re + debut + m, im + debut + m, p->cosinus + m - 1, p->sinus + m - 1,
+                      m);
+        }
+    }
+}
+
+/**
+ * Transforme deux lignes réelles a et b d'un bloc, données dans za et zb, en une seule
+ * transformée de z = a + i b, et range 2 A et 2 B (k de 0 à n / 2) aux lignes y et y + 1
+ * du demi-spectre
+ */
+static void spectreLignes(const struct planFourier *p, double *za, double *zb, int y, double *re, double *im)
+{
+    int n = p->n;
+    transformerFourier(p, za, zb);
+    for (int k = 0; k <= n / 2; k++)
+    {
+        // A[k] = (Z[k] + conj(Z[n - k])) / 2, B[k] = (Z[k] - conj(Z[n - k])) / 2i
+        int m = (n - k) & (n - 1);
+        double *r = re + (size_t)k * n + y;
+        double *i = im + (size_t)k * n + y;
+        r[0] = za[k] + za[m];
+        i[0] = zb[k] - zb[m];
+        r[1] = zb[k] + zb[m];
+        i[1] = za[m] - za[k];
+    }
+}
+
+/**
+ * Transformée (directe, ou inverse si `inverse`) des colonnes du demi-spectre
+ */
+static void spectreColonnes(const struct planFourier *p, double *re, double *im, int inverse)
+{
+    int n = p->n;
+    for (int k = 0; k <= n / 2; k++)
+    {
+        double *r = re + (size_t)k * n;
+        double *i = im + (size_t)k * n;
+        if (inverse)
+        {
+            transformerFourier(p, i, r);
+        }
+        else
+        {
+            transformerFourier(p, r, i);
+        }
+    }
+}
+
+/**
+ * Reconstruit les lignes spatiales y et y + 1 (dans za et zb) à partir de leurs demi-spectres,
+ * la symétrie hermitienne donnant les fréquences n / 2 + 1 à n - 1
+ */
+static void lignesSpatiales(const struct planFourier *p, const double *re, const double *im, int y, double *za,
+                            double *zb)
+{
+    int n = p->n;
+    for (int k = 0; k <= n / 2; k++)
+    {
+        const double *r = re + (size_t)k * n + y;
+        const double *i = im + (size_t)k * n + y;
+        // Z[k] = A[k] + i B[k], Z[n - k] = conj(A[k]) + i conj(B[k])
+        za[k] = r[0] - i[1];
+        zb[k] = i[0] + r[1];
+        if (k > 0 && k < n / 2)
+        {
+            za[n - k] = r[0] + i[1];
+            zb[n - k] = r[1] - i[0];
+        }
+    }
+    transformerFourier(p, zb, za);
+}
+
+static void libererSpectre(struct spectre *s)
+{
+    if (s != NULL)
+    {
+        reserveRendre(s->coefs);
+        reserveRendre(s->re);
+        reserveRendre(s->im);
+        reserveRendre(s);
+    }
+}
+
+static int memeSpectre(const struct spectre *s, int n, int largeur, int hauteur, uint64_t h, const double *coefs)
+{
+    return s != NULL && s->n == n && s->largeur == largeur && s->hauteur == hauteur && s->empreinte == h &&
+           memcmp(s->coefs, coefs, (size_t)largeur * hauteur * sizeof(double)) == 0;
+}
+
+/**
+ * Calcule le spectre du noyau (coefs en corrélation) placé en (-i, -j) modulo n : la
+ * convolution circulaire d'un bloc par ce noyau est la corrélation du bloc
+ */
+static struct spectre *calculerSpectre(const struct planFourier *p, int largeur, int hauteur, uint64_t h,
+                                       const double *coefs)
+{
+    int n = p->n;
+    size_t taille = (size_t)(n / 2 + 1) * n;
+    struct spectre *s = reservePrendre(sizeof(*s));
+    double *za = reservePrendre(2 * (size_t)n * sizeof(double));
+    if (s == NULL || za == NULL)
+    {
+        reserveRendre(s);
+        reserveRendre(za);
+        return NULL;
+    }
+    memset(s, 0, sizeof(*s));
+    s->n = n;
+    s->largeur = largeur;
+    s->hauteur = hauteur;
+    s->empreinte = h;
+    s->coefs = reservePrendre((size_t)largeur * hauteur * sizeof(double));
+    s->re = reservePrendre(taille * sizeof(double));
+    s->im = reservePrendre(taille * sizeof(double));
+    if (s->coefs == NULL || s->re == NULL || s->im == NULL)
+    {
+        libererSpectre(s);
+        reserveRendre(za);
+        return NULL;
+    }
+    memcpy(s->coefs, coefs, (size_t)largeur * hauteur * sizeof(double));
+
+    double *zb = za + n;
+    for (int y = 0; y < n; y += 2)
+    {
+        double *lignes[2] = {za, zb};
+        for (int l = 0; l < 2; l++)
+        {
+            memset(lignes[l], 0, (size_t)n * sizeof(double));
+            int j = (n - (y + l)) & (n - 1);
+            if (j < hauteur)
+            {
+                for (int i = 0; i < largeur; i++)
+                {
+                    lignes[l][(n - i) & (n - 1)] = coefs[j * largeur + i];
+                }
+            }
+        }
+        spectreLignes(p, za, zb, y, s->re, s->im);
+    }
+    spectreColonnes(p, s->re, s->im, 0);
+
+    double echelle = 1.0 / (4.0 * n * n);
+    for (size_t i = 0; i < taille; i++)
+    {
+        s->re[i] *= echelle;
+        s->im[i] *= echelle;
+    }
+    reserveRendre(za);
+    return s;
+}
+
+/**
+ * Renvoie le spectre du noyau pour la taille du plan, depuis le cache ou calculé ; à rendre
+ * avec rendreSpectre
+ */
+static struct spectre *obtenirSpectre(const struct planFourier *p, int largeur, int hauteur, const double *coefs)
+{
+    uint64_t h = empreinteCoefs(coefs, (size_t)largeur * hauteur);
+    pthread_mutex_lock(&verrouSpectres);
+    for (int i = 0; i < FOURIER_SPECTRES; i++)
+    {
+        if (memeSpectre(spectres[i], p->n, largeur, hauteur, h, coefs))
+        {
+            struct spectre *s = spectres[i];
+            s->utilisateurs++;
+            s->usage = ++horloge;
+            pthread_mutex_unlock(&verrouSpectres);
+            return s;
+        }
+    }
+    pthread_mutex_unlock(&verrouSpectres);
+
+    // Calcul hors du verrou ; la place libre ou la moins récemment utilisée est reprise
+    struct spectre *s = calculerSpectre(p, largeur, hauteur, h, coefs);
+    if (s == NULL)
+    {
+        return NULL;
+    }
+    s->utilisateurs = 1;
+    pthread_mutex_lock(&verrouSpectres);
+    int place = -1;
+    for (int i = 0; i < FOURIER_SPECTRES; i++)
+    {
+        if (spectres[i] == NULL)
+        {
+            place = i;
+            break;
+        }
+        if (spectres[i]->utilisateurs == 0 && (place < 0 || spectres[i]->usage < spectres[place]->usage))
+        {
+            place = i;
+        }
+    }
+    if (place >= 0)
+    {
+        libererSpectre(spectres[place]);
+        spectres[place] = s;
+        s->enCache = 1;
+        s->usage = ++horloge;
+    }
+    pthread_mutex_unlock(&verrouSpectres);
+    return s;
+}
+
+static void rendreSpectre(struct spectre *s)
+{
+    pthread_mutex_lock(&verrouSpectres);
+    s->utilisateurs--;
+    int liberer = !s->enCache && s->utilisateurs == 0;
+    pthread_mutex_unlock(&verrouSpectres);
+    if (liberer)
+    {
+        libererSpectre(s);
+    }
+}
+
+double coutFourier(int largeur, int hauteur, int largeurNoyau, int hauteurNoyau, int *taille)
+{
+    double meilleur = -1;
+    for (int n = FOURIER_TAILLE_MIN; n <= FOURIER_TAILLE_MAX; n *= 2)
+    {
+        int sortieX = n - largeurNoyau + 1;
+        int sortieY = n - hauteurNoyau + 1;
+        if (sortieX < 1 || sortieY < 1)
+        {
+            continue;
+        }
+        double blocs = (double)((largeur + sortieX - 1) / sortieX) * ((hauteur + sortieY - 1) / sortieY);
+        // Transformées directe et inverse (n² log2(n) papillons en tout) et produit des spectres
+        double cout = blocs * ((double)n * n * log2Entier(n) + (double)n * n / 2);
+        if (meilleur < 0 || cout < meilleur)
+        {
+            meilleur = cout;
+            *taille = n;
+        }
+    }
+    return meilleur;
+}
+
+/**
+ * Ligne y du bloc dont le premier pixel de sortie est (bx, by) : pixels source décalés du
+ * rayon du noyau, répliqués hors de l'image
+ */
+static void lireLigne(const struct contexteFourier *ctx, int bx, int by, int y, double *ligne)
+{
+    const struct imageNB *img = ctx->img;
+    int n = ctx->plan->n;
+    int sy = by + y - ctx->rayonY;
+    sy = sy < 0 ? 0 : sy >= img->height ? img->height - 1 : sy;
+    const unsigned char *src = imageRow(img, sy);
+
+    int x0 = bx - ctx->rayonX;
+    int debut = x0 < 0 ? (-x0 < n ? -x0 : n) : 0;
+    int fin = img->width - x0 < n ? img->width - x0 : n;
+    fin = fin > debut ? fin : debut;
+    int x = 0;
+    for (; x < debut; x++)
+    {
+        ligne[x] = src[0];
+    }
+    for (; x < fin; x++)
+    {
+        ligne[x] = src[x0 + x];
+    }
+    for (; x < n; x++)
+    {
+        ligne[x] = src[img->width - 1];
+    }
+}
+
+static void tacheBloc(void *arg, int indice)
+{
+    struct contexteFourier *ctx = arg;
+    const struct planFourier *p = ctx->plan;
+    int n = p->n;
+    size_t taille = (size_t)(n / 2 + 1) * n;
+    double *tampon = reservePrendre((2 * taille + 2 * (size_t)n) * sizeof(double));
+    if (tampon == NULL)
+    {
+        atomic_store(&ctx->erreur, 1);
+        return;
+    }
+    double *re = tampon, *im = re + taille, *za = im + taille, *zb = za + n;
+    int bx = (indice % ctx->colonnes) * ctx->sortieX;
+    int by = (indice / ctx->colonnes) * ctx->sortieY;
+
+    for (int y = 0; y < n; y += 2)
+    {
+        lireLigne(ctx, bx, by, y, za);
+        lireLigne(ctx, bx, by, y + 1, zb);
+        spectreLignes(p, za, zb, y, re, im);
+    }
+    spectreColonnes(p, re, im, 0);
+
+    const double *restrict kr = ctx->noyau->re;
+    const double *restrict ki = ctx->noyau->im;
+    for (size_t i = 0; i < taille; i++)
+    {
+        double r = re[i] * kr[i] - im[i] * ki[i];
+        im[i] = re[i] * ki[i] + im[i] * kr[i];
+        re[i] = r;
+    }
+    spectreColonnes(p, re, im, 1);
+
+    // Seuls les pixels de sortie du bloc qui ne lisent pas au-delà du bloc sont exacts
+    int lignes = ctx->img->height - by < ctx->sortieY ? ctx->img->height - by : ctx->sortieY;
+    int colonnes = ctx->img->width - bx < ctx->sortieX ? ctx->img->width - bx : ctx->sortieX;
+    for (int y = 0; y < lignes; y += 2)
+    {
+        lignesSpatiales(p, re, im, y, za, zb);
+        for (int l = 0; l < 2 && y + l < lignes; l++)
+        {
+            const double *src = l == 0 ? za : zb;
+            unsigned char *dst = imageRow(ctx->dest, by + y + l) + bx;
+            for (int x = 0; x < colonnes; x++)
+            {
+                dst[x] = arrondirPixel(src[x] + ctx->biais);
+            }
+        }
+    }
+    reserveRendre(tampon);
+}
+
+int convoluerFourier(const struct imageNB *img, struct imageNB *dest, const struct noyauReel *k, int correlation,
+                     int taille)
+{
+    const struct planFourier *p = planFourier(taille);
+    if (p == NULL)
+    {
+        return -1;
+    }
+    if (k->largeur > taille || k->hauteur > taille)
+    {
+        printf("Invalid parameters for convoluerFourier\n");
+        return -1;
+    }
+
+    // Coefficients en corrélation : la convolution retourne le noyau
+    size_t nb = (size_t)k->largeur * k->hauteur;
+    double *coefs = reservePrendre(nb * sizeof(double));
+    if (coefs == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    for (size_t i = 0; i < nb; i++)
+    {
+        coefs[i] = correlation ? k->coefs[i] : k->coefs[nb - 1 - i];
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "fft convolution");
+    struct spectre *s = obtenirSpectre(p, k->largeur, k->hauteur, coefs);
+    reserveRendre(coefs);
+    if (s == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        traceFermer(&zone);
+        return -1;
+    }
+
+    struct contexteFourier ctx;
+    ctx.img = img;
+    ctx.dest = dest;
+    ctx.plan = p;
+    ctx.noyau = s;
+    ctx.rayonX = k->largeur / 2;
+    ctx.rayonY = k->hauteur / 2;
+    ctx.sortieX = taille - k->largeur + 1;
+    ctx.sortieY = taille - k->hauteur + 1;
+    ctx.colonnes = (img->width + ctx.sortieX - 1) / ctx.sortieX;
+    ctx.biais = k->biais;
+    atomic_init(&ctx.erreur, 0);
+    int rangees = (img->height + ctx.sortieY - 1) / ctx.sortieY;
+    parallelFor(ctx.colonnes * rangees, tacheBloc, &ctx);
+
+    rendreSpectre(s);
+    traceFermer(&zone);
+    if (atomic_load(&ctx.erreur))
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    return 0;
+}
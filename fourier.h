@@ -0,0 +1,81 @@
+#ifndef _FOURIER_H_
+#define _FOURIER_H_
+
+#include "image.h"
+#include "convolution.h"
+
+/**
+ * Côtés extrêmes (puissances de deux) des blocs transformés
+ */
+#define FOURIER_TAILLE_MIN 16
+#define FOURIER_TAILLE_MAX 1024
+
+/**
+ * Nombre de spectres de noyaux gardés en cache
+ */
+#define FOURIER_SPECTRES 8
+
+/**
+ * Plan d'une transformée de Fourier complexe de taille n (puissance de deux)
+ *
+ * Les facteurs de rotation de chaque étage sont rangés à la suite (étage de demi-taille m à
+ * partir de l'indice m - 1) et la permutation initiale est précalculée. Un plan est
+ * construit une fois par taille et gardé jusqu'à la fin du programme.
+ */
+struct planFourier
+{
+    int n;
+    int *permutation;
+    double *cosinus;
+    double *sinus;
+};
+
+/**
+ * Fonction qui renvoie le plan d'une taille, construit au premier appel
+ * @param n puissance de deux entre 2 et FOURIER_TAILLE_MAX
+ * @return le plan, ou NULL si n n'est pas valide ou si la mémoire manque
+ */
+const struct planFourier *planFourier(int n);
+
+/**
+ * Fonction qui calcule sur place la transformée de Fourier (non normalisée) d'un signal
+ * complexe donné par ses parties réelle et imaginaire
+ * La transformée inverse (sans le facteur 1 / n) s'obtient en échangeant re et im.
+ * @param p
+ * @param re
+ * @param im
+ */
+void transformerFourier(const struct planFourier *p, double *re, double *im);
+
+/**
+ * Fonction qui estime le coût d'une convolution par blocs
+ * Chaque bloc de côté n donne (n - largeurNoyau + 1) x (n - hauteurNoyau + 1) pixels de
+ * sortie pour environ n² log2(n) opérations ; la taille choisie minimise le total.
+ * @param largeur de l'image
+ * @param hauteur
+ * @param largeurNoyau
+ * @param hauteurNoyau
+ * @param taille côté des blocs retenu
+ * @return le coût estimé, en papillons, ou -1 si le noyau est trop grand
+ */
+double coutFourier(int largeur, int hauteur, int largeurNoyau, int hauteurNoyau, int *taille);
+
+/**
+ * Fonction qui applique un noyau réel par transformée de Fourier
+ * L'image est découpée en blocs (méthode overlap-save) : chaque bloc de côté n, lu avec
+ * les pixels voisins couverts par le noyau, est transformé (deux lignes réelles par
+ * transformée complexe, puis les colonnes du demi-spectre), multiplié par le spectre du
+ * noyau et ramené dans le domaine spatial. Le spectre du noyau est gardé en cache (les
+ * FOURIER_SPECTRES derniers, par taille de bloc et coefficients) pour les appels suivants.
+ * Les blocs sont répartis sur tous les threads.
+ * @param img
+ * @param dest image de sortie, déjà allouée à la taille de img
+ * @param k
+ * @param correlation
+ * @param taille côté des blocs, donné par coutFourier
+ * @return 0 si la convolution a réussi, -1 sinon
+ */
+int convoluerFourier(const struct imageNB *img, struct imageNB *dest, const struct noyauReel *k, int correlation,
+                     int taille);
+
+#endif
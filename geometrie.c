@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "geometrie.h"
+#include "simd.h"
+#include "parallele.h"
+
+/**
+ * Côté des blocs transposés en registres
+ */
+#define BLOC 16
+
+struct contexteTranslation
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    int dx;
+    int dy;
+};
+
+/**
+ * Le pixel (x, y) de la sortie est base[x * pasX + y * pasY]
+ */
+struct contextePermutation
+{
+    const unsigned char *base;
+    ptrdiff_t pasX;
+    ptrdiff_t pasY;
+    struct imageNB *dest;
+};
+
+static int modulo(int a, int n)
+{
+    int r = a % n;
+    return r < 0 ? r + n : r;
+}
+
+static int tuileTranslation(const struct tuile *t, void *arg)
+{
+    const struct contexteTranslation *ctx = arg;
+    int w = ctx->img->width;
+    int n = t->x1 - t->x0;
+
+    // Segment [x0, x1[ de la sortie : au plus deux copies, de part et d'autre du retour
+    int debut = modulo(t->x0 - ctx->dx, w);
+    int premier = w - debut < n ? w - debut : n;
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        const unsigned char *src = imageRow(ctx->img, modulo(y - ctx->dy, ctx->img->height));
+        unsigned char *dst = imageRow(ctx->dest, y) + t->x0;
+        memcpy(dst, src + debut, (size_t)premier);
+        memcpy(dst + premier, src, (size_t)(n - premier));
+    }
+    return 0;
+}
+
+int translater(struct imageNB *img, struct imageNB *dest, int dx, int dy)
+{
+    if (img == NULL || img->color == NULL || dest == img)
+    {
+        printf("Invalid parameters for translater\n");
+        return -1;
+    }
+    if (reallocImage(dest, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+
+    struct contexteTranslation ctx = {img, dest, modulo(dx, img->width), modulo(dy, img->height)};
+    return executerTuiles(img->width, img->height, 0, tuileTranslation, &ctx);
+}
+
+#ifdef SIMD_X86
+/**
+ * Inverse l'ordre des 16 octets d'un registre
+ */
+static inline __m128i inverser16(__m128i v)
+{
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+/**
+ * Transpose le bloc 16x16 dont la ligne i commence à src + i * pasSrc ; la ligne k du
+ * résultat est écrite à dst + k * pasDst (les pas peuvent être négatifs)
+ */
+static void transposer16(const unsigned char *src, ptrdiff_t pasSrc, unsigned char *dst, ptrdiff_t pasDst)
+{
+    __m128i a[16], b[16];
+    for (int i = 0; i < 16; i++)
+    {
+        a[i] = _mm_loadu_si128((const __m128i *)(src + i * pasSrc));
+    }
+
+    // Octets, puis paires, puis quadruplets, puis huitaines : à chaque étape les éléments
+    // entrelacés couvrent deux fois plus de lignes source
+    for (int i = 0; i < 8; i++)
+    {
+        b[2 * i] = _mm_unpacklo_epi8(a[2 * i], a[2 * i + 1]);
+        b[2 * i + 1] = _mm_unpackhi_epi8(a[2 * i], a[2 * i + 1]);
+    }
+    for (int j = 0; j < 4; j++)
+    {
+        a[4 * j] = _mm_unpacklo_epi16(b[4 * j], b[4 * j + 2]);
+        a[4 * j + 1] = _mm_unpackhi_epi16(b[4 * j], b[4 * j + 2]);
+        a[4 * j + 2] = _mm_unpacklo_epi16(b[4 * j + 1], b[4 * j + 3]);
+        a[4 * j + 3] = _mm_unpackhi_epi16(b[4 * j + 1], b[4 * j + 3]);
+    }
+    // b[8k + q] : colonnes 2q et 2q + 1 des lignes 8k à 8k + 7
+    for (int k = 0; k < 2; k++)
+    {
+        for (int m = 0; m < 4; m++)
+        {
+            b[8 * k + 2 * m] = _mm_unpacklo_epi32(a[8 * k + m], a[8 * k + 4 + m]);
+            b[8 * k + 2 * m + 1] = _mm_unpackhi_epi32(a[8 * k + m], a[8 * k + 4 + m]);
+        }
+    }
+    for (int q = 0; q < 8; q++)
+    {
+        _mm_storeu_si128((__m128i *)(dst + (2 * q) * pasDst), _mm_unpacklo_epi64(b[q], b[8 + q]));
+        _mm_storeu_si128((__m128i *)(dst + (2 * q + 1) * pasDst), _mm_unpackhi_epi64(b[q], b[8 + q]));
+    }
+}
+#endif
+
+/**
+ * dst[k] = fin[-k] pour k de 0 à n - 1
+ */
+static void inverserLigne(const unsigned char *fin, unsigned char *dst, int n)
+{
+    int k = 0;
+#ifdef SIMD_X86
+    for (; k + 16 <= n; k += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(fin - k - 15));
+        _mm_storeu_si128((__m128i *)(dst + k), inverser16(v));
+    }
+#endif
+    for (; k < n; k++)
+    {
+        dst[k] = fin[-k];
+    }
+}
+
+/**
+ * Permutation sans échange des axes : chaque ligne de sortie est une ligne source, copiée
+ * ou inversée
+ */
+static int tuileLignes(const struct tuile *t, void *arg)
+{
+    const struct contextePermutation *ctx = arg;
+    int n = t->x1 - t->x0;
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        const unsigned char *src = ctx->base + y * ctx->pasY + t->x0 * ctx->pasX;
+        unsigned char *dst = imageRow(ctx->dest, y) + t->x0;
+        if (ctx->pasX == 1)
+        {
+            memcpy(dst, src, (size_t)n);
+        }
+        else
+        {
+            inverserLigne(src, dst, n);
+        }
+    }
+    return 0;
+}
+
+static void transposerScalaire(const struct contextePermutation *ctx, int x0, int y0, int x1, int y1)
+{
+    for (int y = y0; y < y1; y++)
+    {
+        const unsigned char *src = ctx->base + y * ctx->pasY;
+        unsigned char *dst = imageRow(ctx->dest, y);
+        for (int x = x0; x < x1; x++)
+        {
+            dst[x] = src[x * ctx->pasX];
+        }
+    }
+}
+
+/**
+ * Permutation avec échange des axes : blocs 16x16 transposés en registres, les lignes source
+ * d'un bloc étant lues dans le sens de pasX
+ */
+static int tuileTransposee(const struct tuile *t, void *arg)
+{
+    const struct contextePermutation *ctx = arg;
+    int y = t->y0;
+#ifdef SIMD_X86
+    ptrdiff_t stride = ctx->dest->stride;
+    for (; y + BLOC <= t->y1; y += BLOC)
+    {
+        int x = t->x0;
+        for (; x + BLOC <= t->x1; x += BLOC)
+        {
+            const unsigned char *src = ctx->base + x * ctx->pasX + y * ctx->pasY;
+            if (ctx->pasY == 1)
+            {
+                transposer16(src, ctx->pasX, imageRow(ctx->dest, y) + x, stride);
+            }
+            else
+            {
+                // Octets source contigus de bas en haut : la ligne k du bloc va en y + 15 - k
+                transposer16(src - (BLOC - 1), ctx->pasX, imageRow(ctx->dest, y + BLOC - 1) + x, -stride);
+            }
+        }
+        transposerScalaire(ctx, x, y, t->x1, y + BLOC);
+    }
+#endif
+    transposerScalaire(ctx, t->x0, y, t->x1, t->y1);
+    return 0;
+}
+
+int permuterImage(struct imageNB *img, struct imageNB *dest, int a, int b, int c, int d)
+{
+    int valide = (abs(a) + abs(b) == 1) && (abs(c) + abs(d) == 1) && (abs(a) == abs(d));
+    if (img == NULL || img->color == NULL || dest == img || !valide)
+    {
+        printf("Invalid parameters for permuterImage\n");
+        return -1;
+    }
+
+    int w = img->width, h = img->height;
+    int largeur = a != 0 ? w : h;
+    int hauteur = a != 0 ? h : w;
+    if (reallocImage(dest, largeur, hauteur) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+
+    // Sortie (x, y) -> source (u, v) par la matrice inverse (la transposée), en coordonnées
+    // centrées : u = a x + c y + u0, v = b x + d y + v0
+    int u0 = ((w - 1) - a * (largeur - 1) - c * (hauteur - 1)) / 2;
+    int v0 = ((h - 1) - b * (largeur - 1) - d * (hauteur - 1)) / 2;
+    struct contextePermutation ctx;
+    ctx.base = imageRow(img, v0) + u0;
+    ctx.pasX = a + (ptrdiff_t)b * img->stride;
+    ctx.pasY = c + (ptrdiff_t)d * img->stride;
+    ctx.dest = dest;
+
+    return executerTuiles(largeur, hauteur, 0, a != 0 ? tuileLignes : tuileTransposee, &ctx);
+}
+
+int retourner(struct imageNB *img, struct imageNB *dest, int horizontal, int vertical)
+{
+    return permuterImage(img, dest, horizontal ? -1 : 1, 0, 0, vertical ? -1 : 1);
+}
+
+int transposer(struct imageNB *img, struct imageNB *dest)
+{
+    return permuterImage(img, dest, 0, 1, 1, 0);
+}
+
+int pivoterQuart(struct imageNB *img, struct imageNB *dest, int quarts)
+{
+    // Matrices de rotation (cos -sin ; sin cos) pour 0, 90, 180 et 270 degrés
+    static const int matrices[4][4] = {{1, 0, 0, 1}, {0, -1, 1, 0}, {-1, 0, 0, -1}, {0, 1, -1, 0}};
+    const int *m = matrices[modulo(quarts, 4)];
+    return permuterImage(img, dest, m[0], m[1], m[2], m[3]);
+}
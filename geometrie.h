@@ -0,0 +1,67 @@
+#ifndef _GEOMETRIE_H_
+#define _GEOMETRIE_H_
+
+#include "image.h"
+
+/**
+ * Transformations géométriques exactes : chaque pixel de sortie est un pixel source, sans
+ * interpolation. Ce sont des déplacements de mémoire (copies de segments de lignes,
+ * transpositions de blocs 16x16 en SIMD), exécutés par tuiles en parallèle.
+ */
+
+/**
+ * Fonction qui décale une image de (dx, dy) pixels, avec retour de l'autre côté
+ * Le pixel (x, y) de la sortie est le pixel ((x - dx) mod largeur, (y - dy) mod hauteur) de
+ * l'image ; les décalages peuvent être négatifs ou plus grands que l'image.
+ * @param img
+ * @param dest image initialisée, différente de img
+ * @param dx
+ * @param dy
+ * @return 0 si la translation a réussi, -1 sinon
+ */
+int translater(struct imageNB *img, struct imageNB *dest, int dx, int dy);
+
+/**
+ * Fonction qui applique à une image une matrice de permutation signée (symétries,
+ * transposition, rotations d'un quart de tour)
+ * La matrice (a b ; c d) s'applique aux coordonnées centrées, y vers le bas, comme
+ * struct affine ; chaque ligne et chaque colonne a un seul coefficient non nul, égal à 1
+ * ou -1. La sortie a les dimensions de l'image, échangées si la matrice transpose.
+ * @param img
+ * @param dest image initialisée, différente de img
+ * @param a
+ * @param b
+ * @param c
+ * @param d
+ * @return 0 si la transformation a réussi, -1 sinon
+ */
+int permuterImage(struct imageNB *img, struct imageNB *dest, int a, int b, int c, int d);
+
+/**
+ * Fonction qui retourne une image (miroir)
+ * @param img
+ * @param dest image initialisée, différente de img
+ * @param horizontal 1 pour inverser les colonnes
+ * @param vertical 1 pour inverser les lignes
+ * @return 0 si le retournement a réussi, -1 sinon
+ */
+int retourner(struct imageNB *img, struct imageNB *dest, int horizontal, int vertical);
+
+/**
+ * Fonction qui transpose une image (échange des lignes et des colonnes)
+ * @param img
+ * @param dest image initialisée, différente de img
+ * @return 0 si la transposition a réussi, -1 sinon
+ */
+int transposer(struct imageNB *img, struct imageNB *dest);
+
+/**
+ * Fonction qui fait tourner une image d'un nombre entier de quarts de tour
+ * @param img
+ * @param dest image initialisée, différente de img
+ * @param quarts nombre de quarts de tour dans le sens horaire (négatif : sens trigonométrique)
+ * @return 0 si la rotation a réussi, -1 sinon
+ */
+int pivoterQuart(struct imageNB *img, struct imageNB *dest, int quarts);
+
+#endif
@@ -0,0 +1,391 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <math.h>
+
+#include "histo.h"
+#include "lut.h"
+#include "parallele.h"
+#include "reserve.h"
+
+#define SOUS_HISTOS 4
+
+/**
+ * Compte une ligne dans les sous-histogrammes, huit pixels par lecture de 64 bits
+ */
+static void compterLigne(const unsigned char *p, int n, uint32_t (*sous)[HISTO_NIVEAUX])
+{
+    int x = 0;
+    for (; x + 8 <= n; x += 8)
+    {
+        uint64_t v;
+        memcpy(&v, p + x, sizeof(v));
+        sous[0][v & 0xFF]++;
+        sous[1][(v >> 8) & 0xFF]++;
+        sous[2][(v >> 16) & 0xFF]++;
+        sous[3][(v >> 24) & 0xFF]++;
+        sous[0][(v >> 32) & 0xFF]++;
+        sous[1][(v >> 40) & 0xFF]++;
+        sous[2][(v >> 48) & 0xFF]++;
+        sous[3][v >> 56]++;
+    }
+    for (; x < n; x++)
+    {
+        sous[0][p[x]]++;
+    }
+}
+
+void compterRectangle(const struct imageNB *img, int x0, int y0, int x1, int y1, uint32_t compte[HISTO_NIVEAUX])
+{
+    uint32_t sous[SOUS_HISTOS][HISTO_NIVEAUX];
+    memset(sous, 0, sizeof(sous));
+
+    for (int y = y0; y < y1; y++)
+    {
+        compterLigne(imageRow(img, y) + x0, x1 - x0, sous);
+    }
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        compte[v] += sous[0][v] + sous[1][v] + sous[2][v] + sous[3][v];
+    }
+}
+
+struct contexteHisto
+{
+    const struct imageNB *img;
+    atomic_ullong compte[HISTO_NIVEAUX];
+};
+
+static int tuileHisto(const struct tuile *t, void *arg)
+{
+    struct contexteHisto *ctx = arg;
+    uint32_t compte[HISTO_NIVEAUX] = {0};
+    compterRectangle(ctx->img, t->x0, t->y0, t->x1, t->y1, compte);
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        if (compte[v] != 0)
+        {
+            atomic_fetch_add_explicit(&ctx->compte[v], compte[v], memory_order_relaxed);
+        }
+    }
+    return 0;
+}
+
+int calculerHistogramme(const struct imageNB *img, struct histo *h)
+{
+    struct contexteHisto *ctx = reservePrendre(sizeof(*ctx));
+    if (ctx == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    ctx->img = img;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        atomic_init(&ctx->compte[v], 0);
+    }
+
+    int resultat = executerTuiles(img->width, img->height, 0, tuileHisto, ctx);
+
+    h->total = 0;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        h->compte[v] = atomic_load(&ctx->compte[v]);
+        h->total += h->compte[v];
+    }
+    reserveRendre(ctx);
+    return resultat;
+}
+
+void histoCumule(const struct histo *h, uint64_t cumul[HISTO_NIVEAUX])
+{
+    uint64_t somme = 0;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        somme += h->compte[v];
+        cumul[v] = somme;
+    }
+}
+
+double histoMoyenne(const struct histo *h)
+{
+    if (h->total == 0)
+    {
+        return 0;
+    }
+    double somme = 0;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        somme += (double)v * h->compte[v];
+    }
+    return somme / h->total;
+}
+
+double histoVariance(const struct histo *h)
+{
+    if (h->total == 0)
+    {
+        return 0;
+    }
+    double moyenne = histoMoyenne(h);
+    double somme = 0;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        somme += (v - moyenne) * (v - moyenne) * h->compte[v];
+    }
+    return somme / h->total;
+}
+
+int histoCentile(const struct histo *h, double p)
+{
+    double seuil = p / 100.0 * h->total;
+    uint64_t somme = 0;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        somme += h->compte[v];
+        if (somme > 0 && somme >= seuil)
+        {
+            return v;
+        }
+    }
+    return HISTO_NIVEAUX - 1;
+}
+
+int dessinerHistogramme(const struct histo *h, struct imageNB *dest, int largeur, int hauteur)
+{
+    if (largeur <= 0 || hauteur <= 0)
+    {
+        printf("Invalid parameters for dessinerHistogramme\n");
+        return -1;
+    }
+    int *barres = reservePrendre((size_t)largeur * sizeof(int));
+    if (barres == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    if (reallocImage(dest, largeur, hauteur) != 0)
+    {
+        reserveRendre(barres);
+        return -1;
+    }
+    dest->vmax = 255;
+
+    uint64_t maxCompte = 1;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        maxCompte = h->compte[v] > maxCompte ? h->compte[v] : maxCompte;
+    }
+    // Hauteur de la barre de chaque colonne
+    for (int x = 0; x < largeur; x++)
+    {
+        int v = (int)((long)x * HISTO_NIVEAUX / largeur);
+        barres[x] = (int)((double)h->compte[v] * hauteur / maxCompte + 0.5);
+    }
+    for (int y = 0; y < hauteur; y++)
+    {
+        unsigned char *ligne = imageRow(dest, y);
+        int seuil = hauteur - y;
+        for (int x = 0; x < largeur; x++)
+        {
+            ligne[x] = barres[x] >= seuil ? 255 : 0;
+        }
+    }
+
+    reserveRendre(barres);
+    return 0;
+}
+
+int egaliserHistogramme(struct imageNB *img, struct imageNB *dest)
+{
+    struct histo h;
+    if (calculerHistogramme(img, &h) != 0)
+    {
+        return -1;
+    }
+    uint64_t cumul[HISTO_NIVEAUX];
+    histoCumule(&h, cumul);
+
+    // Le premier niveau présent va sur 0, le dernier sur vmax
+    uint64_t premier = 0;
+    for (int v = 0; v < HISTO_NIVEAUX && premier == 0; v++)
+    {
+        premier = cumul[v];
+    }
+    struct lut l;
+    lutIdentite(&l);
+    if (h.total > premier)
+    {
+        double echelle = (double)img->vmax / (h.total - premier);
+        for (int v = 0; v < HISTO_NIVEAUX; v++)
+        {
+            l.table[v] = (unsigned char)(cumul[v] <= premier ? 0 : lround((cumul[v] - premier) * echelle));
+        }
+    }
+    return appliquerLUT(img, dest, &l);
+}
+
+struct contexteClahe
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    int tuilesX;
+    int tuilesY;
+    double limite;
+    unsigned char (*tables)[HISTO_NIVEAUX];
+    // Zone de gauche (resp. du haut) et poids sur 8 bits de la zone suivante, par colonne (ligne)
+    int *zoneX;
+    int *poidsX;
+    int *zoneY;
+    int *poidsY;
+};
+
+/**
+ * Table d'égalisation écrêtée d'une zone
+ */
+static void tableZone(void *arg, int indice)
+{
+    struct contexteClahe *ctx = arg;
+    const struct imageNB *img = ctx->img;
+    int i = indice % ctx->tuilesX, j = indice / ctx->tuilesX;
+    int x0 = (int)((long)i * img->width / ctx->tuilesX), x1 = (int)((long)(i + 1) * img->width / ctx->tuilesX);
+    int y0 = (int)((long)j * img->height / ctx->tuilesY), y1 = (int)((long)(j + 1) * img->height / ctx->tuilesY);
+    uint32_t compte[HISTO_NIVEAUX] = {0};
+    compterRectangle(img, x0, y0, x1, y1, compte);
+    uint32_t surface = (uint32_t)(x1 - x0) * (uint32_t)(y1 - y0);
+
+    if (ctx->limite > 0)
+    {
+        uint32_t plafond = (uint32_t)(ctx->limite * surface / HISTO_NIVEAUX);
+        plafond = plafond > 0 ? plafond : 1;
+        uint32_t exces = 0;
+        for (int v = 0; v < HISTO_NIVEAUX; v++)
+        {
+            if (compte[v] > plafond)
+            {
+                exces += compte[v] - plafond;
+                compte[v] = plafond;
+            }
+        }
+        // Excédent réparti uniformément, le reste un niveau sur pas
+        uint32_t part = exces / HISTO_NIVEAUX, reste = exces % HISTO_NIVEAUX;
+        for (int v = 0; v < HISTO_NIVEAUX; v++)
+        {
+            compte[v] += part;
+        }
+        if (reste > 0)
+        {
+            uint32_t pas = HISTO_NIVEAUX / reste;
+            for (uint32_t v = 0; v < HISTO_NIVEAUX && reste > 0; v += pas, reste--)
+            {
+                compte[v]++;
+            }
+        }
+    }
+
+    unsigned char *table = ctx->tables[indice];
+    double echelle = surface > 0 ? (double)img->vmax / surface : 0;
+    uint32_t cumul = 0;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        cumul += compte[v];
+        table[v] = (unsigned char)lround(cumul * echelle);
+    }
+}
+
+/**
+ * Zone à gauche de chaque position et poids de la zone suivante, entre les centres des zones
+ */
+static void interpolationZones(int taille, int nbZones, int *zone, int *poids)
+{
+    for (int x = 0; x < taille; x++)
+    {
+        // Position en unités de zones, 0 au centre de la première zone
+        double p = (x + 0.5) * nbZones / taille - 0.5;
+        if (p <= 0)
+        {
+            zone[x] = 0;
+            poids[x] = 0;
+        }
+        else if (p >= nbZones - 1)
+        {
+            zone[x] = nbZones - 1;
+            poids[x] = 0;
+        }
+        else
+        {
+            zone[x] = (int)p;
+            poids[x] = (int)lround((p - zone[x]) * 256);
+        }
+    }
+}
+
+static int tuileClahe(const struct tuile *t, void *arg)
+{
+    const struct contexteClahe *ctx = arg;
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        const unsigned char *src = imageRow(ctx->img, y);
+        unsigned char *dst = imageRow(ctx->dest, y);
+        int zy = ctx->zoneY[y], wy = ctx->poidsY[y];
+        int zyBas = zy + 1 < ctx->tuilesY ? zy + 1 : zy;
+        const unsigned char (*haut)[HISTO_NIVEAUX] = ctx->tables + zy * ctx->tuilesX;
+        const unsigned char (*bas)[HISTO_NIVEAUX] = ctx->tables + zyBas * ctx->tuilesX;
+
+        for (int x = t->x0; x < t->x1; x++)
+        {
+            int v = src[x];
+            int zx = ctx->zoneX[x], wx = ctx->poidsX[x];
+            int zxDroite = zx + 1 < ctx->tuilesX ? zx + 1 : zx;
+            int h = haut[zx][v] * (256 - wx) + haut[zxDroite][v] * wx;
+            int b = bas[zx][v] * (256 - wx) + bas[zxDroite][v] * wx;
+            dst[x] = (unsigned char)((h * (256 - wy) + b * wy + 32768) >> 16);
+        }
+    }
+    return 0;
+}
+
+int clahe(struct imageNB *img, struct imageNB *dest, int tuilesX, int tuilesY, double limite)
+{
+    if (dest == img || tuilesX <= 0 || tuilesY <= 0 || tuilesX > img->width || tuilesY > img->height || limite < 0)
+    {
+        printf("Invalid parameters for clahe\n");
+        return -1;
+    }
+
+    struct contexteClahe ctx;
+    ctx.img = img;
+    ctx.dest = dest;
+    ctx.tuilesX = tuilesX;
+    ctx.tuilesY = tuilesY;
+    ctx.limite = limite;
+    ctx.tables = reservePrendre((size_t)tuilesX * tuilesY * HISTO_NIVEAUX);
+    ctx.zoneX = reservePrendre((size_t)img->width * 2 * sizeof(int));
+    ctx.zoneY = reservePrendre((size_t)img->height * 2 * sizeof(int));
+    if (ctx.tables == NULL || ctx.zoneX == NULL || ctx.zoneY == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        reserveRendre(ctx.tables);
+        reserveRendre(ctx.zoneX);
+        reserveRendre(ctx.zoneY);
+        return -1;
+    }
+    ctx.poidsX = ctx.zoneX + img->width;
+    ctx.poidsY = ctx.zoneY + img->height;
+
+    int resultat = reallocImage(dest, img->width, img->height);
+    if (resultat == 0)
+    {
+        dest->vmax = img->vmax;
+        parallelFor(tuilesX * tuilesY, tableZone, &ctx);
+        interpolationZones(img->width, tuilesX, ctx.zoneX, ctx.poidsX);
+        interpolationZones(img->height, tuilesY, ctx.zoneY, ctx.poidsY);
+        resultat = executerTuiles(img->width, img->height, 0, tuileClahe, &ctx);
+    }
+
+    reserveRendre(ctx.tables);
+    reserveRendre(ctx.zoneX);
+    reserveRendre(ctx.zoneY);
+    return resultat;
+}
@@ -0,0 +1,110 @@
+#ifndef _HISTO_H_
+#define _HISTO_H_
+
+#include <stdint.h>
+
+#include "image.h"
+
+#define HISTO_NIVEAUX 256
+
+/**
+ * Taille par défaut du graphique de l'histogramme
+ */
+#define HISTO_LARGEUR 512
+#define HISTO_HAUTEUR 256
+
+/**
+ * Histogramme des niveaux de gris d'une image
+ */
+struct histo
+{
+    uint64_t compte[HISTO_NIVEAUX];
+    uint64_t total;
+};
+
+/**
+ * Fonction qui compte les niveaux de gris de toute l'image
+ * Chaque tuile compte dans quatre sous-histogrammes entrelacés (des pixels voisins égaux ne
+ * touchent pas le même compteur à la suite), puis les ajoute au total. Le calcul est réparti
+ * en tuiles sur tous les threads.
+ * @param img
+ * @param h
+ * @return 0 si le calcul a réussi, -1 sinon
+ */
+int calculerHistogramme(const struct imageNB *img, struct histo *h);
+
+/**
+ * Fonction qui ajoute à compte les niveaux de gris du rectangle [x0, x1[ x [y0, y1[
+ * @param img
+ * @param x0
+ * @param y0
+ * @param x1
+ * @param y1
+ * @param compte
+ */
+void compterRectangle(const struct imageNB *img, int x0, int y0, int x1, int y1, uint32_t compte[HISTO_NIVEAUX]);
+
+/**
+ * Fonction qui calcule l'histogramme cumulé : cumul[v] = nombre de pixels <= v
+ * @param h
+ * @param cumul
+ */
+void histoCumule(const struct histo *h, uint64_t cumul[HISTO_NIVEAUX]);
+
+/**
+ * Fonction qui calcule le niveau moyen
+ * @param h
+ * @return
+ */
+double histoMoyenne(const struct histo *h);
+
+/**
+ * Fonction qui calcule la variance des niveaux
+ * @param h
+ * @return
+ */
+double histoVariance(const struct histo *h);
+
+/**
+ * Fonction qui calcule un centile : le plus petit niveau v tel qu'au moins p % des pixels
+ * soient <= v
+ * @param h
+ * @param p entre 0 et 100
+ * @return
+ */
+int histoCentile(const struct histo *h, double p);
+
+/**
+ * Fonction qui dessine l'histogramme dans une image de taille fixe, barres blanches sur fond
+ * noir, mises à l'échelle de la plus haute
+ * @param h
+ * @param dest image de sortie initialisée
+ * @param largeur
+ * @param hauteur
+ * @return 0 si le dessin a réussi, -1 sinon
+ */
+int dessinerHistogramme(const struct histo *h, struct imageNB *dest, int largeur, int hauteur);
+
+/**
+ * Fonction qui égalise l'histogramme d'une image
+ * @param img
+ * @param dest peut être égale à img
+ * @return 0 si l'égalisation a réussi, -1 sinon
+ */
+int egaliserHistogramme(struct imageNB *img, struct imageNB *dest);
+
+/**
+ * Fonction qui égalise l'histogramme par zones avec limitation du contraste (CLAHE)
+ * L'image est découpée en tuilesX x tuilesY zones ; l'histogramme de chaque zone est écrêté
+ * à limite fois la hauteur moyenne d'une barre, l'excédent étant réparti sur tous les niveaux.
+ * Chaque pixel est interpolé entre les tables des quatre zones les plus proches.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param tuilesX
+ * @param tuilesY
+ * @param limite par exemple 2 à 4 ; 0 désactive l'écrêtage
+ * @return 0 si l'égalisation a réussi, -1 sinon
+ */
+int clahe(struct imageNB *img, struct imageNB *dest, int tuilesX, int tuilesY, double limite);
+
+#endif
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "image.h"
+#include "derives.h"
+#include "reserve.h"
+
+/**
+ * Arrondit n au multiple supérieur de a
+ */
+static size_t arrondir(size_t n, size_t a)
+{
+    return (n + a - 1) / a * a;
+}
+
+/**
+ * Calcule la disposition d'une image et renvoie la taille de son allocation
+ * La marge gauche est arrondie pour que le pixel (0, y) soit aligné.
+ */
+static size_t geometrie(int width, int height, int border, size_t *gauche, size_t *stride)
+{
+    *gauche = arrondir((size_t)border, IMAGE_ALIGNEMENT);
+    *stride = arrondir(*gauche + (size_t)width + (size_t)border, IMAGE_ALIGNEMENT);
+    return *stride * ((size_t)height + 2 * (size_t)border);
+}
+
+/**
+ * Place une image de géométrie donnée dans l'allocation img->data
+ */
+static void disposer(struct imageNB *img, int width, int height, int border, size_t gauche, size_t stride)
+{
+    img->width = width;
+    img->height = height;
+    img->stride = (int)stride;
+    img->border = border;
+    img->color = img->data + (size_t)border * stride + gauche;
+    img->vue = 0;
+}
+
+/**
+ * Réutilise l'allocation de img pour une nouvelle géométrie si elle est assez grande
+ * @return 1 si l'image est prête, 0 sinon
+ */
+static int reutiliser(struct imageNB *img, int width, int height, int border)
+{
+    size_t gauche, stride;
+    if (img->data == NULL || width <= 0 || height <= 0 || border < 0 ||
+        geometrie(width, height, border, &gauche, &stride) > reserveCapacite(img->data))
+    {
+        return 0;
+    }
+    disposer(img, width, height, border, gauche, stride);
+    return 1;
+}
+
+int allocImage(struct imageNB *img, int width, int height, int border)
+{
+    img->data = NULL;
+    img->color = NULL;
+    img->derives = NULL;
+
+    if (width <= 0 || height <= 0 || border < 0)
+    {
+        printf("ERROR invalid image size %dx%d\n", width, height);
+        return -1;
+    }
+
+    size_t gauche, stride;
+    img->data = reservePrendre(geometrie(width, height, border, &gauche, &stride));
+    if (img->data == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+
+    disposer(img, width, height, border, gauche, stride);
+    img->vmax = 255;
+    return 0;
+}
+
+int reallocImage(struct imageNB *img, int width, int height)
+{
+    // Même géométrie : l'opération écrit peut-être sur place, les pixels partagés sont recopiés
+    if (img->data != NULL && img->width == width && img->height == height && img->border == IMAGE_BORDURE)
+    {
+        return modifierImage(img);
+    }
+    oublierDerives(img);
+    if (img->data != NULL && !reservePartage(img->data) && reutiliser(img, width, height, IMAGE_BORDURE))
+    {
+        return 0;
+    }
+    freeImageMemory(img);
+    return allocImage(img, width, height, IMAGE_BORDURE);
+}
+
+void copyImage(struct imageNB *src, struct imageNB *dest)
+{
+    if (src->data == NULL)
+    {
+        freeImageMemory(dest);
+        return;
+    }
+
+    // L'allocation est retenue avant de libérer dest, qui la partage peut-être déjà
+    reserveRetenir(src->data);
+    struct imageNB copie = *src;
+    copie.derives = NULL;
+    freeImageMemory(dest);
+    *dest = copie;
+}
+
+int vueImage(struct imageNB *src, struct imageNB *vue, int x, int y, int width, int height)
+{
+    if (src->data == NULL || x < 0 || y < 0 || width <= 0 || height <= 0 || width > src->width - x ||
+        height > src->height - y)
+    {
+        printf("Invalid parameters for vueImage\n");
+        return -1;
+    }
+
+    // Le voisinage de la vue au bord de src est la bordure de src
+    fillBorder(src);
+
+    reserveRetenir(src->data);
+    struct imageNB copie = *src;
+    copie.derives = NULL;
+    freeImageMemory(vue);
+    *vue = copie;
+    vue->color = copie.color + (ptrdiff_t)y * copie.stride + x;
+    vue->width = width;
+    vue->height = height;
+    vue->vue = 1;
+    return 0;
+}
+
+int modifierImage(struct imageNB *img)
+{
+    if (img->data == NULL)
+    {
+        return -1;
+    }
+    oublierDerives(img);
+    // Une vue est toujours recopiée : sa bordure, prise dans src, ne suivrait pas ses pixels
+    if (!reservePartage(img->data) && !img->vue)
+    {
+        return 0;
+    }
+
+    struct imageNB copie;
+    if (allocImage(&copie, img->width, img->height, img->border) != 0)
+    {
+        return -1;
+    }
+    copie.vmax = img->vmax;
+    size_t largeur = (size_t)img->width + 2 * (size_t)img->border;
+    for (int y = -img->border; y < img->height + img->border; y++)
+    {
+        memcpy(imageRow(&copie, y) - img->border, imageRow(img, y) - img->border, largeur);
+    }
+    if (img->vue)
+    {
+        fillBorder(&copie);
+    }
+    freeImageMemory(img);
+    *img = copie;
+    return 0;
+}
+
+void fillBorder(struct imageNB *img)
+{
+    int b = img->border;
+    if (b == 0 || img->vue)
+    {
+        return;
+    }
+
+    // Bords gauche et droit de chaque ligne
+    for (int y = 0; y < img->height; y++)
+    {
+        unsigned char *ligne = imageRow(img, y);
+        memset(ligne - b, ligne[0], b);
+        memset(ligne + img->width, ligne[img->width - 1], b);
+    }
+
+    // Lignes du haut et du bas (avec les coins)
+    size_t largeur = (size_t)img->width + 2 * b;
+    for (int i = 1; i <= b; i++)
+    {
+        memcpy(imageRow(img, -i) - b, imageRow(img, 0) - b, largeur);
+        memcpy(imageRow(img, img->height - 1 + i) - b, imageRow(img, img->height - 1) - b, largeur);
+    }
+}
+
+void clearImage(struct imageNB *img, unsigned char valeur)
+{
+    if (modifierImage(img) != 0)
+    {
+        return;
+    }
+    if (!img->vue)
+    {
+        memset(img->data, valeur, (size_t)img->stride * (img->height + 2 * img->border));
+        return;
+    }
+    for (int y = -img->border; y < img->height + img->border; y++)
+    {
+        memset(imageRow(img, y) - img->border, valeur, (size_t)img->width + 2 * img->border);
+    }
+}
+
+void freeImageMemory(struct imageNB *img)
+{
+    oublierDerives(img);
+    if (img->data != NULL)
+    {
+        reserveRendre(img->data);
+        img->data = NULL;
+        img->color = NULL;
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef _IMAGE_H_
+#define _IMAGE_H_
+
+#include <stddef.h>
+
+/**
+ * Alignement (en octets) du début de chaque ligne de pixels
+ */
+#define IMAGE_ALIGNEMENT 64
+
+/**
+ * Bordure par défaut autour des images, suffisante pour les filtres de voisinage 3x3
+ * et pour les chargements SIMD qui débordent légèrement de la ligne
+ */
+#define IMAGE_BORDURE 16
+
+/**
+ * Structure pour l'image
+ *
+ * Les pixels sont stockés dans une seule allocation alignée. La ligne y commence à
+ * color + y * stride, et une bordure de `border` pixels entoure l'image sur les
+ * quatre côtés (color[-1], la ligne -1, ... sont donc accessibles).
+ *
+ * Une allocation peut être partagée entre plusieurs images (copyImage, vueImage) : elle
+ * n'est libérée qu'avec la dernière, et une image partagée est recopiée avant d'être
+ * modifiée (copie à l'écriture, voir modifierImage).
+ *
+ * `derives` garde les structures calculées à partir des pixels (table des sommes, pyramide,
+ * voir derives.h) ; elles sont propres à l'image et oubliées dès que ses pixels changent.
+ */
+struct derives;
+
+struct imageNB
+{
+    int width;
+    int height;
+    int stride;
+    int border;
+    unsigned char *data;
+    unsigned char *color;
+    int vmax;
+    int vue;
+    struct derives *derives;
+};
+
+/**
+ * Accès au pixel (x, y) d'une image
+ */
+#define PIXEL(img, x, y) ((img)->color[(ptrdiff_t)(y) * (img)->stride + (x)])
+
+/**
+ * Fonction qui renvoie le début de la ligne y d'une image
+ * @param img
+ * @param y
+ * @return
+ */
+static inline unsigned char *imageRow(const struct imageNB *img, int y)
+{
+    return img->color + (ptrdiff_t)y * img->stride;
+}
+
+/**
+ * Fonction qui alloue une image (une seule allocation, lignes alignées, prise dans la réserve
+ * de tampons)
+ * Les pixels ne sont pas initialisés, vmax vaut 255.
+ * @param img
+ * @param width
+ * @param height
+ * @param border
+ * @return 0 si l'allocation a réussi, -1 sinon
+ */
+int allocImage(struct imageNB *img, int width, int height, int border);
+
+/**
+ * Fonction qui prépare une image de destination aux dimensions voulues
+ * L'allocation existante est conservée si elle est assez grande (img doit être initialisée,
+ * à {0} par exemple).
+ * @param img
+ * @param width
+ * @param height
+ * @return 0 si l'image est prête, -1 sinon
+ */
+int reallocImage(struct imageNB *img, int width, int height);
+
+/**
+ * Fonction qui copie une image
+ * La copie partage les pixels de src, sans les recopier : la première modification de
+ * l'une des deux images (voir modifierImage) lui donne ses propres pixels. dest doit être
+ * initialisée, à {0} par exemple.
+ * @param src
+ * @param dest
+ */
+void copyImage(struct imageNB *src, struct imageNB *dest);
+
+/**
+ * Fonction qui fait de vue le rectangle [x, x + width[ x [y, y + height[ de src, sans copie
+ * La vue partage les pixels de src ; sa bordure est le voisinage du rectangle dans src, et
+ * non une réplication de ses bords. Seules les opérations qui lisent la bordure (les filtres
+ * 3x3 : sobel, nettete...) voient ce voisinage ; les autres opérations de voisinage (flou,
+ * médiane, morphologie, seuils locaux, Fourier) traitent les bords de la vue comme ceux d'une
+ * image. Pour obtenir le résultat de l'image entière sur un rectangle, il faut donc traiter
+ * le rectangle élargi du voisinage du pipeline, puis le recadrer (voir pipelineVoisinage).
+ * vue doit être initialisée et se libère avec freeImageMemory, comme une image.
+ * @param src
+ * @param vue
+ * @param x
+ * @param y
+ * @param width
+ * @param height
+ * @return 0 si la vue est prête, -1 sinon
+ */
+int vueImage(struct imageNB *src, struct imageNB *vue, int x, int y, int width, int height);
+
+/**
+ * Fonction qui prépare une image à être modifiée sur place
+ * Si ses pixels sont partagés avec une autre image, ils sont d'abord recopiés (avec la
+ * bordure) dans une allocation propre à img. Une vue est toujours recopiée, et devient une
+ * image ordinaire dont la bordure réplique ses bords. Les structures dérivées de ses pixels
+ * sont oubliées.
+ * @param img
+ * @return 0 si l'image peut être modifiée, -1 sinon
+ */
+int modifierImage(struct imageNB *img);
+
+/**
+ * Fonction qui remplit la bordure d'une image en répliquant les pixels du bord
+ * Sans effet sur une vue, dont la bordure est le voisinage dans l'image d'origine.
+ * @param img
+ */
+void fillBorder(struct imageNB *img);
+
+/**
+ * Fonction qui met tous les pixels d'une image (bordure comprise) à une valeur
+ * @param img
+ * @param valeur
+ */
+void clearImage(struct imageNB *img, unsigned char valeur);
+
+/**
+ * Fonction qui libère la mémoire (rendue à la réserve de tampons quand plus aucune image
+ * ne la partage)
+ * @param img
+ */
+void freeImageMemory(struct imageNB *img);
+
+#endif
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "integrale.h"
+#include "derives.h"
+#include "parallele.h"
+#include "reserve.h"
+#include "trace.h"
+
+struct contexteIntegrale
+{
+    const struct imageNB *img;
+    struct integrale *t;
+    int bandes;
+    int carres;
+};
+
+struct contexteBlocs
+{
+    const struct integrale *t;
+    const struct imageNB *moyennes;
+    struct imageNB *dest;
+    int largeurBloc;
+    int hauteurBloc;
+};
+
+/**
+ * Lignes [y0, y1[ de l'image couvertes par la bande k
+ */
+static void bande(const struct contexteIntegrale *ctx, int k, int *y0, int *y1)
+{
+    int h = ctx->img->height;
+    *y0 = (int)((long long)h * k / ctx->bandes);
+    *y1 = (int)((long long)h * (k + 1) / ctx->bandes);
+}
+
+/**
+ * Valeur cumulée pour un pixel : le pixel ou son carré
+ */
+static inline uint32_t valeur(unsigned char v, int carres)
+{
+    return carres ? (uint32_t)v * v : v;
+}
+
+/**
+ * Sommes cumulées d'une bande, comme si elle commençait en haut de l'image
+ */
+static void tacheBande(void *arg, int k)
+{
+    const struct contexteIntegrale *ctx = arg;
+    const struct imageNB *img = ctx->img;
+    int y0, y1;
+    bande(ctx, k, &y0, &y1);
+
+    for (int y = y0; y < y1; y++)
+    {
+        const unsigned char *src = imageRow(img, y);
+        uint32_t *ligne = ctx->t->somme + (size_t)(y + 1) * ctx->t->pas;
+        const uint32_t *dessus = ligne - ctx->t->pas;
+        uint32_t cumul = 0;
+        ligne[0] = 0;
+        if (y == y0)
+        {
+            for (int x = 0; x < img->width; x++)
+            {
+                cumul += valeur(src[x], ctx->carres);
+                ligne[x + 1] = cumul;
+            }
+        }
+        else
+        {
+            for (int x = 0; x < img->width; x++)
+            {
+                cumul += valeur(src[x], ctx->carres);
+                ligne[x + 1] = dessus[x + 1] + cumul;
+            }
+        }
+    }
+}
+
+/**
+ * Ajoute aux lignes de la bande k + 1 (sauf la dernière, déjà corrigée) la dernière ligne
+ * de la bande k
+ */
+static void tacheReport(void *arg, int k)
+{
+    const struct contexteIntegrale *ctx = arg;
+    int y0, y1;
+    bande(ctx, k + 1, &y0, &y1);
+
+    const uint32_t *report = ctx->t->somme + (size_t)y0 * ctx->t->pas;
+    for (int y = y0 + 1; y < y1; y++)
+    {
+        uint32_t *ligne = ctx->t->somme + (size_t)y * ctx->t->pas;
+        for (int x = 1; x <= ctx->img->width; x++)
+        {
+            ligne[x] += report[x];
+        }
+    }
+}
+
+static int calculer(const struct imageNB *img, struct integrale *t, int carres)
+{
+    t->somme = NULL;
+    if (img == NULL || img->color == NULL)
+    {
+        printf("Invalid parameters for %s\n", carres ? "integraleCarresCalculer" : "integraleCalculer");
+        return -1;
+    }
+
+    // Lignes alignées sur 64 octets
+    t->largeur = img->width;
+    t->hauteur = img->height;
+    t->pas = ((size_t)img->width + 1 + 15) / 16 * 16;
+    t->somme = reservePrendre(t->pas * ((size_t)img->height + 1) * sizeof(uint32_t));
+    if (t->somme == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, carres ? "squares summed table" : "summed-area table");
+    memset(t->somme, 0, ((size_t)img->width + 1) * sizeof(uint32_t));
+
+    // Une bande par thread (au moins 64 lignes chacune), puis le report des bandes précédentes
+    struct contexteIntegrale ctx = {img, t, parallelThreads(), carres};
+    if (ctx.bandes > img->height / 64)
+    {
+        ctx.bandes = img->height / 64 > 1 ? img->height / 64 : 1;
+    }
+    parallelFor(ctx.bandes, tacheBande, &ctx);
+    if (ctx.bandes > 1)
+    {
+        for (int k = 1; k < ctx.bandes; k++)
+        {
+            int y0, y1;
+            bande(&ctx, k, &y0, &y1);
+            const uint32_t *report = t->somme + (size_t)y0 * t->pas;
+            uint32_t *derniere = t->somme + (size_t)y1 * t->pas;
+            for (int x = 1; x <= img->width; x++)
+            {
+                derniere[x] += report[x];
+            }
+        }
+        parallelFor(ctx.bandes - 1, tacheReport, &ctx);
+    }
+
+    traceFermer(&zone);
+    return 0;
+}
+
+int integraleCalculer(const struct imageNB *img, struct integrale *t)
+{
+    return calculer(img, t, 0);
+}
+
+int integraleCarresCalculer(const struct imageNB *img, struct integrale *t)
+{
+    return calculer(img, t, 1);
+}
+
+void integraleLiberer(struct integrale *t)
+{
+    reserveRendre(t->somme);
+    t->somme = NULL;
+}
+
+uint64_t sommeBloc(const struct integrale *t, int x0, int y0, int x1, int y1)
+{
+    // Par bandes de lignes dont chacune a une somme exacte sur 32 bits
+    int lignes = (int)(INTEGRALE_AIRE_MAX / (uint32_t)(x1 - x0));
+    lignes = lignes > 0 ? lignes : 1;
+    uint64_t somme = 0;
+    for (int y = y0; y < y1; y += lignes)
+    {
+        somme += sommeRectangle(t, x0, y, x1, y1 - y > lignes ? y + lignes : y1);
+    }
+    return somme;
+}
+
+static int tuileMoyennes(const struct tuile *tu, void *arg)
+{
+    const struct contexteBlocs *ctx = arg;
+    const struct integrale *t = ctx->t;
+    for (int j = tu->y0; j < tu->y1; j++)
+    {
+        int by0 = j * ctx->hauteurBloc;
+        int by1 = t->hauteur - by0 > ctx->hauteurBloc ? by0 + ctx->hauteurBloc : t->hauteur;
+        unsigned char *ligne = imageRow(ctx->dest, j);
+        for (int i = tu->x0; i < tu->x1; i++)
+        {
+            int bx0 = i * ctx->largeurBloc;
+            int bx1 = t->largeur - bx0 > ctx->largeurBloc ? bx0 + ctx->largeurBloc : t->largeur;
+            uint64_t aire = (uint64_t)(bx1 - bx0) * (uint64_t)(by1 - by0);
+            if (aire <= INTEGRALE_AIRE_MAX)
+            {
+                ligne[i] = (unsigned char)(sommeRectangle(t, bx0, by0, bx1, by1) / (uint32_t)aire);
+            }
+            else
+            {
+                ligne[i] = (unsigned char)(sommeBloc(t, bx0, by0, bx1, by1) / aire);
+            }
+        }
+    }
+    return 0;
+}
+
+int moyenneBlocs(struct imageNB *img, struct imageNB *dest, int largeurBloc, int hauteurBloc)
+{
+    if (img == NULL || img->color == NULL || dest == img || largeurBloc < 1 || hauteurBloc < 1)
+    {
+        printf("Invalid parameters for moyenneBlocs\n");
+        return -1;
+    }
+    // Un bloc plus grand que l'image est l'image entière
+    largeurBloc = largeurBloc < img->width ? largeurBloc : img->width;
+    hauteurBloc = hauteurBloc < img->height ? hauteurBloc : img->height;
+
+    const struct integrale *t = integraleImage(img);
+    if (t == NULL)
+    {
+        return -1;
+    }
+    int largeur = (img->width + largeurBloc - 1) / largeurBloc;
+    int hauteur = (img->height + hauteurBloc - 1) / hauteurBloc;
+    if (reallocImage(dest, largeur, hauteur) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+
+    struct contexteBlocs ctx = {t, NULL, dest, largeurBloc, hauteurBloc};
+    return executerTuiles(largeur, hauteur, 0, tuileMoyennes, &ctx);
+}
+
+/**
+ * Chaque pixel de la sortie prend la valeur de la moyenne de son bloc ; les lignes d'une
+ * même rangée de blocs sont identiques, seule la première est construite
+ */
+static int tuileAgrandir(const struct tuile *tu, void *arg)
+{
+    const struct contexteBlocs *ctx = arg;
+    int lb = ctx->largeurBloc, hb = ctx->hauteurBloc;
+    size_t n = (size_t)(tu->x1 - tu->x0);
+    for (int y = tu->y0; y < tu->y1; y++)
+    {
+        unsigned char *dst = imageRow(ctx->dest, y) + tu->x0;
+        if (y > tu->y0 && y % hb != 0)
+        {
+            memcpy(dst, dst - ctx->dest->stride, n);
+            continue;
+        }
+
+        const unsigned char *src = imageRow(ctx->moyennes, y / hb);
+        int x = tu->x0;
+        while (x < tu->x1)
+        {
+            int i = x / lb;
+            int fin = (i + 1) * lb < tu->x1 ? (i + 1) * lb : tu->x1;
+            unsigned char valeur = src[i];
+            for (; x < fin; x++)
+            {
+                dst[x - tu->x0] = valeur;
+            }
+        }
+    }
+    return 0;
+}
+
+int pixeliserBlocs(struct imageNB *img, struct imageNB *dest, int largeurBloc, int hauteurBloc)
+{
+    if (img == NULL || img->color == NULL || largeurBloc < 1 || hauteurBloc < 1)
+    {
+        printf("Invalid parameters for pixeliserBlocs\n");
+        return -1;
+    }
+    largeurBloc = largeurBloc < img->width ? largeurBloc : img->width;
+    hauteurBloc = hauteurBloc < img->height ? hauteurBloc : img->height;
+
+    // Des blocs d'un pixel laissent l'image inchangée
+    if (largeurBloc == 1 && hauteurBloc == 1)
+    {
+        if (dest != img)
+        {
+            copyImage(img, dest);
+        }
+        return img->data != NULL && dest->data != NULL ? 0 : -1;
+    }
+
+    struct imageNB moyennes = {0};
+    if (moyenneBlocs(img, &moyennes, largeurBloc, hauteurBloc) != 0)
+    {
+        freeImageMemory(&moyennes);
+        return -1;
+    }
+
+    // Sur place, les pixels partagés avec une autre image sont d'abord recopiés
+    int resultat = dest == img ? modifierImage(img) : reallocImage(dest, img->width, img->height);
+    if (resultat == 0)
+    {
+        dest->vmax = img->vmax;
+        struct contexteBlocs ctx = {NULL, &moyennes, dest, largeurBloc, hauteurBloc};
+        resultat = executerTuiles(img->width, img->height, 0, tuileAgrandir, &ctx);
+    }
+    freeImageMemory(&moyennes);
+    return resultat;
+}
@@ -0,0 +1,113 @@
+#ifndef _INTEGRALE_H_
+#define _INTEGRALE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+/**
+ * Aire maximale d'un rectangle dont sommeRectangle donne la somme exacte (255 x aire < 2^32)
+ */
+#define INTEGRALE_AIRE_MAX (UINT32_MAX / 255)
+
+/**
+ * Même limite pour une table des carrés (255² x aire < 2^32, un carré de 257 x 257 pixels)
+ */
+#define INTEGRALE_CARRES_AIRE_MAX (UINT32_MAX / (255 * 255))
+
+/**
+ * Table des sommes (summed-area table) d'une image
+ *
+ * somme[y * pas + x] est la somme des pixels [0, x[ x [0, y[ de l'image, pour
+ * 0 <= x <= largeur et 0 <= y <= hauteur : la somme de n'importe quel rectangle se lit en
+ * quatre accès. Les sommes sont calculées modulo 2^32 ; la différence reste exacte pour
+ * tout rectangle d'au plus INTEGRALE_AIRE_MAX pixels, quelle que soit la taille de l'image.
+ */
+struct integrale
+{
+    int largeur;
+    int hauteur;
+    size_t pas;
+    uint32_t *somme;
+};
+
+/**
+ * Fonction qui calcule la table des sommes d'une image
+ * Les lignes sont réparties en bandes calculées en parallèle, puis chaque bande reçoit la
+ * dernière ligne des bandes précédentes.
+ * @param img
+ * @param t table à libérer avec integraleLiberer
+ * @return 0 si la table est prête, -1 sinon
+ */
+int integraleCalculer(const struct imageNB *img, struct integrale *t);
+
+/**
+ * Fonction qui calcule la table des sommes des carrés des pixels d'une image
+ * Même organisation que integraleCalculer ; sommeRectangle y donne la somme des carrés,
+ * exacte pour tout rectangle d'au plus INTEGRALE_CARRES_AIRE_MAX pixels.
+ * @param img
+ * @param t table à libérer avec integraleLiberer
+ * @return 0 si la table est prête, -1 sinon
+ */
+int integraleCarresCalculer(const struct imageNB *img, struct integrale *t);
+
+/**
+ * Fonction qui libère une table des sommes
+ * @param t
+ */
+void integraleLiberer(struct integrale *t);
+
+/**
+ * Fonction qui renvoie la somme des pixels du rectangle [x0, x1[ x [y0, y1[
+ * Exacte si le rectangle a au plus INTEGRALE_AIRE_MAX pixels (voir sommeBloc sinon).
+ * @param t
+ * @param x0
+ * @param y0
+ * @param x1
+ * @param y1
+ * @return
+ */
+static inline uint32_t sommeRectangle(const struct integrale *t, int x0, int y0, int x1, int y1)
+{
+    const uint32_t *haut = t->somme + (size_t)y0 * t->pas;
+    const uint32_t *bas = t->somme + (size_t)y1 * t->pas;
+    return bas[x1] - bas[x0] - haut[x1] + haut[x0];
+}
+
+/**
+ * Fonction qui renvoie la somme des pixels d'un rectangle de taille quelconque
+ * @param t
+ * @param x0
+ * @param y0
+ * @param x1
+ * @param y1
+ * @return
+ */
+uint64_t sommeBloc(const struct integrale *t, int x0, int y0, int x1, int y1);
+
+/**
+ * Fonction qui réduit une image à la moyenne de chacun de ses blocs
+ * Le pixel (i, j) de la sortie est la moyenne entière (tronquée) du bloc
+ * [i * largeurBloc, (i + 1) * largeurBloc[ x [j * hauteurBloc, (j + 1) * hauteurBloc[,
+ * coupé au bord de l'image ; chaque bloc coûte quatre accès à la table des sommes de img,
+ * gardée avec l'image (voir integraleImage) pour les demandes suivantes.
+ * @param img
+ * @param dest image initialisée, différente de img
+ * @param largeurBloc
+ * @param hauteurBloc
+ * @return 0 si la réduction a réussi, -1 sinon
+ */
+int moyenneBlocs(struct imageNB *img, struct imageNB *dest, int largeurBloc, int hauteurBloc);
+
+/**
+ * Fonction qui pixélise une image : chaque bloc prend la valeur de sa moyenne
+ * @param img
+ * @param dest image initialisée, éventuellement img elle-même
+ * @param largeurBloc
+ * @param hauteurBloc
+ * @return 0 si la pixélisation a réussi, -1 sinon
+ */
+int pixeliserBlocs(struct imageNB *img, struct imageNB *dest, int largeurBloc, int hauteurBloc);
+
+#endif
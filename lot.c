@@ -0,0 +1,612 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "lot.h"
+#include "attente.h"
+#include "pgm.h"
+#include "dallage.h"
+#include "parallele.h"
+#include "trace.h"
+
+/**
+ * Longueur maximale d'un nom de fichier de sortie
+ */
+#define LOT_CHEMIN 4096
+
+/**
+ * Étages de la chaîne lecture -> calcul -> écriture
+ */
+enum etageLot
+{
+    ETAGE_LECTURE,
+    ETAGE_CALCUL,
+    ETAGE_ECRITURE,
+    NB_ETAGES
+};
+
+/**
+ * Une image qui passe d'un étage à l'autre ; indice < 0 marque la fin du lot
+ */
+struct elementLot
+{
+    int indice;
+    int resultat;
+    struct imageNB img;
+    struct masque masque; // résultat d'un lot de masques .pbm (bits NULL sinon)
+};
+
+/**
+ * État partagé par les threads d'un lot
+ */
+struct contexteLot
+{
+    const struct pipeline *p;
+    char **fichiers;
+    int nb;
+    const char *modele;
+    int lignesParBande;
+    int masques; // les sorties sont des masques .pbm
+    double debut;
+
+    atomic_int prochain;
+    atomic_int faits;
+    atomic_int reussis;
+    atomic_int echecs;
+
+    // Chaîne : files entre les étages, calculs en cours et temps de travail de chaque étage (ns)
+    struct fileAttente lues;
+    struct fileAttente calculees;
+    struct fileAttente jetons; // un jeton par image en mémoire : pris à la lecture, rendu après l'écriture
+    atomic_int calculsActifs;
+    atomic_llong occupe[NB_ETAGES];
+};
+
+static double maintenant(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int estLot(const char *source)
+{
+    struct stat st;
+    return source[0] == '@' || (stat(source, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+/**
+ * Ajoute une copie de chemin à la liste, agrandie si besoin
+ */
+static int ajouterFichier(char ***fichiers, int *nb, int *capacite, const char *chemin)
+{
+    if (*nb == *capacite)
+    {
+        int nouvelle = *capacite ? 2 * *capacite : 256;
+        char **agrandi = realloc(*fichiers, (size_t)nouvelle * sizeof(char *));
+        if (agrandi == NULL)
+        {
+            printf("ERROR allocating memory\n");
+            return -1;
+        }
+        *fichiers = agrandi;
+        *capacite = nouvelle;
+    }
+    (*fichiers)[*nb] = strdup(chemin);
+    if ((*fichiers)[*nb] == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    (*nb)++;
+    return 0;
+}
+
+static int comparerNoms(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * Liste les fichiers d'une liste @liste.txt, un par ligne
+ */
+static int listerFichier(const char *nomListe, char ***fichiers, int *nb, int *capacite)
+{
+    FILE *liste = fopen(nomListe, "r");
+    if (liste == NULL)
+    {
+        printf("--> %s not found \n", nomListe);
+        return -1;
+    }
+
+    int resultat = 0;
+    char *ligne = NULL;
+    size_t taille = 0;
+    while (resultat == 0 && getline(&ligne, &taille, liste) != -1)
+    {
+        size_t n = strlen(ligne);
+        while (n > 0 && (ligne[n - 1] == '\n' || ligne[n - 1] == '\r' || ligne[n - 1] == ' ' || ligne[n - 1] == '\t'))
+        {
+            ligne[--n] = '\0';
+        }
+        if (n > 0 && ligne[0] != '#')
+        {
+            resultat = ajouterFichier(fichiers, nb, capacite, ligne);
+        }
+    }
+    free(ligne);
+    fclose(liste);
+    return resultat;
+}
+
+/**
+ * Liste les images d'un dossier (fichiers .pgm et .imt), triées par nom
+ */
+static int listerDossier(const char *dossier, char ***fichiers, int *nb, int *capacite)
+{
+    DIR *d = opendir(dossier);
+    if (d == NULL)
+    {
+        printf("--> %s not found \n", dossier);
+        return -1;
+    }
+
+    int resultat = 0;
+    char chemin[LOT_CHEMIN];
+    struct dirent *entree;
+    while (resultat == 0 && (entree = readdir(d)) != NULL)
+    {
+        size_t n = strlen(entree->d_name);
+        if (n <= 4 || (strcasecmp(entree->d_name + n - 4, ".pgm") != 0 && !estNomDallage(entree->d_name)))
+        {
+            continue;
+        }
+        if (snprintf(chemin, sizeof(chemin), "%s/%s", dossier, entree->d_name) >= (int)sizeof(chemin))
+        {
+            printf("Path too long: %s/%s\n", dossier, entree->d_name);
+            continue;
+        }
+        resultat = ajouterFichier(fichiers, nb, capacite, chemin);
+    }
+    closedir(d);
+
+    if (resultat == 0)
+    {
+        qsort(*fichiers, (size_t)*nb, sizeof(char *), comparerNoms);
+    }
+    return resultat;
+}
+
+int listerLot(const char *source, char ***fichiers, int *nb)
+{
+    int capacite = 0;
+    *fichiers = NULL;
+    *nb = 0;
+
+    int resultat;
+    if (source[0] == '@')
+    {
+        resultat = listerFichier(source + 1, fichiers, nb, &capacite);
+    }
+    else
+    {
+        resultat = listerDossier(source, fichiers, nb, &capacite);
+    }
+
+    if (resultat == 0 && *nb == 0)
+    {
+        printf("No PGM file in %s\n", source);
+        resultat = -1;
+    }
+    if (resultat != 0)
+    {
+        libererLot(*fichiers, *nb);
+        *fichiers = NULL;
+        *nb = 0;
+    }
+    return resultat;
+}
+
+void libererLot(char **fichiers, int nb)
+{
+    for (int i = 0; i < nb; i++)
+    {
+        free(fichiers[i]);
+    }
+    free(fichiers);
+}
+
+int nomSortieLot(const char *modele, const char *entree, int indice, char *sortie, size_t taille)
+{
+    const char *nom = strrchr(entree, '/');
+    nom = nom != NULL ? nom + 1 : entree;
+
+    if (strchr(modele, '{') == NULL)
+    {
+        return snprintf(sortie, taille, "%s/%s", modele, nom) < (int)taille ? 0 : -1;
+    }
+
+    const char *extension = strrchr(nom, '.');
+    int longueurNom = extension != NULL && extension != nom ? (int)(extension - nom) : (int)strlen(nom);
+
+    size_t n = 0;
+    for (const char *m = modele; *m != '\0' && n < taille;)
+    {
+        int ecrit;
+        if (strncmp(m, "{nom}", 5) == 0)
+        {
+            ecrit = snprintf(sortie + n, taille - n, "%.*s", longueurNom, nom);
+            m += 5;
+        }
+        else if (strncmp(m, "{index}", 7) == 0)
+        {
+            ecrit = snprintf(sortie + n, taille - n, "%06d", indice);
+            m += 7;
+        }
+        else
+        {
+            sortie[n] = *m++;
+            ecrit = 1;
+        }
+        n += (size_t)ecrit;
+    }
+    if (n >= taille)
+    {
+        return -1;
+    }
+    sortie[n] = '\0';
+    return 0;
+}
+
+/**
+ * Compte le résultat d'un fichier et affiche la progression
+ */
+static void terminerFichier(struct contexteLot *ctx, int i, int resultat)
+{
+    if (resultat == 0)
+    {
+        atomic_fetch_add(&ctx->reussis, 1);
+    }
+    else
+    {
+        atomic_fetch_add(&ctx->echecs, 1);
+        printf("Failed: %s\n", ctx->fichiers[i]);
+    }
+
+    int faits = atomic_fetch_add(&ctx->faits, 1) + 1;
+    if (faits % LOT_PROGRES == 0)
+    {
+        printf("%d/%d images, %.1f images/s\n", faits, ctx->nb, faits / (maintenant() - ctx->debut));
+    }
+}
+
+/**
+ * Ajoute le temps écoulé depuis debut au travail d'un étage
+ */
+static void compterTravail(struct contexteLot *ctx, enum etageLot etage, double debut)
+{
+    atomic_fetch_add_explicit(&ctx->occupe[etage], (long long)((maintenant() - debut) * 1e9), memory_order_relaxed);
+}
+
+/**
+ * Premier étage : charge les fichiers dans l'ordre, puis signale la fin à chaque calcul
+ */
+static void *lecteurLot(void *arg)
+{
+    struct contexteLot *ctx = arg;
+    for (int i = 0; i < ctx->nb; i++)
+    {
+        int jeton;
+        fileRetirerAttendre(&ctx->jetons, &jeton);
+        struct elementLot e = {i, 0, {0}, {0}};
+        double debut = maintenant();
+        e.resultat = loadImage(&e.img, ctx->fichiers[i]);
+        compterTravail(ctx, ETAGE_LECTURE, debut);
+        fileDeposerAttendre(&ctx->lues, &e);
+    }
+
+    struct elementLot fin = {-1, 0, {0}, {0}};
+    for (int k = atomic_load(&ctx->calculsActifs); k > 0; k--)
+    {
+        fileDeposerAttendre(&ctx->lues, &fin);
+    }
+    return NULL;
+}
+
+/**
+ * Deuxième étage : applique le pipeline ; le dernier calcul à finir signale la fin à l'écriture
+ */
+static void *calculLot(void *arg)
+{
+    struct contexteLot *ctx = arg;
+    struct imageNB tampon = {0};
+    struct elementLot e;
+
+    for (;;)
+    {
+        fileRetirerAttendre(&ctx->lues, &e);
+        if (e.indice < 0)
+        {
+            break;
+        }
+        if (e.resultat == 0)
+        {
+            double debut = maintenant();
+            e.resultat = ctx->masques ? pipelineExecuterMasque(ctx->p, &e.img, &tampon, &e.masque)
+                                      : pipelineExecuter(ctx->p, &e.img, &tampon);
+            compterTravail(ctx, ETAGE_CALCUL, debut);
+        }
+        fileDeposerAttendre(&ctx->calculees, &e);
+    }
+
+    freeImageMemory(&tampon);
+    if (atomic_fetch_sub(&ctx->calculsActifs, 1) == 1)
+    {
+        fileDeposerAttendre(&ctx->calculees, &e);
+    }
+    return NULL;
+}
+
+/**
+ * Troisième étage : enregistre les résultats et rend les images à la réserve
+ */
+static void ecrivainLot(struct contexteLot *ctx)
+{
+    char sortie[LOT_CHEMIN];
+    struct elementLot e;
+
+    for (;;)
+    {
+        fileRetirerAttendre(&ctx->calculees, &e);
+        if (e.indice < 0)
+        {
+            break;
+        }
+        if (e.resultat == 0)
+        {
+            if (nomSortieLot(ctx->modele, ctx->fichiers[e.indice], e.indice, sortie, sizeof(sortie)) != 0)
+            {
+                printf("Output name too long for %s\n", ctx->fichiers[e.indice]);
+                e.resultat = -1;
+            }
+            else
+            {
+                double debut = maintenant();
+                e.resultat = ctx->masques ? saveMasquePBM(&e.masque, sortie) : saveImage(&e.img, sortie);
+                compterTravail(ctx, ETAGE_ECRITURE, debut);
+            }
+        }
+        freeImageMemory(&e.img);
+        masqueLiberer(&e.masque);
+        fileDeposerAttendre(&ctx->jetons, &e.indice);
+        terminerFichier(ctx, e.indice, e.resultat);
+    }
+}
+
+/**
+ * Affiche l'occupation des étages et des files de la chaîne
+ */
+static void afficherMesures(struct contexteLot *ctx, int calculs, int images, double secondes)
+{
+    static const char *noms[NB_ETAGES] = {"read", "compute", "write"};
+    int threads[NB_ETAGES] = {1, calculs, 1};
+    double occupation[NB_ETAGES];
+    int goulet = 0;
+
+    printf("\n%-16s %8s %8s\n", "Stage", "Threads", "Busy %");
+    for (int k = 0; k < NB_ETAGES; k++)
+    {
+        occupation[k] = secondes > 0 ? atomic_load(&ctx->occupe[k]) * 1e-9 / (threads[k] * secondes) * 100 : 0;
+        goulet = occupation[k] > occupation[goulet] ? k : goulet;
+        printf("%-16s %8d %8.1f\n", noms[k], threads[k], occupation[k]);
+    }
+
+    printf("\n%-16s %8s %10s %10s %11s %12s\n", "Queue", "Capacity", "Mean depth", "Max depth", "Full waits",
+           "Empty waits");
+    // Les jetons disponibles : une attente « vide » est une lecture retenue par la limite d'images
+    struct fileAttente *files[3] = {&ctx->lues, &ctx->calculees, &ctx->jetons};
+    const char *nomsFiles[3] = {"read->compute", "compute->write", "free images"};
+    for (int k = 0; k < 3; k++)
+    {
+        struct statsFile st;
+        fileStats(files[k], &st);
+        printf("%-16s %8zu %10.2f %10zu %11zu %12zu\n", nomsFiles[k], st.capacite, st.profondeurMoyenne,
+               st.profondeurMax, st.attentesPleine, st.attentesVide);
+    }
+    printf("Images in memory: at most %d\n", images);
+    printf("Bottleneck: %s\n\n", noms[goulet]);
+}
+
+/**
+ * Chaîne à trois étages : un thread de lecture, `calculs` threads de calcul et l'écriture dans
+ * le thread appelant, reliés par deux files bornées
+ * Au plus `calculs` images sont en mémoire à la fois, lues, en calcul ou à écrire : le lecteur
+ * prend un jeton avant chaque lecture, et l'écriture le rend une fois l'image libérée.
+ * @return 0 si la chaîne a traité le lot, -1 si elle n'a pas pu démarrer
+ */
+static int executerChaine(struct contexteLot *ctx, int calculs)
+{
+    // Les jetons bornent les images ; les files ont une case de plus pour les marques de fin
+    if (fileInit(&ctx->jetons, calculs, sizeof(int)) != 0)
+    {
+        return -1;
+    }
+    for (int k = 0; k < calculs; k++)
+    {
+        fileDeposer(&ctx->jetons, &k);
+    }
+    if (fileInit(&ctx->lues, calculs + 1, sizeof(struct elementLot)) != 0)
+    {
+        fileLiberer(&ctx->jetons);
+        return -1;
+    }
+    if (fileInit(&ctx->calculees, calculs + 1, sizeof(struct elementLot)) != 0)
+    {
+        fileLiberer(&ctx->lues);
+        fileLiberer(&ctx->jetons);
+        return -1;
+    }
+    for (int k = 0; k < NB_ETAGES; k++)
+    {
+        atomic_init(&ctx->occupe[k], 0);
+    }
+
+    pthread_t lecteur;
+    pthread_t threads[calculs];
+    int lances = 0;
+    for (int i = 0; i < calculs; i++)
+    {
+        if (pthread_create(&threads[lances], NULL, calculLot, ctx) != 0)
+        {
+            printf("Unable to start thread %d, using %d threads\n", i, i);
+            break;
+        }
+        lances++;
+    }
+    atomic_init(&ctx->calculsActifs, lances);
+
+    int resultat = 0;
+    if (lances > 0 && pthread_create(&lecteur, NULL, lecteurLot, ctx) == 0)
+    {
+        ecrivainLot(ctx);
+        pthread_join(lecteur, NULL);
+        afficherMesures(ctx, lances, calculs, maintenant() - ctx->debut);
+    }
+    else
+    {
+        // Les calculs lancés s'arrêtent sans avoir rien reçu
+        printf("Unable to start the pipeline threads\n");
+        struct elementLot fin = {-1, 0, {0}, {0}};
+        for (int k = 0; k < lances; k++)
+        {
+            fileDeposerAttendre(&ctx->lues, &fin);
+        }
+        resultat = -1;
+    }
+    for (int i = 0; i < lances; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    fileLiberer(&ctx->lues);
+    fileLiberer(&ctx->calculees);
+    fileLiberer(&ctx->jetons);
+    return resultat;
+}
+
+/**
+ * Traite le fichier i du lot en entier (lecture, pipeline, écriture)
+ */
+static int traiterFichier(struct contexteLot *ctx, int i)
+{
+    char sortie[LOT_CHEMIN];
+    if (nomSortieLot(ctx->modele, ctx->fichiers[i], i, sortie, sizeof(sortie)) != 0)
+    {
+        printf("Output name too long for %s\n", ctx->fichiers[i]);
+        return -1;
+    }
+    if (ctx->lignesParBande >= 0)
+    {
+        return pipelineExecuterBandes(ctx->p, ctx->fichiers[i], sortie, ctx->lignesParBande);
+    }
+
+    struct imageNB img = {0};
+    struct imageNB tampon = {0};
+    struct masque m = {0};
+    int resultat = loadImage(&img, ctx->fichiers[i]);
+    if (resultat == 0)
+    {
+        resultat = ctx->masques ? pipelineExecuterMasque(ctx->p, &img, &tampon, &m)
+                                : pipelineExecuter(ctx->p, &img, &tampon);
+    }
+    if (resultat == 0)
+    {
+        resultat = ctx->masques ? saveMasquePBM(&m, sortie) : saveImage(&img, sortie);
+    }
+    freeImageMemory(&img);
+    masqueLiberer(&m);
+    freeImageMemory(&tampon);
+    return resultat;
+}
+
+/**
+ * Sans chaîne (par bandes, ou si ses threads n'ont pas démarré) : chaque thread traite un
+ * fichier entier à la fois
+ */
+static void *travailleurLot(void *arg)
+{
+    struct contexteLot *ctx = arg;
+    for (;;)
+    {
+        int i = atomic_fetch_add(&ctx->prochain, 1);
+        if (i >= ctx->nb)
+        {
+            break;
+        }
+
+        struct traceZone zone;
+        traceOuvrir(&zone, "batch item");
+        int resultat = traiterFichier(ctx, i);
+        traceFermer(&zone);
+        terminerFichier(ctx, i, resultat);
+    }
+    return NULL;
+}
+
+int executerLot(const struct pipeline *p, char **fichiers, int nb, const char *modele, int enCours, int lignesParBande,
+                struct bilanLot *bilan)
+{
+    struct contexteLot ctx;
+    ctx.p = p;
+    ctx.fichiers = fichiers;
+    ctx.nb = nb;
+    ctx.modele = modele;
+    ctx.lignesParBande = lignesParBande;
+    // Sans {nom} ni {index}, les sorties gardent le nom (et l'extension) des entrées
+    ctx.masques = strchr(modele, '{') != NULL && estNomPBM(modele);
+    ctx.debut = maintenant();
+    atomic_init(&ctx.prochain, 0);
+    atomic_init(&ctx.faits, 0);
+    atomic_init(&ctx.reussis, 0);
+    atomic_init(&ctx.echecs, 0);
+
+    if (enCours <= 0)
+    {
+        enCours = parallelThreads();
+    }
+    enCours = enCours < nb ? enCours : nb;
+
+    if (lignesParBande >= 0 || executerChaine(&ctx, enCours) != 0)
+    {
+        // Le thread appelant traite aussi des fichiers
+        pthread_t threads[enCours > 1 ? enCours - 1 : 1];
+        int lances = 0;
+        for (int i = 1; i < enCours; i++)
+        {
+            if (pthread_create(&threads[lances], NULL, travailleurLot, &ctx) != 0)
+            {
+                printf("Unable to start thread %d, using %d threads\n", i, i);
+                break;
+            }
+            lances++;
+        }
+        travailleurLot(&ctx);
+        for (int i = 0; i < lances; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    bilan->reussis = atomic_load(&ctx.reussis);
+    bilan->echecs = nb - bilan->reussis;
+    bilan->secondes = maintenant() - ctx.debut;
+    printf("Batch: %d images in %.2f s (%.1f images/s), %d failed\n", bilan->reussis, bilan->secondes,
+           bilan->secondes > 0 ? bilan->reussis / bilan->secondes : 0, bilan->echecs);
+    return bilan->echecs == 0 ? 0 : -1;
+}
@@ -0,0 +1,86 @@
+#ifndef _LOT_H_
+#define _LOT_H_
+
+#include <stddef.h>
+
+#include "pipeline.h"
+
+/**
+ * Nombre d'images entre deux lignes de progression
+ */
+#define LOT_PROGRES 1000
+
+/**
+ * Bilan d'un traitement par lot
+ */
+struct bilanLot
+{
+    int reussis;
+    int echecs;
+    double secondes;
+};
+
+/**
+ * Fonction qui indique si une entrée désigne un lot : un dossier, ou une liste de fichiers
+ * écrite @liste.txt
+ * @param source
+ * @return 1 pour un lot, 0 sinon
+ */
+int estLot(const char *source);
+
+/**
+ * Fonction qui établit la liste des fichiers d'un lot
+ * Pour un dossier, ce sont ses fichiers .pgm triés par nom ; pour @liste.txt, un chemin par
+ * ligne (les lignes vides et celles qui commencent par # sont ignorées).
+ * @param source
+ * @param fichiers tableau alloué, à libérer avec libererLot
+ * @param nb
+ * @return 0 si la liste est prête, -1 sinon
+ */
+int listerLot(const char *source, char ***fichiers, int *nb);
+
+/**
+ * Fonction qui libère une liste de fichiers établie par listerLot
+ * @param fichiers
+ * @param nb
+ */
+void libererLot(char **fichiers, int nb);
+
+/**
+ * Fonction qui construit le nom de sortie d'un fichier du lot
+ * Dans le modèle, {nom} est remplacé par le nom du fichier d'entrée sans dossier ni
+ * extension et {index} par son rang dans le lot (sur 6 chiffres). Un modèle sans accolade
+ * est un dossier, dans lequel la sortie garde le nom de l'entrée.
+ * @param modele
+ * @param entree
+ * @param indice
+ * @param sortie
+ * @param taille
+ * @return 0 si le nom tient dans sortie, -1 sinon
+ */
+int nomSortieLot(const char *modele, const char *entree, int indice, char *sortie, size_t taille);
+
+/**
+ * Fonction qui applique un pipeline à tous les fichiers d'un lot
+ * Le lot passe par une chaîne à trois étages reliés par des files bornées sans verrou : un
+ * thread lit les fichiers, enCours threads appliquent le pipeline et le thread appelant écrit
+ * les résultats, si bien que les lectures et écritures recouvrent les calculs. Au plus
+ * enCours images sont en mémoire à la fois, de leur lecture à leur écriture. L'occupation
+ * de chaque étage et la profondeur des files sont affichées à la fin. Par bandes, chacun des
+ * enCours threads traite un fichier entier à la fois.
+ * Un échec est signalé et compté sans interrompre le lot. Le débit est affiché toutes les
+ * LOT_PROGRES images et à la fin.
+ * @param p
+ * @param fichiers
+ * @param nb
+ * @param modele modèle des noms de sortie (voir nomSortieLot)
+ * @param enCours nombre de threads de calcul et d'images en mémoire ; 0 pour le nombre de
+ * threads du pool
+ * @param lignesParBande traitement par bandes si positif ou nul (voir pipelineExecuterBandes)
+ * @param bilan
+ * @return 0 si toutes les images ont été traitées, -1 sinon
+ */
+int executerLot(const struct pipeline *p, char **fichiers, int nb, const char *modele, int enCours, int lignesParBande,
+                struct bilanLot *bilan);
+
+#endif
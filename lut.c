@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "lut.h"
+#include "parallele.h"
+
+static unsigned char saturer(double v)
+{
+    return (v > 255) ? 255 : (v < 0) ? 0 : (unsigned char)v;
+}
+
+void lutIdentite(struct lut *l)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        l->table[i] = (unsigned char)i;
+    }
+}
+
+void lutAjouter(struct lut *l, int valeur)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        int newValue = l->table[i] + valeur;
+        l->table[i] = (newValue > 255) ? 255 : (newValue < 0) ? 0 : newValue;
+    }
+}
+
+void lutNegatif(struct lut *l, int vmax)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        l->table[i] = (unsigned char)(vmax - l->table[i]);
+    }
+}
+
+void lutSeuillage(struct lut *l, int seuil)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        l->table[i] = (l->table[i] > seuil) ? 255 : 0;
+    }
+}
+
+void lutGamma(struct lut *l, double gamma, int vmax)
+{
+    if (gamma <= 0 || vmax <= 0)
+    {
+        return;
+    }
+
+    // La courbe n'est évaluée que 256 fois, quelle que soit la taille de l'image
+    unsigned char courbe[256];
+    for (int i = 0; i < 256; i++)
+    {
+        courbe[i] = saturer(vmax * pow(i / (double)vmax, 1.0 / gamma) + 0.5);
+    }
+    for (int i = 0; i < 256; i++)
+    {
+        l->table[i] = courbe[l->table[i]];
+    }
+}
+
+void lutCourbe(struct lut *l, const double *points, int nbPoints)
+{
+    if (nbPoints <= 0)
+    {
+        return;
+    }
+
+    unsigned char courbe[256];
+    int p = 0;
+    for (int i = 0; i < 256; i++)
+    {
+        while (p < nbPoints && points[2 * p] < i)
+        {
+            p++;
+        }
+
+        if (p == 0)
+        {
+            courbe[i] = saturer(points[1] + 0.5);
+        }
+        else if (p == nbPoints)
+        {
+            courbe[i] = saturer(points[2 * nbPoints - 1] + 0.5);
+        }
+        else
+        {
+            // Interpolation linéaire entre les points p - 1 et p
+            double x0 = points[2 * p - 2], y0 = points[2 * p - 1];
+            double x1 = points[2 * p], y1 = points[2 * p + 1];
+            double t = (x1 > x0) ? (i - x0) / (x1 - x0) : 1.0;
+            courbe[i] = saturer(y0 + t * (y1 - y0) + 0.5);
+        }
+    }
+    for (int i = 0; i < 256; i++)
+    {
+        l->table[i] = courbe[l->table[i]];
+    }
+}
+
+void appliquerLUTLigne(const unsigned char *src, unsigned char *dst, int n, const struct lut *l)
+{
+    const unsigned char *t = l->table;
+    int x = 0;
+
+    // 8 recherches indépendantes regroupées en une seule écriture de 64 bits
+    for (; x + 8 <= n; x += 8)
+    {
+        uint64_t v;
+        memcpy(&v, src + x, 8);
+        uint64_t r = (uint64_t)t[v & 0xFF] | (uint64_t)t[(v >> 8) & 0xFF] << 8 |
+                     (uint64_t)t[(v >> 16) & 0xFF] << 16 | (uint64_t)t[(v >> 24) & 0xFF] << 24 |
+                     (uint64_t)t[(v >> 32) & 0xFF] << 32 | (uint64_t)t[(v >> 40) & 0xFF] << 40 |
+                     (uint64_t)t[(v >> 48) & 0xFF] << 48 | (uint64_t)t[v >> 56] << 56;
+        memcpy(dst + x, &r, 8);
+    }
+    for (; x < n; x++)
+    {
+        dst[x] = t[src[x]];
+    }
+}
+
+struct contexteLUT
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    const struct lut *l;
+};
+
+static int tuileLUT(const struct tuile *t, void *arg)
+{
+    struct contexteLUT *ctx = arg;
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        appliquerLUTLigne(imageRow(ctx->img, y) + t->x0, imageRow(ctx->dest, y) + t->x0, t->x1 - t->x0, ctx->l);
+    }
+    return 0;
+}
+
+int appliquerLUT(struct imageNB *img, struct imageNB *dest, const struct lut *l)
+{
+    // Sur place, les pixels partagés avec une autre image sont d'abord recopiés
+    int pret = dest == img ? modifierImage(img) : reallocImage(dest, img->width, img->height);
+    if (pret != 0)
+    {
+        return -1;
+    }
+
+    struct contexteLUT ctx = {img, dest, l};
+    int resultat = executerTuiles(img->width, img->height, 0, tuileLUT, &ctx);
+    dest->vmax = img->vmax;
+    return resultat;
+}
@@ -0,0 +1,80 @@
+#ifndef _LUT_H_
+#define _LUT_H_
+
+#include "image.h"
+
+/**
+ * Table de correspondance pour les opérations point à point : sortie = table[entrée]
+ * Chaque fonction lutXxx compose son opération avec celles déjà présentes dans la table,
+ * si bien qu'une suite de réglages ne coûte qu'une seule passe sur l'image.
+ */
+struct lut
+{
+    unsigned char table[256];
+};
+
+/**
+ * Fonction qui initialise une table à l'identité
+ * @param l
+ */
+void lutIdentite(struct lut *l);
+
+/**
+ * Fonction qui ajoute une valeur à chaque niveau (contraste / luminosité), avec saturation
+ * @param l
+ * @param valeur
+ */
+void lutAjouter(struct lut *l, int valeur);
+
+/**
+ * Fonction qui compose la table avec un négatif
+ * @param l
+ * @param vmax
+ */
+void lutNegatif(struct lut *l, int vmax);
+
+/**
+ * Fonction qui compose la table avec un seuillage (255 au-dessus du seuil, 0 sinon)
+ * @param l
+ * @param seuil
+ */
+void lutSeuillage(struct lut *l, int seuil);
+
+/**
+ * Fonction qui compose la table avec une correction gamma
+ * @param l
+ * @param gamma
+ * @param vmax
+ */
+void lutGamma(struct lut *l, double gamma, int vmax);
+
+/**
+ * Fonction qui compose la table avec une courbe de tons linéaire par morceaux
+ * Les points (x, y) doivent être donnés par x croissant ; avant le premier et après le
+ * dernier point, la courbe est constante.
+ * @param l
+ * @param points tableau x0, y0, x1, y1, ...
+ * @param nbPoints
+ */
+void lutCourbe(struct lut *l, const double *points, int nbPoints);
+
+/**
+ * Fonction qui applique une table à toute l'image en une seule passe, répartie en tuiles
+ * sur tous les threads
+ * @param img
+ * @param dest peut être égale à img
+ * @param l
+ * @return 0 si l'opération a réussi, -1 sinon
+ */
+int appliquerLUT(struct imageNB *img, struct imageNB *dest, const struct lut *l);
+
+/**
+ * Fonction qui applique une table à une ligne de pixels
+ * @param src
+ * @param dst peut être égal à src
+ * @param n
+ * @param l
+ */
+void appliquerLUTLigne(const unsigned char *src, unsigned char *dst, int n, const struct lut *l);
+
+#endif
@@ -0,0 +1,231 @@
+#include <string.h>
+
+#include "lz.h"
+
+/**
+ * Taille de la table de hachage des groupes de 4 octets : 2^LZ_HACHAGE_BITS positions
+ */
+#define LZ_HACHAGE_BITS 12
+
+/**
+ * Les derniers octets sont toujours des littéraux, et aucune copie ne commence dans les
+ * LZ_FIN_COPIES derniers octets (les lectures de 4 et 8 octets restent dans la source)
+ */
+#define LZ_FIN_LITTERAUX 5
+#define LZ_FIN_COPIES 12
+
+/**
+ * Taille des copies de taille fixe de la décompression, quand les tampons ont assez de marge
+ */
+#define LZ_BLOC 16
+
+static inline uint32_t lire32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t lire64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hacher(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HACHAGE_BITS);
+}
+
+/**
+ * Écrit la suite d'une longueur de 15 ou plus : des octets 255, puis le reste
+ */
+static uint8_t *ecrireLongueur(uint8_t *op, size_t longueur)
+{
+    for (; longueur >= 255; longueur -= 255)
+    {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)longueur;
+    return op;
+}
+
+/**
+ * Écrit une séquence : nbLitteraux littéraux puis une copie de `longueur` octets à `distance`
+ * (longueur nulle pour la dernière séquence, sans copie)
+ * @return la fin de la séquence, ou NULL si elle ne tient pas avant fin
+ */
+static uint8_t *ecrireSequence(uint8_t *op, const uint8_t *fin, const uint8_t *litteraux, size_t nbLitteraux,
+                               size_t distance, size_t longueur)
+{
+    size_t besoin = 2 + nbLitteraux / 255 + nbLitteraux + (longueur > 0 ? 3 + longueur / 255 : 0);
+    if ((size_t)(fin - op) < besoin)
+    {
+        return NULL;
+    }
+    uint8_t *jeton = op++;
+    *jeton = (uint8_t)((nbLitteraux < 15 ? nbLitteraux : 15) << 4);
+    if (nbLitteraux >= 15)
+    {
+        op = ecrireLongueur(op, nbLitteraux - 15);
+    }
+    memcpy(op, litteraux, nbLitteraux);
+    op += nbLitteraux;
+    if (longueur == 0)
+    {
+        return op;
+    }
+
+    *op++ = (uint8_t)distance;
+    *op++ = (uint8_t)(distance >> 8);
+    size_t reste = longueur - LZ_COPIE_MIN;
+    *jeton |= (uint8_t)(reste < 15 ? reste : 15);
+    if (reste >= 15)
+    {
+        op = ecrireLongueur(op, reste - 15);
+    }
+    return op;
+}
+
+size_t lzCompresser(const uint8_t *src, size_t n, uint8_t *dst, size_t capacite)
+{
+    // Dernière position (plus un) de chaque groupe de 4 octets ; 0 pour une case vide
+    uint32_t table[1 << LZ_HACHAGE_BITS];
+    memset(table, 0, sizeof(table));
+
+    uint8_t *op = dst;
+    const uint8_t *fin = dst + capacite;
+    size_t ancre = 0, i = 0;
+    size_t limite = n > LZ_FIN_COPIES ? n - LZ_FIN_COPIES : 0;
+    while (i < limite)
+    {
+        uint32_t v = lire32(src + i);
+        uint32_t h = hacher(v);
+        size_t ref = table[h];
+        table[h] = (uint32_t)(i + 1);
+        if (ref == 0 || i - (ref - 1) > LZ_DISTANCE_MAX || lire32(src + ref - 1) != v)
+        {
+            // Le pas grandit dans les zones sans copie, qui se compressent mal
+            i += 1 + ((i - ancre) >> 6);
+            continue;
+        }
+        ref--;
+
+        size_t max = n - LZ_FIN_LITTERAUX - i;
+        size_t longueur = LZ_COPIE_MIN;
+        while (longueur + 8 <= max && lire64(src + ref + longueur) == lire64(src + i + longueur))
+        {
+            longueur += 8;
+        }
+        while (longueur < max && src[ref + longueur] == src[i + longueur])
+        {
+            longueur++;
+        }
+
+        op = ecrireSequence(op, fin, src + ancre, i - ancre, i - ref, longueur);
+        if (op == NULL)
+        {
+            return 0;
+        }
+        i += longueur;
+        ancre = i;
+    }
+    op = ecrireSequence(op, fin, src + ancre, n - ancre, 0, 0);
+    return op != NULL ? (size_t)(op - dst) : 0;
+}
+
+/**
+ * Lit la suite d'une longueur de 15 ou plus et l'ajoute à *longueur
+ */
+static int lireLongueur(const uint8_t *src, size_t n, size_t *ip, size_t *longueur)
+{
+    uint8_t octet;
+    do
+    {
+        if (*ip >= n)
+        {
+            return -1;
+        }
+        octet = src[(*ip)++];
+        *longueur += octet;
+    } while (octet == 255);
+    return 0;
+}
+
+int lzDecompresser(const uint8_t *src, size_t n, uint8_t *dst, size_t attendu)
+{
+    size_t ip = 0, op = 0;
+    while (ip < n)
+    {
+        unsigned jeton = src[ip++];
+        size_t nbLitteraux = jeton >> 4;
+        if (nbLitteraux == 15 && lireLongueur(src, n, &ip, &nbLitteraux) != 0)
+        {
+            return -1;
+        }
+        if (nbLitteraux > n - ip || nbLitteraux > attendu - op)
+        {
+            return -1;
+        }
+        if (nbLitteraux <= LZ_BLOC && n - ip >= LZ_BLOC && attendu - op >= LZ_BLOC)
+        {
+            memcpy(dst + op, src + ip, LZ_BLOC);
+        }
+        else
+        {
+            memcpy(dst + op, src + ip, nbLitteraux);
+        }
+        ip += nbLitteraux;
+        op += nbLitteraux;
+        if (ip == n)
+        {
+            break;
+        }
+
+        if (n - ip < 2)
+        {
+            return -1;
+        }
+        size_t distance = (size_t)src[ip] | (size_t)src[ip + 1] << 8;
+        ip += 2;
+        size_t longueur = jeton & 15;
+        if (longueur == 15 && lireLongueur(src, n, &ip, &longueur) != 0)
+        {
+            return -1;
+        }
+        longueur += LZ_COPIE_MIN;
+        if (distance == 0 || distance > op || longueur > attendu - op)
+        {
+            return -1;
+        }
+
+        uint8_t *d = dst + op;
+        const uint8_t *s = d - distance;
+        if (distance >= LZ_BLOC && attendu - op >= longueur + LZ_BLOC)
+        {
+            // Blocs entiers, quitte à déborder : la suite sera réécrite par les séquences suivantes
+            for (size_t fait = 0; fait < longueur; fait += LZ_BLOC)
+            {
+                memcpy(d + fait, s + fait, LZ_BLOC);
+            }
+        }
+        else if (distance >= longueur)
+        {
+            memcpy(d, s, longueur);
+        }
+        else
+        {
+            // Motif de période distance : [s, d + fait[ le contient déjà, recopié par blocs
+            // de plus en plus grands (fait reste un multiple de distance)
+            for (size_t fait = 0; fait < longueur;)
+            {
+                size_t bloc = fait + distance < longueur - fait ? fait + distance : longueur - fait;
+                memcpy(d + fait, s, bloc);
+                fait += bloc;
+            }
+        }
+        op += longueur;
+    }
+    return op == attendu ? 0 : -1;
+}
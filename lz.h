@@ -0,0 +1,51 @@
+#ifndef _LZ_H_
+#define _LZ_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Compression LZ77 par octets, du même principe que LZ4
+ *
+ * Le bloc compressé est une suite de séquences : un octet de longueurs (4 bits pour le nombre
+ * de littéraux, 4 bits pour la longueur de la copie moins LZ_COPIE_MIN ; 15 annonce des
+ * octets supplémentaires, 255 tant que la longueur continue), les littéraux, puis la distance
+ * de la copie sur deux octets (poids faible en premier). La dernière séquence n'a que des
+ * littéraux. Les copies sont trouvées avec une table de hachage des groupes de 4 octets :
+ * une seule passe, sans entropie, pour une décompression de l'ordre du Go/s.
+ */
+
+/**
+ * Longueur minimale d'une copie
+ */
+#define LZ_COPIE_MIN 4
+
+/**
+ * Distance maximale d'une copie
+ */
+#define LZ_DISTANCE_MAX 65535
+
+/**
+ * Fonction qui compresse n octets
+ * @param src
+ * @param n
+ * @param dst
+ * @param capacite taille de dst
+ * @return la taille compressée, ou 0 si elle dépasserait capacite (données incompressibles
+ * si capacite < n)
+ */
+size_t lzCompresser(const uint8_t *src, size_t n, uint8_t *dst, size_t capacite);
+
+/**
+ * Fonction qui décompresse un bloc produit par lzCompresser
+ * Toutes les longueurs et distances sont vérifiées : un bloc corrompu est refusé, jamais
+ * écrit ou lu hors des tampons.
+ * @param src
+ * @param n taille du bloc compressé
+ * @param dst
+ * @param attendu taille exacte des données décompressées
+ * @return 0 si le bloc a été décompressé, -1 s'il est invalide
+ */
+int lzDecompresser(const uint8_t *src, size_t n, uint8_t *dst, size_t attendu);
+
+#endif
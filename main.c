@@ -3,620 +3,418 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <stdbool.h>
+#include <unistd.h>
+#include <stdarg.h>
+
+#include "image.h"
+#include "pgm.h"
+#include "dallage.h"
+#include "operations.h"
+#include "seuil.h"
+#include "pipeline.h"
+#include "lot.h"
+#include "parallele.h"
+#include "trace.h"
+#include "cache.h"
+#include "reserve.h"
 
 #define TAILLE_MAX 1000
 
 /**
- * Structure pour l'image
+ * Fonction qui affiche l'aide de la ligne de commande
+ * @param programme
  */
-struct imageNB
+void usage(const char *programme)
 {
-    int width;
-    int height;
-    unsigned char **color;
-    int vmax;
-};
+    printf("Usage: %s                                   (menu interactif)\n", programme);
+    printf("       %s -i entree.pgm -o sortie.pgm [-p pipeline.txt] [-t threads] [-s lignes] [-T trace]\n"
+           "          [-r x,y,largeur,hauteur] [-j images] [-C cache] [-q] [etape...]\n",
+           programme);
+    printf("\nChaque etape s'ecrit nom[:param1[,param2...]], par exemple :\n");
+    printf("  %s -i input.pgm -o out.pgm flouter sobel seuillage:128\n", programme);
+    printf("\nLe nombre de threads vaut par defaut IMAGE_THREADS, ou le nombre de coeurs.\n");
+    printf("Les tampons liberes sont gardes pour les operations suivantes, jusqu'a IMAGE_POOL Mo (256).\n");
+    printf("Avec -s, l'image est traitee par bandes de lignes sans etre chargee en entier\n");
+    printf("(0 = taille automatique) ; seules les operations locales sont alors possibles.\n");
+    printf("Avec -T fichier.json (ou IMAGE_TRACE=fichier.json), les temps de chaque etape, les octets\n");
+    printf("lus et ecrits et les allocations de tampons sont enregistres au format Chrome trace ;\n");
+    printf("-T - affiche un tableau recapitulatif.\n");
+    printf("Avec -r, seul le rectangle indique et le voisinage dont depend son resultat sont lus\n");
+    printf("dans le fichier : le resultat est celui de l'image entiere, recadre. Si une etape a besoin\n");
+    printf("de toute l'image, le rectangle est traite seul, comme une image entiere.\n");
+    printf("Une sortie .pbm enregistre un masque d'un bit par pixel (blanc au-dessus de 127), par\n");
+    printf("exemple apres otsu ou sauvola ; elle demande l'image entiere. Si la derniere etape est un\n");
+    printf("seuil (seuillage, otsu, sauvola, adaptatif), il ecrit directement le masque.\n");
+    printf("filtre lit un noyau dans un fichier : une image .pgm (normalisee a une somme de 1) ou\n");
+    printf("un texte 'largeur hauteur c1 c2 ...' ; avec correlation=1, une image .pgm donne le filtre\n");
+    printf("adapte au motif qu'elle contient.\n");
+    printf("Une entree ou une sortie .imt est une image dallee : des dalles de 256x256 compressees\n");
+    printf("separement, dont -r et -s ne lisent que celles qu'ils touchent. Sans etape, le programme\n");
+    printf("convertit sans perte entre .pgm et .imt.\n");
+    printf("Avec -C dossier (ou IMAGE_CACHE_DIR=dossier), les resultats sont gardes dans ce dossier\n");
+    printf("et en memoire (jusqu'a IMAGE_CACHE Mo, 64 par defaut) : les memes etapes sur les memes\n");
+    printf("pixels ne sont plus recalculees. -C - garde les resultats en memoire seulement. Le\n");
+    printf("traitement par bandes (-s) n'utilise pas le cache. Le menu interactif n'utilise le cache\n");
+    printf("qu'avec IMAGE_CACHE_DIR (IMAGE_CACHE_DIR=- pour la memoire seulement).\n");
+    printf("\nMode lot : -i est un dossier (ses fichiers .pgm) ou @liste.txt (un fichier par ligne), et -o\n");
+    printf("un dossier ou un modele de nom ou {nom} et {index} sont remplaces, par exemple\n");
+    printf("-o 'sortie/{nom}_flou.pgm'. Un thread lit, -j threads calculent (par defaut le nombre de\n");
+    printf("threads) et un thread ecrit, en meme temps, avec au plus -j images en memoire ; un echec\n");
+    printf("n'interrompt pas le lot.\n");
+    printf("\nOperations disponibles :\n");
+    afficherOperations(stdout);
+}
 
 /**
- * Fonction pour charger une image au format .pgm
- * @param img
+ * Fonction qui charge le rectangle x,y,largeur,hauteur d'un fichier, sans lire le reste
+ * Les marges sont lues autour du rectangle, dans la limite de l'image : l'image obtenue est
+ * une image à part entière (et non une vue) dont les bords sont répliqués, et *rectangle
+ * reçoit la place du rectangle demandé. Des marges négatives valent 0 : seul le rectangle
+ * est lu, comme s'il était un fichier à lui seul.
+ * @param img image initialisée
  * @param nomImage
+ * @param texte "x,y,largeur,hauteur"
+ * @param margeX
+ * @param margeY
+ * @param rectangle
+ * @return 0 si le chargement a réussi, -1 sinon
  */
-void loadPGM(struct imageNB *img, char *nomImage)
+int chargerRegion(struct imageNB *img, const char *nomImage, const char *texte, int margeX, int margeY,
+                  struct tuile *rectangle)
 {
-    FILE *fichier = fopen(nomImage, "rb");
-
-    if (fichier != NULL)
+    int x, y, largeur, hauteur;
+    if (sscanf(texte, "%d,%d,%d,%d", &x, &y, &largeur, &hauteur) != 4)
     {
-        char chaine[3];
-        int verif = fscanf(fichier, "%2s", chaine); // Read only 2 characters to avoid buffer overflow
-
-        printf("%s\n", chaine);
-
-        if (chaine[1] == '5') // Equal to the format 'P5'
-        {
-            fscanf(fichier, "%d %d", &img->width, &img->height);
-
-            fscanf(fichier, "%d", &img->vmax);
-
-            img->color = malloc(img->height * sizeof(unsigned char *));
-            if (img->color == NULL)
-            {
-                printf("ERROR allocating memory\n");
-                fclose(fichier);
-                return;
-            }
-
-            for (int i = 0; i < img->height; i++)
-            {
-                img->color[i] = malloc(img->width * sizeof(unsigned char));
-                if (img->color[i] == NULL)
-                {
-                    printf("ERROR allocating memory for row %d\n", i);
-                    fclose(fichier);
-                    return;
-                }
-            }
-
-            printf("Height = %d\nWidth = %d, %d\n", img->height, img->width, img->vmax);
-            for (int i = 0; i < img->height; i++)
-            {
-                for (int j = 0; j < img->width; j++)
-                {
-                    unsigned char tmp;
-                    fread(&tmp, sizeof(unsigned char), 1, fichier);
-                    img->color[i][j] = tmp;
-                }
-            }
-            fclose(fichier);
-        }
-        else
-        {
-            printf("Unknown format\n");
-        }
+        printf("Invalid region: %s\n", texte);
+        return -1;
     }
-    else
+
+    // Une image dallée ne lit que les dalles du rectangle, un fichier .pgm que ses lignes
+    struct fluxPGM flux;
+    struct dallage dallage;
+    int dalle = estNomDallage(nomImage);
+    if ((dalle ? ouvrirDallage(&dallage, nomImage) : ouvrirFluxPGM(&flux, nomImage)) != 0)
     {
-        printf("--> %s not found \n", nomImage);
+        return -1;
     }
-}
+    int width = dalle ? dallage.width : flux.width;
+    int height = dalle ? dallage.height : flux.height;
 
-/**
- * Fonction pour enregistrer une image au format .pgm
- * @param img
- * @param nomImage
- */
-void savePGM(struct imageNB *img, char *nomImage)
-{
-    FILE *fichier = fopen(nomImage, "wb");
-    if (fichier != NULL)
+    int resultat = -1;
+    if (x < 0 || y < 0 || largeur <= 0 || hauteur <= 0 || largeur > width - x || hauteur > height - y)
     {
-        fprintf(fichier, "P5\n");
-        fprintf(fichier, "%d %d\n255\n", img->width, img->height);
-        for (int i = 0; i < img->height; i++)
-        {
-            for (int j = 0; j < img->width; j++)
-            {
-                unsigned char tmp = img->color[i][j];
-                fwrite(&tmp, sizeof(unsigned char), 1, fichier);
-            }
-        }
-        fclose(fichier);
+        printf("Region %s is outside the %dx%d image\n", texte, width, height);
     }
     else
     {
-        printf("Unable to create file: %s \n", nomImage);
-    }
-}
-
-/**
- * Fonction pour copié une image
- * @param src
- * @param dest
- */
-void copyImage(struct imageNB *src, struct imageNB *dest) {
-    dest->width = src->width;
-    dest->height = src->height;
-    dest->vmax = src->vmax;
-
-    // Allocation de mémoire pour la copie
-    dest->color = malloc(dest->height * sizeof(unsigned char *));
-    for (int i = 0; i < dest->height; i++) {
-        dest->color[i] = malloc(dest->width * sizeof(unsigned char));
-        for (int j = 0; j < dest->width; j++) {
-            dest->color[i][j] = src->color[i][j];
-        }
-    }
-}
-
-/**
- * Fonction qui ajoute un filtre de sobel à une image
- * @param filtreX
- * @param filtreY
- * @param img
- */
-void sobel(int filtreX[3][3], int filtreY[3][3], struct imageNB *img)
-{
-    int sumX, sumY, SumTotal;
+        margeX = margeX > 0 ? margeX : 0;
+        margeY = margeY > 0 ? margeY : 0;
+        int x0 = x - margeX > 0 ? x - margeX : 0;
+        int y0 = y - margeY > 0 ? y - margeY : 0;
+        int x1 = x + largeur + margeX < width ? x + largeur + margeX : width;
+        int y1 = y + hauteur + margeY < height ? y + hauteur + margeY : height;
 
-    struct imageNB imgSobel;
-    imgSobel.width = img->width;
-    imgSobel.height = img->height;
-    imgSobel.vmax = img->vmax;
-    imgSobel.color = malloc(imgSobel.height * sizeof(unsigned char *));
-
-    for (int ii = 0; ii < imgSobel.height; ii++)
-    {
-        imgSobel.color[ii] = malloc(imgSobel.width * sizeof(unsigned char));
+        resultat = dalle ? lireRegionDallage(&dallage, img, x0, y0, x1, y1) : lireRegionPGM(&flux, img, x0, y0, x1, y1);
+        rectangle->x0 = x - x0;
+        rectangle->y0 = y - y0;
+        rectangle->x1 = x - x0 + largeur;
+        rectangle->y1 = y - y0 + hauteur;
     }
-
-    for (int y = 1; y < img->height - 1; y++)
+    if (dalle)
     {
-        for (int x = 1; x < img->width - 1; x++)
-        {
-            sumX = sumY = SumTotal = 0;
-
-            for (int i = -1; i <= 1; i++)
-            {
-                for (int j = -1; j <= 1; j++)
-                {
-                    int c = img->color[x + i][y + j];
-                    sumX += c * filtreX[i + 1][j + 1];
-                    sumY += c * filtreY[i + 1][j + 1];
-                }
-            }
-
-            SumTotal = abs(sumX) + abs(sumY);
-            imgSobel.color[x][y] = (SumTotal > 255) ? 255 : SumTotal;
-        }
+        fermerDallage(&dallage);
     }
-    savePGM(&imgSobel, "./result/sobel.pgm");
-
-    // Free the allocated memory for imgSobel.color
-    for (int i = 0; i < imgSobel.height; i++)
+    else
     {
-        free(imgSobel.color[i]);
+        fermerFluxPGM(&flux);
     }
-    free(imgSobel.color);
+    return resultat;
 }
 
 /**
- * Fonction qui fait une translation sur une image
- * @param img
- * @param decal
+ * Fonction qui affiche éventuellement les compteurs du cache, puis le vide
+ * @param afficher
  */
-void translation(struct imageNB *img, int decal)
+void terminerCache(int afficher)
 {
-    struct imageNB tr;
-    tr.width = img->width;
-    tr.height = img->height;
-    tr.vmax = img->vmax;
-    tr.color = malloc(tr.height * sizeof(unsigned char *));
-
-    for (int ii = 0; ii < tr.height; ii++)
-    {
-        tr.color[ii] = malloc(tr.width * sizeof(unsigned char));
-    }
-
-    for (int i = 0; i < img->width; i++)
-    {
-        for (int j = 0; j < img->height; j++)
-        {
-            int newColumn = (i + decal) % img->width;
-            tr.color[j][newColumn] = img->color[j][i];
-        }
-    }
-    savePGM(&tr, "./result/translation.pgm");
-
-    // Free the allocated memory for tr.color
-    for (int i = 0; i < tr.height; i++)
+    if (afficher)
     {
-        free(tr.color[i]);
+        cacheAfficherStats(stdout);
     }
-    free(tr.color);
+    cacheDesactiver();
 }
 
 /**
- * Fonction qui ajoute du seuillage à une image
- * @param img
- * @param seuil
+ * Fonction qui active le cache quand un dossier est donné (-C ou IMAGE_CACHE_DIR) ; "-" le
+ * garde en mémoire seulement
+ * @param dossierCache NULL ou vide pour laisser le cache inactif
+ * @return 0 si le cache est prêt (ou reste inactif), -1 sinon
  */
-void seuillage(struct imageNB *img, int seuil)
+int activerCache(const char *dossierCache)
 {
-    struct imageNB tr;
-    tr.width = img->width;
-    tr.height = img->height;
-    tr.vmax = img->vmax;
-    tr.color = malloc(tr.height * sizeof(unsigned char *));
-
-    for (int ii = 0; ii < tr.height; ii++)
-    {
-        tr.color[ii] = malloc(tr.width * sizeof(unsigned char));
-    }
-
-    for (int i = 0; i < img->width; i++)
+    if (dossierCache == NULL || dossierCache[0] == '\0')
     {
-        for (int j = 0; j < img->height; j++)
-        {
-            tr.color[j][i] = (img->color[j][i] > seuil) ? 255 : 0;
-        }
+        return 0;
     }
-    savePGM(&tr, "./result/seuillage.pgm");
-
-    // Free the allocated memory for tr.color
-    for (int i = 0; i < tr.height; i++)
-    {
-        free(tr.color[i]);
-    }
-    free(tr.color);
+    return cacheActiver(cacheMemoireDefaut(), strcmp(dossierCache, "-") == 0 ? NULL : dossierCache);
 }
 
 /**
- * Fonction qui redimensionne une image
+ * Fonction qui cherche dans le cache le résultat d'une opération du menu
+ * La clé est calculée d'après les pixels de img et la recette, mise en forme comme printf ;
+ * sans cache actif, rien n'est calculé et la clé reste vide.
  * @param img
+ * @param resultat reçoit le résultat s'il est trouvé
+ * @param cle clé du résultat, pour le ranger avec cacheAjouter après l'avoir calculé
+ * @param format
+ * @return 1 si le résultat a été trouvé, 0 sinon
  */
-void redimensionner(struct imageNB *img)
+int resultatEnCache(struct imageNB *img, struct imageNB *resultat, struct cleCache *cle, const char *format, ...)
 {
-    int amoutScale = 3;
-    struct imageNB tr;
-    tr.width = img->width * amoutScale;
-    tr.height = img->height * amoutScale;
-    tr.vmax = img->vmax;
-    tr.color = malloc(tr.height * sizeof(unsigned char *));
-
-    for (int ii = 0; ii < tr.height; ii++)
+    if (!cacheActif())
     {
-        tr.color[ii] = malloc(tr.width * sizeof(unsigned char));
+        memset(cle, 0, sizeof(*cle));
+        return 0;
     }
 
-    for (int i = 0; i < img->width; i++)
+    char recette[128];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(recette, sizeof(recette), format, args);
+    va_end(args);
+
+    cacheCle(img, recette, cle);
+    if (cacheChercher(cle, resultat))
     {
-        for (int j = 0; j < img->height; j++)
-        {
-            tr.color[j * 2][i * 2] = img->color[j][i];
-            tr.color[j * 2 + 1][i * 2] = tr.color[j * 2][i * 2];
-            tr.color[j * 2][i * 2 + 1] = tr.color[j * 2][i * 2];
-            tr.color[j * 2 + 1][i * 2 + 1] = tr.color[j * 2][i * 2];
-        }
+        return 1;
     }
-
-    savePGM(&tr, "./result/redimensionner.pgm");
-
-    // Free the allocated memory for tr.color
-    for (int i = 0; i < tr.height; i++)
+    // Des pixels partagés avec le cache seraient recopiés avant d'être écrasés
+    if (resultat->data != NULL && reservePartage(resultat->data))
     {
-        free(tr.color[i]);
+        freeImageMemory(resultat);
     }
-    free(tr.color);
+    return 0;
 }
 
 /**
- * Fonction qui réalise un histogramme d'une image
- * @param img
+ * Fonction qui lit les options et les étapes dans p, puis exécute le pipeline
+ * @param argc
+ * @param argv
+ * @param p pipeline vide, rempli par les options -p et les étapes
+ * @return code de sortie du programme
  */
-void histogramme(struct imageNB *img)
+int executerModePipeline(int argc, char **argv, struct pipeline *p)
 {
-    // Calculer l'histogramme
-    int histogram[256] = {0};
-    int maxCount = 0;
-
-    for (int i = 0; i < img->height; i++)
-    {
-        for (int j = 0; j < img->width; j++)
+    char *entree = NULL;
+    char *sortie = NULL;
+    int lignesParBande = -1;
+    const char *region = NULL;
+    const char *dossierCache = getenv("IMAGE_CACHE_DIR");
+    int enCours = 0;
+    int silencieux = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:p:t:s:T:r:j:C:qh")) != -1)
+    {
+        switch (opt)
         {
-            int intensite = img->color[i][j];
-            histogram[intensite]++;
-            if (histogram[intensite] > maxCount)
-            {
-                maxCount = histogram[intensite];
-            }
+            case 'i':
+                entree = optarg;
+                break;
+            case 'o':
+                sortie = optarg;
+                break;
+            case 'p':
+                if (pipelineCharger(p, optarg) != 0)
+                {
+                    return 1;
+                }
+                break;
+            case 't':
+                if (parallelInit(atoi(optarg)) != 0)
+                {
+                    return 1;
+                }
+                break;
+            case 's':
+                lignesParBande = atoi(optarg);
+                break;
+            case 'T':
+                if (traceInit(optarg) != 0)
+                {
+                    return 1;
+                }
+                break;
+            case 'r':
+                region = optarg;
+                break;
+            case 'j':
+                enCours = atoi(optarg);
+                break;
+            case 'C':
+                dossierCache = optarg;
+                break;
+            case 'q':
+                pgmSetVerbose(0);
+                silencieux = 1;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
         }
     }
 
-    // Définir la largeur de chaque barre
-    int barWidth = 20;
-    int histoWidth = 256 * barWidth;
-
-    // Créer une image pour représenter l'histogramme
-    struct imageNB histo;
-    histo.width = histoWidth;
-    histo.height = maxCount;
-    histo.vmax = 255;
-
-    // Allouer de la mémoire pour le tableau des couleurs
-    histo.color = malloc(histo.height * sizeof(unsigned char *));
-    for (int i = 0; i < histo.height; i++)
+    // Les étapes de la ligne de commande s'ajoutent après celles du fichier
+    for (int i = optind; i < argc; i++)
     {
-        histo.color[i] = malloc(histo.width * sizeof(unsigned char));
-        // Initialiser à zéro
-        for (int j = 0; j < histo.width; j++)
+        if (pipelineAjouter(p, argv[i]) != 0)
         {
-            histo.color[i][j] = 0;
+            return 1;
         }
     }
 
-    // Remplir l'image de l'histogramme
-    for (int i = 0; i < 256; i++)
+    if (entree == NULL || sortie == NULL)
     {
-        int count = histogram[i];
-        for (int j = 0; j < count; j++)
-        {
-            for (int k = 0; k < barWidth; k++)
-            {
-                int index = i * barWidth + k;
-                histo.color[maxCount - 1 - j][index] = 255; // Barres verticales blanches
-            }
-        }
+        usage(argv[0]);
+        return 1;
     }
 
-    // Sauvegarder l'image représentant l'histogramme
-    savePGM(&histo, "./result/histogramme.pgm");
-
-    // Libérer la mémoire allouée pour histo.color
-    for (int i = 0; i < histo.height; i++)
+    if (lignesParBande >= 0 && region != NULL)
     {
-        free(histo.color[i]);
-    }
-    free(histo.color);
-}
-
-/**
- * Fonction qui ajoute du contraste à une image
- * @param img
- * @param valeurContraste
- */
-void contraste(struct imageNB *img, int valeurContraste) {
-    // Appliquer le contraste
-    for (int y = 0; y < img->height; y++) {
-        for (int x = 0; x < img->width; x++) {
-            int newValue = img->color[y][x] + valeurContraste;
-            img->color[y][x] = (newValue > 255) ? 255 : (newValue < 0) ? 0 : newValue;
-        }
+        printf("Options -r and -s cannot be combined\n");
+        return 1;
     }
-
-    // Sauvegarder l'image
-    savePGM(img, "./result/contraste.pgm");
-}
-
-/**
- * Fonction qui ajoute de la luminosité à une image
- * @param img
- * @param valeurLuminosite
- */
-void luminosite(struct imageNB *img, int valeurLuminosite) {
-    // Appliquer la luminosité
-    for (int y = 0; y < img->height; y++) {
-        for (int x = 0; x < img->width; x++) {
-            int newValue = img->color[y][x] + valeurLuminosite;
-            img->color[y][x] = (newValue > 255) ? 255 : (newValue < 0) ? 0 : newValue;
-        }
-    }
-
-    // Sauvegarder l'image
-    savePGM(img, "./result/luminosite.pgm");
-}
-
-/**
- * Fonction qui floute une image
- * @param img
- */
-void flouter(struct imageNB *img)
-{
-    struct imageNB imgBlurred;
-    imgBlurred.width = img->width;
-    imgBlurred.height = img->height;
-    imgBlurred.vmax = img->vmax;
-    imgBlurred.color = malloc(imgBlurred.height * sizeof(unsigned char *));
-
-    for (int ii = 0; ii < imgBlurred.height; ii++)
+    if (activerCache(dossierCache) != 0)
     {
-        imgBlurred.color[ii] = malloc(imgBlurred.width * sizeof(unsigned char));
+        return 1;
     }
-
-    int kernel[3][3] = {{1, 1, 1}, {1, 1, 1}, {1, 1, 1}};
-
-    for (int y = 1; y < img->height - 1; y++)
+    if (estLot(entree))
     {
-        for (int x = 1; x < img->width - 1; x++)
+        if (region != NULL)
         {
-            int sum = 0;
-            for (int i = -1; i <= 1; i++)
-            {
-                for (int j = -1; j <= 1; j++)
-                {
-                    sum += img->color[x + i][y + j] * kernel[i + 1][j + 1];
-                }
-            }
-            imgBlurred.color[x][y] = sum / 9;
+            printf("Option -r cannot be used in batch mode\n");
+            return 1;
+        }
+        char **fichiers;
+        int nb;
+        if (listerLot(entree, &fichiers, &nb) != 0)
+        {
+            return 1;
+        }
+        struct bilanLot bilan;
+        int resultat = executerLot(p, fichiers, nb, sortie, enCours, lignesParBande, &bilan);
+        libererLot(fichiers, nb);
+        terminerCache(cacheActif() && !silencieux);
+        parallelFin();
+        return resultat == 0 ? 0 : 1;
+    }
+    if (lignesParBande >= 0)
+    {
+        int resultat = pipelineExecuterBandes(p, entree, sortie, lignesParBande);
+        parallelFin();
+        return resultat == 0 ? 0 : 1;
+    }
+
+    struct imageNB img = {0};
+    struct imageNB tampon = {0};
+    // Avec -r, le voisinage du pipeline est lu autour du rectangle, puis le résultat est
+    // recadré : il est le même que sur l'image entière. Un pipeline qui a besoin de toute
+    // l'image traite le rectangle seul, comme une image à part entière.
+    struct tuile rectangle;
+    int margeX = -1, margeY = -1;
+    int recadrer = region != NULL && pipelineVoisinage(p, &margeX, &margeY) == 0;
+    int charge = region != NULL ? chargerRegion(&img, entree, region, margeX, margeY, &rectangle)
+                                : loadImage(&img, entree);
+    if (charge != 0)
+    {
+        return 1;
+    }
+
+    // Un masque .pbm de l'image entière est écrit sans l'image 8 bits du dernier seuil
+    int resultat;
+    if (region == NULL && estNomPBM(sortie))
+    {
+        struct masque m;
+        resultat = pipelineExecuterMasque(p, &img, &tampon, &m);
+        if (resultat == 0)
+        {
+            resultat = saveMasquePBM(&m, sortie);
+            masqueLiberer(&m);
         }
-    }
-    savePGM(&imgBlurred, "./result/flooter.pgm");
-
-    for (int i = 0; i < imgBlurred.height; i++)
-    {
-        free(imgBlurred.color[i]);
-    }
-    free(imgBlurred.color);
-}
-
-/**
- * Fonction qui fait faire une rotation à une image
- * @param img
- * @param angle
- * @param clockwise
- */
-void pivoter(struct imageNB *img, float angle, bool clockwise)
-{
-    double radians = angle * M_PI / 180.0;
-
-    int newWidth, newHeight;
-    if (clockwise)
-    {
-        newWidth = img->height;
-        newHeight = img->width;
     }
     else
     {
-        newWidth = img->width;
-        newHeight = img->height;
-    }
-
-    struct imageNB rotatedImg;
-    rotatedImg.width = newWidth;
-    rotatedImg.height = newHeight;
-    rotatedImg.vmax = img->vmax;
-    rotatedImg.color = malloc(rotatedImg.height * sizeof(unsigned char *));
-
-    for (int i = 0; i < rotatedImg.height; i++)
-    {
-        rotatedImg.color[i] = malloc(rotatedImg.width * sizeof(unsigned char));
-    }
-
-    double centerX = img->width / 2.0;
-    double centerY = img->height / 2.0;
-
-    for (int i = 0; i < rotatedImg.width; i++)
-    {
-        for (int j = 0; j < rotatedImg.height; j++)
+        resultat = pipelineExecuter(p, &img, &tampon);
+        if (resultat == 0 && recadrer)
         {
-            double x = i - centerX;
-            double y = j - centerY;
-
-            double newX = x * cos(radians) - y * sin(radians);
-            double newY = x * sin(radians) + y * cos(radians);
-
-            int originalX, originalY;
-
-            if (clockwise)
-            {
-                originalX = (int)(newX + centerY);
-                originalY = (int)(centerX - newY);
-            }
-            else
-            {
-                originalX = (int)(centerX + newX);
-                originalY = (int)(newY + centerY);
-            }
-
-            if (originalX >= 0 && originalX < img->width && originalY >= 0 && originalY < img->height)
-            {
-                rotatedImg.color[j][i] = img->color[originalY][originalX];
-            }
-            else
-            {
-                rotatedImg.color[j][i] = 0; // Set to black for pixels outside the original image
-            }
+            resultat = vueImage(&img, &img, rectangle.x0, rectangle.y0, rectangle.x1 - rectangle.x0,
+                                rectangle.y1 - rectangle.y0);
+        }
+        if (resultat == 0)
+        {
+            resultat = saveImage(&img, sortie);
         }
     }
 
-    char filename[100];
-    snprintf(filename, sizeof(filename), "./result/rotation_%d_degrees_%s.pgm", (int)angle,clockwise == 1 ? "in_clockwise" : "not_in_clockwise");
-    printf("%s", filename);
-    savePGM(&rotatedImg, filename);
-
-    for (int i = 0; i < rotatedImg.height; i++)
-    {
-        free(rotatedImg.color[i]);
-    }
-    free(rotatedImg.color);
+    freeImageMemory(&img);
+    freeImageMemory(&tampon);
+    terminerCache(cacheActif() && !silencieux);
+    parallelFin();
+    return resultat == 0 ? 0 : 1;
 }
-
 /**
- * Fonction qui ajoute un effet negatif à une image
- * @param img
+ * Fonction qui exécute un pipeline sans interaction : chargement, toutes les étapes en
+ * mémoire, puis enregistrement du résultat final uniquement
+ * @param argc
+ * @param argv
+ * @return code de sortie du programme
  */
-void negatif(struct imageNB *img)
+int modePipeline(int argc, char **argv)
 {
-    if (img == NULL || img->color == NULL)
-    {
-        printf("Invalid image structure\n");
-        return;
-    }
-
-    for (int i = 0; i < img->height; i++)
-    {
-        for (int j = 0; j < img->width; j++)
-        {
-            img->color[i][j] = img->vmax - img->color[i][j];
-        }
-    }
-
-    savePGM(img, "./result/negatif.pgm");
+    struct pipeline p = {0};
+    int code = executerModePipeline(argc, argv, &p);
+    pipelineLiberer(&p);
+    return code;
 }
 
-/**
- * Fonction qui pixélise une image
- * @param img
- * @param taillePixel
- */
-void pixeliser(struct imageNB *img, int taillePixel)
+int main(int argc, char **argv)
 {
-    if (img == NULL || img->color == NULL || taillePixel < 1)
+    if (traceInit(NULL) != 0)
     {
-        printf("Invalid parameters for pixeliser function\n");
-        return;
+        return 1;
     }
 
-    for (int y = 0; y < img->height; y += taillePixel)
+    // Avec des arguments, le programme fonctionne sans menu
+    if (argc > 1)
     {
-        for (int x = 0; x < img->width; x += taillePixel)
-        {
-            int somme = 0;
-            int count = 0;
-
-            // Calculer la somme des valeurs des pixels dans le bloc
-            for (int i = 0; i < taillePixel && y + i < img->height; i++)
-            {
-                for (int j = 0; j < taillePixel && x + j < img->width; j++)
-                {
-                    somme += img->color[y + i][x + j];
-                    count++;
-                }
-            }
-
-            // Calculer la valeur moyenne
-            unsigned char moyenne = somme / count;
-
-            // Appliquer la valeur moyenne à tous les pixels du bloc
-            for (int i = 0; i < taillePixel && y + i < img->height; i++)
-            {
-                for (int j = 0; j < taillePixel && x + j < img->width; j++)
-                {
-                    img->color[y + i][x + j] = moyenne;
-                }
-            }
-        }
+        return modePipeline(argc, argv);
     }
 
-    savePGM(img, "./result/pixeliser.pgm");
-}
+    // Create an image structure
+    struct imageNB myImage = {0};
 
-/**
- * Fonction qui libère la mémoire
- * @param img
- */
-void freeImageMemory(struct imageNB *img)
-{
-    if (img->color != NULL)
+    // Load the PGM image
+    if (loadPGM(&myImage, "./input.pgm") != 0)
     {
-        for (int i = 0; i < img->height; i++)
-        {
-            free(img->color[i]);
-        }
-        free(img->color);
-        img->color = NULL;
+        return 1;
     }
-}
 
-int main()
-{
-    // Create an image structure
-    struct imageNB myImage;
+    // Image résultat, réutilisée d'une opération à l'autre
+    struct imageNB resultat = {0};
 
-    // Load the PGM image
-    loadPGM(&myImage, "./input.pgm");
+    // Comme en ligne de commande, le cache n'est actif qu'avec IMAGE_CACHE_DIR (- : en mémoire)
+    if (activerCache(getenv("IMAGE_CACHE_DIR")) != 0)
+    {
+        freeImageMemory(&myImage);
+        return 1;
+    }
+    struct cleCache cle;
 
     int choix;
     do
@@ -640,10 +438,6 @@ int main()
         printf("Choose an option: ");
         scanf("%d", &choix);
 
-        // Créer une copie de l'image originale
-        struct imageNB myImageCopy;
-        copyImage(&myImage, &myImageCopy);
-
         float angleRotation = 0.0;
         int clockwise = 0;
 
@@ -654,12 +448,18 @@ int main()
 
         int thresholdValue = 0;
 
+        int nouvelleLargeur = 0;
+        int nouvelleHauteur = 0;
+
         float ajustContrastLevel = 0;
 
         float ajustLuminosityLevel = 0;
 
         int taillePixel = 0;
 
+        struct traceZone zone;
+        int resultatOperation;
+
         // Appliquer la transformation correspondante en fonction du choix
         switch (choix)
         {
@@ -673,11 +473,28 @@ int main()
                 scanf("%d", &clockwise);
 
                 // Applique la rotation à l'image
-                pivoter(&myImageCopy, angleRotation, clockwise == 1 ? true : false);
+                traceOuvrir(&zone, "pivoter");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu pivoter:%.9g,%d", angleRotation, clockwise == 1) ? 0 : pivoter(&myImage, &resultat, angleRotation, clockwise == 1 ? true : false);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    char filename[100];
+                    snprintf(filename, sizeof(filename), "./result/rotation_%d_degrees_%s.pgm", (int)angleRotation, clockwise == 1 ? "in_clockwise" : "not_in_clockwise");
+                    printf("%s", filename);
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, filename);
+                }
                 break;
             case 2:
                 // Applique un filtre Sobel à l'image
-                sobel(sobelX, sobelY, &myImageCopy);
+                traceOuvrir(&zone, "sobel");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu sobel") ? 0 : sobel(&myImage, &resultat, sobelX, sobelY);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/sobel.pgm");
+                }
                 break;
             case 3:
                 // Demande du niveau de translation
@@ -685,23 +502,66 @@ int main()
                 scanf("%d", &translationAmount);
 
                 // Translate l'image
-                translation(&myImageCopy, translationAmount);
+                traceOuvrir(&zone, "translation");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu translation:%d", translationAmount) ? 0 : translation(&myImage, &resultat, translationAmount);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/translation.pgm");
+                }
                 break;
             case 4:
                 // Demande du niveau de seuillage
-                printf("Quel est le niveau de seuillage que vous souhaitez appliquer à l'image ? \n> ");
+                printf("Quel est le niveau de seuillage que vous souhaitez appliquer à l'image "
+                       "(-1 pour le seuil automatique d'Otsu) ? \n> ");
                 scanf("%d", &thresholdValue);
 
                 // Applique un seuil à l'image
-                seuillage(&myImageCopy, thresholdValue);
+                traceOuvrir(&zone, "seuillage");
+                if (resultatEnCache(&myImage, &resultat, &cle, "menu seuillage:%d", thresholdValue < 0 ? -1 : thresholdValue))
+                {
+                    resultatOperation = 0;
+                }
+                else
+                {
+                    resultatOperation = thresholdValue < 0 ? seuillageOtsu(&myImage, &resultat)
+                                                           : seuillage(&myImage, &resultat, thresholdValue);
+                }
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/seuillage.pgm");
+                }
                 break;
             case 5:
+                // Demande de la nouvelle taille
+                printf("Quelle largeur souhaitez-vous pour l'image ? \n> ");
+                scanf("%d", &nouvelleLargeur);
+                printf("Quelle hauteur souhaitez-vous pour l'image ? \n> ");
+                scanf("%d", &nouvelleHauteur);
+
                 // Redimensionne l'image
-                redimensionner(&myImageCopy);
+                traceOuvrir(&zone, "redimensionner");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu redimensionner:%d,%d", nouvelleLargeur, nouvelleHauteur) ? 0 : redimensionner(&myImage, &resultat, nouvelleLargeur, nouvelleHauteur);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/redimensionner.pgm");
+                }
                 break;
             case 6:
                 // Génère un histogramme de l'image
-                histogramme(&myImageCopy);
+                traceOuvrir(&zone, "histogramme");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu histogramme") ? 0 : histogramme(&myImage, &resultat);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/histogramme.pgm");
+                }
                 break;
             case 7:
                 // Demande du niveau de contraste
@@ -709,7 +569,14 @@ int main()
                 scanf("%f", &ajustContrastLevel);
 
                 // Ajoute du contraste à l'image
-                contraste(&myImageCopy, ajustContrastLevel);
+                traceOuvrir(&zone, "contraste");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu contraste:%d", (int)ajustContrastLevel) ? 0 : contraste(&myImage, &resultat, ajustContrastLevel);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/contraste.pgm");
+                }
                 break;
             case 8:
                 // Demande du niveau de luminosité
@@ -717,23 +584,51 @@ int main()
                 scanf("%f", &ajustLuminosityLevel);
 
                 // Ajoute de la luminosité à l'image
-                luminosite(&myImageCopy, ajustLuminosityLevel);
+                traceOuvrir(&zone, "luminosite");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu luminosite:%d", (int)ajustLuminosityLevel) ? 0 : luminosite(&myImage, &resultat, ajustLuminosityLevel);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/luminosite.pgm");
+                }
                 break;
             case 9:
                 // Applique un effet flou à l'image
-                flouter(&myImageCopy);
+                traceOuvrir(&zone, "flouter");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu flouter") ? 0 : flouter(&myImage, &resultat);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/flooter.pgm");
+                }
                 break;
             case 10:
                 // Applique un effet négatif à l'image
-                negatif(&myImageCopy);
+                traceOuvrir(&zone, "negatif");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu negatif") ? 0 : negatif(&myImage, &resultat);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/negatif.pgm");
+                }
                 break;
             case 11:
                 // Demande du niveau de contraste
                 printf("Quelle est la taille de pixel que vous souhaitez appliquer à l'image ? \n> ");
                 scanf("%d", &taillePixel);
 
-                // Pixelise l'image copiée avec une taille de pixel de 10
-                pixeliser(&myImageCopy, taillePixel);
+                // Pixelise l'image avec la taille de pixel demandée
+                traceOuvrir(&zone, "pixeliser");
+                resultatOperation = resultatEnCache(&myImage, &resultat, &cle, "menu pixeliser:%d", taillePixel) ? 0 : pixeliser(&myImage, &resultat, taillePixel);
+                traceFermer(&zone);
+                if (resultatOperation == 0)
+                {
+                    cacheAjouter(&cle, &resultat);
+                    savePGM(&resultat, "./result/pixeliser.pgm");
+                }
                 break;
             case 0:
                 // Quitte le menu
@@ -742,12 +637,11 @@ int main()
                 printf("Invalid option. Please choose a valid option.\n");
                 break;
         }
-
-        // Libére la mémoire allouée pour l'image copiée
-        freeImageMemory(&myImageCopy);
     } while (choix != 0);
 
-    // Libére la mémoire allouée pour l'image originale
+    // Libére la mémoire allouée pour les images
+    terminerCache(cacheActif());
+    freeImageMemory(&resultat);
     freeImageMemory(&myImage);
 
     return 0;
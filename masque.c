@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "masque.h"
+#include "simd.h"
+#include "parallele.h"
+#include "reserve.h"
+
+// Les tuiles commencent à un multiple de TUILE_LARGEUR_MAX : chacune écrit des octets entiers
+_Static_assert(TUILE_LARGEUR_MAX % 8 == 0, "tuile hors d'un octet du masque");
+
+struct contexteMasque
+{
+    const struct imageNB *img;
+    const struct masque *m;
+    int seuil;
+};
+
+int masqueAllouer(struct masque *m, int largeur, int hauteur)
+{
+    m->bits = NULL;
+    if (largeur <= 0 || hauteur <= 0)
+    {
+        printf("Invalid parameters for masqueAllouer\n");
+        return -1;
+    }
+    m->largeur = largeur;
+    m->hauteur = hauteur;
+    m->pas = ((size_t)largeur + 7) / 8;
+    m->bits = reservePrendre(m->pas * hauteur);
+    if (m->bits == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    return 0;
+}
+
+void masqueLiberer(struct masque *m)
+{
+    reserveRendre(m->bits);
+    m->bits = NULL;
+}
+
+void masqueEmpaqueter(const unsigned char *ligne, uint8_t *bits, int n, int seuil)
+{
+    if (seuil < 0 || seuil >= 255)
+    {
+        memset(bits, seuil < 0 ? 0xFF : 0, (size_t)n / 8);
+        if (n % 8 != 0)
+        {
+            bits[n / 8] = seuil < 0 ? (uint8_t)((1 << (n % 8)) - 1) : 0;
+        }
+        return;
+    }
+
+    int x = 0;
+#ifdef SIMD_X86
+    // v > seuil <=> max(v, seuil + 1) == v, en octets non signés
+    __m128i s = _mm_set1_epi8((char)(seuil + 1));
+    for (; x + 16 <= n; x += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(ligne + x));
+        int haut = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, s), v));
+        bits[x / 8] = (uint8_t)haut;
+        bits[x / 8 + 1] = (uint8_t)(haut >> 8);
+    }
+#endif
+    for (; x < n; x += 8)
+    {
+        int fin = n - x < 8 ? n - x : 8;
+        uint8_t octet = 0;
+        for (int i = 0; i < fin; i++)
+        {
+            octet |= (uint8_t)((ligne[x + i] > seuil) << i);
+        }
+        bits[x / 8] = octet;
+    }
+}
+
+static int tuileSeuil(const struct tuile *t, void *arg)
+{
+    const struct contexteMasque *ctx = arg;
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        masqueEmpaqueter(imageRow(ctx->img, y) + t->x0, ctx->m->bits + (size_t)y * ctx->m->pas + t->x0 / 8,
+                         t->x1 - t->x0, ctx->seuil);
+    }
+    return 0;
+}
+
+int masqueSeuil(const struct imageNB *img, struct masque *m, int seuil)
+{
+    if (img == NULL || img->color == NULL)
+    {
+        m->bits = NULL;
+        printf("Invalid parameters for masqueSeuil\n");
+        return -1;
+    }
+    if (masqueAllouer(m, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    struct contexteMasque ctx = {img, m, seuil};
+    if (executerTuiles(img->width, img->height, 0, tuileSeuil, &ctx) != 0)
+    {
+        masqueLiberer(m);
+        return -1;
+    }
+    return 0;
+}
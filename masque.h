@@ -0,0 +1,71 @@
+#ifndef _MASQUE_H_
+#define _MASQUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "image.h"
+
+/**
+ * Masque binaire d'une image, un bit par pixel (huit fois moins de mémoire qu'une image)
+ *
+ * Le pixel (x, y) est le bit x % 8 (bit de poids faible en premier) de l'octet
+ * bits[y * pas + x / 8] ; 1 marque un pixel au-dessus du seuil (blanc). Les bits qui
+ * dépassent la largeur à la fin de chaque ligne valent 0.
+ */
+struct masque
+{
+    int largeur;
+    int hauteur;
+    size_t pas;
+    uint8_t *bits;
+};
+
+/**
+ * Fonction qui alloue un masque de largeur x hauteur pixels, non initialisé
+ * @param m
+ * @param largeur
+ * @param hauteur
+ * @return 0 si le masque est prêt, -1 sinon
+ */
+int masqueAllouer(struct masque *m, int largeur, int hauteur);
+
+/**
+ * Fonction qui libère un masque
+ * @param m
+ */
+void masqueLiberer(struct masque *m);
+
+/**
+ * Fonction qui renvoie le bit du pixel (x, y)
+ * @param m
+ * @param x
+ * @param y
+ * @return 1 si le pixel est blanc, 0 sinon
+ */
+static inline int masqueBit(const struct masque *m, int x, int y)
+{
+    return (m->bits[(size_t)y * m->pas + (size_t)(x >> 3)] >> (x & 7)) & 1;
+}
+
+/**
+ * Fonction qui range dans bits les pixels de ligne supérieurs à seuil, n pixels à partir
+ * d'un octet entier de bits ; 16 pixels sont comparés à la fois en SSE2
+ * @param ligne
+ * @param bits (n + 7) / 8 octets
+ * @param n
+ * @param seuil
+ */
+void masqueEmpaqueter(const unsigned char *ligne, uint8_t *bits, int n, int seuil);
+
+/**
+ * Fonction qui calcule le masque des pixels d'une image supérieurs à seuil (le même partage
+ * que seuillage, sans image de sortie)
+ * @param img
+ * @param m masque à libérer avec masqueLiberer
+ * @param seuil
+ * @return 0 si le calcul a réussi, -1 sinon
+ */
+int masqueSeuil(const struct imageNB *img, struct masque *m, int seuil);
+
+#endif
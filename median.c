@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "median.h"
+#include "simd.h"
+#include "parallele.h"
+#include "reserve.h"
+
+/**
+ * Classes grossières de l'histogramme : 16 valeurs chacune
+ */
+#define CLASSES 16
+
+/**
+ * Largeur des bandes de colonnes traitées d'un seul tenant
+ */
+#define MEDIAN_BANDE 128
+
+struct contexteMedian
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    int rayon;
+};
+
+static inline int borner(int v, int n)
+{
+    return v < 0 ? 0 : v >= n ? n - 1 : v;
+}
+
+/**
+ * Réseau de tri de 9 valeurs réduit à la médiane : v[4] à la fin
+ */
+#define TRIER(a, b, min, max)                                                                                          \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        t = min(v[a], v[b]);                                                                                           \
+        v[b] = max(v[a], v[b]);                                                                                        \
+        v[a] = t;                                                                                                      \
+    } while (0)
+
+#define RESEAU_9(min, max)                                                                                             \
+    TRIER(1, 2, min, max);                                                                                             \
+    TRIER(4, 5, min, max);                                                                                             \
+    TRIER(7, 8, min, max);                                                                                             \
+    TRIER(0, 1, min, max);                                                                                             \
+    TRIER(3, 4, min, max);                                                                                             \
+    TRIER(6, 7, min, max);                                                                                             \
+    TRIER(1, 2, min, max);                                                                                             \
+    TRIER(4, 5, min, max);                                                                                             \
+    TRIER(7, 8, min, max);                                                                                             \
+    TRIER(0, 3, min, max);                                                                                             \
+    TRIER(5, 8, min, max);                                                                                             \
+    TRIER(4, 7, min, max);                                                                                             \
+    TRIER(3, 6, min, max);                                                                                             \
+    TRIER(1, 4, min, max);                                                                                             \
+    TRIER(2, 5, min, max);                                                                                             \
+    TRIER(4, 7, min, max);                                                                                             \
+    TRIER(4, 2, min, max);                                                                                             \
+    TRIER(6, 4, min, max);                                                                                             \
+    TRIER(4, 2, min, max)
+
+#define MIN_OCTET(a, b) ((a) < (b) ? (a) : (b))
+#define MAX_OCTET(a, b) ((a) > (b) ? (a) : (b))
+
+/**
+ * Médiane 3 x 3 : la bordure de img (au moins un pixel) est lue directement
+ */
+static int tuileMedian3(const struct tuile *tu, void *arg)
+{
+    const struct contexteMedian *ctx = arg;
+    for (int y = tu->y0; y < tu->y1; y++)
+    {
+        const unsigned char *lignes[3] = {imageRow(ctx->img, y - 1), imageRow(ctx->img, y),
+                                          imageRow(ctx->img, y + 1)};
+        unsigned char *dst = imageRow(ctx->dest, y);
+        int x = tu->x0;
+#ifdef SIMD_X86
+        for (; x + 16 <= tu->x1; x += 16)
+        {
+            __m128i v[9], t;
+            for (int j = 0; j < 3; j++)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    v[3 * j + i] = _mm_loadu_si128((const __m128i *)(lignes[j] + x + i - 1));
+                }
+            }
+            RESEAU_9(_mm_min_epu8, _mm_max_epu8);
+            _mm_storeu_si128((__m128i *)(dst + x), v[4]);
+        }
+#endif
+        for (; x < tu->x1; x++)
+        {
+            unsigned char v[9], t;
+            for (int j = 0; j < 3; j++)
+            {
+                for (int i = 0; i < 3; i++)
+                {
+                    v[3 * j + i] = lignes[j][x + i - 1];
+                }
+            }
+            RESEAU_9(MIN_OCTET, MAX_OCTET);
+            dst[x] = v[4];
+        }
+    }
+    return 0;
+}
+
+/**
+ * Ajoute (signe 1) ou retire (signe -1) 16 compteurs de src à dst
+ */
+static inline void cumuler(uint16_t *dst, const uint16_t *src, int signe)
+{
+#ifdef SIMD_X86
+    for (int i = 0; i < 16; i += 8)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), signe > 0 ? _mm_add_epi16(d, v) : _mm_sub_epi16(d, v));
+    }
+#else
+    for (int i = 0; i < 16; i++)
+    {
+        dst[i] = (uint16_t)(signe > 0 ? dst[i] + src[i] : dst[i] - src[i]);
+    }
+#endif
+}
+
+/**
+ * Médiane à temps constant (Perreault et Hébert) : histogrammes fins (256 valeurs) et
+ * grossiers (CLASSES) de chaque colonne réelle [c0, c1[ couverte par la tuile, pour la
+ * fenêtre verticale de la ligne courante ; les colonnes hors de l'image sont celles du bord
+ */
+static int bandeMedian(const struct contexteMedian *ctx, const struct tuile *tu)
+{
+    const struct imageNB *img = ctx->img;
+    int r = ctx->rayon, w = img->width, h = img->height;
+    int c0 = tu->x0 - r > 0 ? tu->x0 - r : 0;
+    int c1 = tu->x1 + r < w ? tu->x1 + r : w;
+    int nc = c1 - c0;
+    size_t compteurs = (size_t)nc * (256 + CLASSES);
+    uint16_t *fins = reservePrendre(compteurs * sizeof(uint16_t));
+    if (fins == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    uint16_t *grossiers = fins + (size_t)nc * 256;
+    memset(fins, 0, compteurs * sizeof(uint16_t));
+
+    for (int k = -r; k <= r; k++)
+    {
+        const unsigned char *src = imageRow(img, borner(tu->y0 + k, h));
+        for (int c = c0; c < c1; c++)
+        {
+            fins[(size_t)(c - c0) * 256 + src[c]]++;
+            grossiers[(c - c0) * CLASSES + src[c] / 16]++;
+        }
+    }
+
+    int cible = ((2 * r + 1) * (2 * r + 1) + 1) / 2;
+    for (int y = tu->y0; y < tu->y1; y++)
+    {
+        if (y > tu->y0)
+        {
+            const unsigned char *sortant = imageRow(img, borner(y - r - 1, h));
+            const unsigned char *entrant = imageRow(img, borner(y + r, h));
+            for (int c = c0; c < c1; c++)
+            {
+                uint16_t *fin = fins + (size_t)(c - c0) * 256;
+                uint16_t *gros = grossiers + (c - c0) * CLASSES;
+                fin[sortant[c]]--;
+                gros[sortant[c] / 16]--;
+                fin[entrant[c]]++;
+                gros[entrant[c] / 16]++;
+            }
+        }
+
+        // Fenêtre du premier pixel ; les classes fines sont mises à jour quand on y cherche
+        uint16_t noyauGros[CLASSES] = {0};
+        uint16_t noyauFin[256];
+        int aJour[CLASSES];
+        for (int s = 0; s < CLASSES; s++)
+        {
+            aJour[s] = tu->x0 - 2 * r - 2;
+        }
+        for (int i = -r; i <= r; i++)
+        {
+            cumuler(noyauGros, grossiers + (borner(tu->x0 + i, w) - c0) * CLASSES, 1);
+        }
+
+        unsigned char *dst = imageRow(ctx->dest, y);
+        for (int x = tu->x0; x < tu->x1; x++)
+        {
+            if (x > tu->x0)
+            {
+                cumuler(noyauGros, grossiers + (borner(x + r, w) - c0) * CLASSES, 1);
+                cumuler(noyauGros, grossiers + (borner(x - r - 1, w) - c0) * CLASSES, -1);
+            }
+            int cumul = 0, s = 0;
+            while (cumul + noyauGros[s] < cible)
+            {
+                cumul += noyauGros[s++];
+            }
+
+            uint16_t *fin = noyauFin + s * 16;
+            // Recalcul complet (2 r + 1 colonnes) ou rattrapage (deux colonnes par pixel de retard)
+            if (2 * (x - aJour[s]) > 2 * r + 1)
+            {
+                memset(fin, 0, 16 * sizeof(uint16_t));
+                for (int i = -r; i <= r; i++)
+                {
+                    cumuler(fin, fins + (size_t)(borner(x + i, w) - c0) * 256 + s * 16, 1);
+                }
+            }
+            else
+            {
+                for (int j = aJour[s] + 1; j <= x; j++)
+                {
+                    cumuler(fin, fins + (size_t)(borner(j + r, w) - c0) * 256 + s * 16, 1);
+                    cumuler(fin, fins + (size_t)(borner(j - r - 1, w) - c0) * 256 + s * 16, -1);
+                }
+            }
+            aJour[s] = x;
+
+            int v = 0;
+            while (cumul + fin[v] < cible)
+            {
+                cumul += fin[v++];
+            }
+            dst[x] = (unsigned char)(s * 16 + v);
+        }
+    }
+    reserveRendre(fins);
+    return 0;
+}
+
+static int tuileMedianHistogrammes(const struct tuile *tu, void *arg)
+{
+    // Bandes de colonnes étroites, pour que les histogrammes des colonnes restent dans le
+    // cache, mais assez larges devant les 2 rayon colonnes lues de part et d'autre
+    const struct contexteMedian *ctx = arg;
+    int largeur = MEDIAN_BANDE > 4 * ctx->rayon ? MEDIAN_BANDE : 4 * ctx->rayon;
+    for (int x = tu->x0; x < tu->x1; x += largeur)
+    {
+        struct tuile bande = {x, tu->y0, tu->x1 - x > largeur ? x + largeur : tu->x1, tu->y1};
+        if (bandeMedian(ctx, &bande) != 0)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int median(struct imageNB *img, struct imageNB *dest, int rayon)
+{
+    if (img == NULL || img->color == NULL || dest == img || rayon < 0 || rayon > MEDIAN_RAYON_MAX)
+    {
+        printf("Invalid parameters for median\n");
+        return -1;
+    }
+    if (rayon == 0)
+    {
+        copyImage(img, dest);
+        return dest->data != NULL ? 0 : -1;
+    }
+    if (reallocImage(dest, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+
+    struct contexteMedian ctx = {img, dest, rayon};
+    if (rayon == 1 && img->border >= 1)
+    {
+        fillBorder(img);
+        return executerTuiles(img->width, img->height, 1, tuileMedian3, &ctx);
+    }
+    return executerTuiles(img->width, img->height, rayon, tuileMedianHistogrammes, &ctx);
+}
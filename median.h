@@ -0,0 +1,27 @@
+#ifndef _MEDIAN_H_
+#define _MEDIAN_H_
+
+#include "image.h"
+
+/**
+ * Rayon maximal du filtre médian (les histogrammes comptent sur 16 bits)
+ */
+#define MEDIAN_RAYON_MAX 127
+
+/**
+ * Fonction qui applique un filtre médian de taille (2 * rayon + 1)² à une image
+ * Le rayon 1 passe par un réseau de tri de 19 comparaisons, 16 pixels à la fois en SSE2.
+ * Au-delà, chaque colonne garde l'histogramme de sa fenêtre verticale, mis à jour d'un
+ * pixel par ligne, et l'histogramme de la fenêtre glisse d'une colonne par pixel ; la
+ * recherche de la médiane se fait sur 16 classes grossières puis dans les 16 valeurs de la
+ * bonne classe, mises à jour à la demande : le coût par pixel ne dépend pas du rayon. Les
+ * bords sont traités en répliquant les pixels du bord. Le calcul est réparti en tuiles sur
+ * tous les threads.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param rayon entre 0 et MEDIAN_RAYON_MAX
+ * @return 0 si le filtrage a réussi, -1 sinon
+ */
+int median(struct imageNB *img, struct imageNB *dest, int rayon);
+
+#endif
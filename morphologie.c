@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "morphologie.h"
+#include "simd.h"
+#include "parallele.h"
+#include "reserve.h"
+
+/**
+ * Taille de fenêtre jusqu'à laquelle les pixels décalés sont comparés directement
+ */
+#define PETITE_FENETRE 5
+
+struct contexteMorphologie
+{
+    const struct imageNB *img;
+    struct imageNB *dest;
+    int rayonX;
+    int rayonY;
+    int max;
+};
+
+static inline unsigned char extremum(unsigned char a, unsigned char b, int max)
+{
+    return max ? (a > b ? a : b) : (a < b ? a : b);
+}
+
+/**
+ * dst[x] = extremum(a[x], b[x]) pour x de 0 à n - 1 ; dst peut être a ou b
+ */
+static void extremumLignes(const unsigned char *a, const unsigned char *b, unsigned char *dst, int n, int max)
+{
+    int x = 0;
+#ifdef SIMD_X86
+    for (; x + 16 <= n; x += 16)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i *)(a + x));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(b + x));
+        _mm_storeu_si128((__m128i *)(dst + x), max ? _mm_max_epu8(va, vb) : _mm_min_epu8(va, vb));
+    }
+#endif
+    for (; x < n; x++)
+    {
+        dst[x] = extremum(a[x], b[x], max);
+    }
+}
+
+/**
+ * Petite fenêtre : dst[x] = extremum de src[x + i * pas] pour i de 0 à k - 1
+ */
+static void fenetreDirecte(const unsigned char *src, ptrdiff_t pas, unsigned char *dst, int n, int k, int max)
+{
+    if (k == 1)
+    {
+        memcpy(dst, src, (size_t)n);
+        return;
+    }
+    extremumLignes(src, src + pas, dst, n, max);
+    for (int i = 2; i < k; i++)
+    {
+        extremumLignes(dst, src + i * pas, dst, n, max);
+    }
+}
+
+/**
+ * Grande fenêtre sur une ligne de n + k - 1 pixels (van Herk / Gil-Werman) : dans chaque bloc
+ * de k pixels, g cumule l'extremum vers la droite et h vers la gauche ; la fenêtre
+ * [x, x + k - 1] chevauche au plus deux blocs et vaut extremum(h[x], g[x + k - 1])
+ */
+static void fenetreLigne(const unsigned char *ligne, unsigned char *dst, int n, int k, int max, unsigned char *g,
+                         unsigned char *h)
+{
+    int longueur = n + k - 1;
+    for (int debut = 0; debut < longueur; debut += k)
+    {
+        int fin = debut + k < longueur ? debut + k : longueur;
+        g[debut] = ligne[debut];
+        for (int i = debut + 1; i < fin; i++)
+        {
+            g[i] = extremum(g[i - 1], ligne[i], max);
+        }
+        h[fin - 1] = ligne[fin - 1];
+        for (int i = fin - 2; i >= debut; i--)
+        {
+            h[i] = extremum(h[i + 1], ligne[i], max);
+        }
+    }
+    for (int x = 0; x < n; x++)
+    {
+        dst[x] = extremum(h[x], g[x + k - 1], max);
+    }
+}
+
+/**
+ * Même algorithme sur les colonnes : les cumuls portent sur des lignes entières de n pixels
+ * (m lignes dans a), comparées 16 pixels à la fois
+ */
+static void fenetreColonnes(const unsigned char *a, unsigned char *g, unsigned char *h, int n, int m, int k, int max,
+                            unsigned char *const *sorties)
+{
+    for (int debut = 0; debut < m; debut += k)
+    {
+        int fin = debut + k < m ? debut + k : m;
+        memcpy(g + (size_t)debut * n, a + (size_t)debut * n, (size_t)n);
+        for (int j = debut + 1; j < fin; j++)
+        {
+            extremumLignes(g + (size_t)(j - 1) * n, a + (size_t)j * n, g + (size_t)j * n, n, max);
+        }
+        memcpy(h + (size_t)(fin - 1) * n, a + (size_t)(fin - 1) * n, (size_t)n);
+        for (int j = fin - 2; j >= debut; j--)
+        {
+            extremumLignes(h + (size_t)(j + 1) * n, a + (size_t)j * n, h + (size_t)j * n, n, max);
+        }
+    }
+    for (int y = 0; y < m - k + 1; y++)
+    {
+        extremumLignes(h + (size_t)y * n, g + (size_t)(y + k - 1) * n, sorties[y], n, max);
+    }
+}
+
+/**
+ * Copie dans ligne les `longueur` pixels de src à partir de la colonne x0, les colonnes hors
+ * de [0, largeur[ prenant la valeur du bord
+ */
+static void lireLigneBornee(const unsigned char *src, int largeur, int x0, unsigned char *ligne, int longueur)
+{
+    int debut = x0 < 0 ? (-x0 < longueur ? -x0 : longueur) : 0;
+    int fin = largeur - x0 < longueur ? largeur - x0 : longueur;
+    fin = fin > debut ? fin : debut;
+    memset(ligne, src[0], (size_t)debut);
+    memcpy(ligne + debut, src + x0 + debut, (size_t)(fin - debut));
+    memset(ligne + fin, src[largeur - 1], (size_t)(longueur - fin));
+}
+
+static int tuileMorphologie(const struct tuile *t, void *arg)
+{
+    const struct contexteMorphologie *ctx = arg;
+    const struct imageNB *img = ctx->img;
+    int kx = 2 * ctx->rayonX + 1, ky = 2 * ctx->rayonY + 1;
+    int n = t->x1 - t->x0;
+    int m = t->y1 - t->y0 + ky - 1;
+    int longueur = n + kx - 1;
+    int grandeY = ky > PETITE_FENETRE;
+
+    // Extremums horizontaux des m lignes lues, puis cumuls verticaux pour les grandes fenêtres
+    size_t plan = (size_t)m * n;
+    unsigned char *a = reservePrendre(plan * (grandeY ? 3 : 1) + 3 * (size_t)longueur);
+    if (a == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    unsigned char *ligne = a + plan * (grandeY ? 3 : 1);
+    unsigned char *g = ligne + longueur, *h = g + longueur;
+
+    for (int j = 0; j < m; j++)
+    {
+        int sy = t->y0 - ctx->rayonY + j;
+        sy = sy < 0 ? 0 : sy >= img->height ? img->height - 1 : sy;
+        lireLigneBornee(imageRow(img, sy), img->width, t->x0 - ctx->rayonX, ligne, longueur);
+        if (kx <= PETITE_FENETRE)
+        {
+            fenetreDirecte(ligne, 1, a + (size_t)j * n, n, kx, ctx->max);
+        }
+        else
+        {
+            fenetreLigne(ligne, a + (size_t)j * n, n, kx, ctx->max, g, h);
+        }
+    }
+
+    if (grandeY)
+    {
+        unsigned char *sorties[t->y1 - t->y0];
+        for (int y = t->y0; y < t->y1; y++)
+        {
+            sorties[y - t->y0] = imageRow(ctx->dest, y) + t->x0;
+        }
+        fenetreColonnes(a, a + plan, a + 2 * plan, n, m, ky, ctx->max, sorties);
+    }
+    else
+    {
+        for (int y = t->y0; y < t->y1; y++)
+        {
+            fenetreDirecte(a + (size_t)(y - t->y0) * n, n, imageRow(ctx->dest, y) + t->x0, n, ky, ctx->max);
+        }
+    }
+    reserveRendre(a);
+    return 0;
+}
+
+static int morphologie(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY, int max, const char *nom)
+{
+    if (img == NULL || img->color == NULL || dest == img || rayonX < 0 || rayonY < 0)
+    {
+        printf("Invalid parameters for %s\n", nom);
+        return -1;
+    }
+    if (reallocImage(dest, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+
+    struct contexteMorphologie ctx = {img, dest, rayonX, rayonY, max};
+    return executerTuiles(img->width, img->height, rayonY, tuileMorphologie, &ctx);
+}
+
+int eroder(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY)
+{
+    return morphologie(img, dest, rayonX, rayonY, 0, "eroder");
+}
+
+int dilater(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY)
+{
+    return morphologie(img, dest, rayonX, rayonY, 1, "dilater");
+}
+
+/**
+ * Deux passes par une image intermédiaire : extremum `premier` puis l'autre
+ */
+static int composer(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY, int premier,
+                    const char *nom)
+{
+    if (dest == img)
+    {
+        printf("Invalid parameters for %s\n", nom);
+        return -1;
+    }
+    struct imageNB intermediaire = {0};
+    int resultat = morphologie(img, &intermediaire, rayonX, rayonY, premier, nom);
+    if (resultat == 0)
+    {
+        resultat = morphologie(&intermediaire, dest, rayonX, rayonY, !premier, nom);
+    }
+    freeImageMemory(&intermediaire);
+    return resultat;
+}
+
+int ouvrir(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY)
+{
+    return composer(img, dest, rayonX, rayonY, 0, "ouvrir");
+}
+
+int fermer(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY)
+{
+    return composer(img, dest, rayonX, rayonY, 1, "fermer");
+}
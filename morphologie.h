@@ -0,0 +1,55 @@
+#ifndef _MORPHOLOGIE_H_
+#define _MORPHOLOGIE_H_
+
+#include "image.h"
+
+/**
+ * Fonction qui érode une image : chaque pixel prend le minimum du rectangle
+ * (2 * rayonX + 1) x (2 * rayonY + 1) qui l'entoure
+ * Le rectangle est séparable : minimum sur les lignes puis sur les colonnes. Les petites
+ * fenêtres (5 pixels ou moins) comparent directement les pixels décalés, 16 à la fois en
+ * SSE2 ; les grandes utilisent l'algorithme de van Herk / Gil-Werman (minimums cumulés
+ * vers l'avant et vers l'arrière dans des blocs de la taille de la fenêtre), soit trois
+ * comparaisons par pixel et par axe quel que soit le rayon. Les bords sont traités en
+ * répliquant les pixels du bord. Le calcul est réparti en tuiles sur tous les threads.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param rayonX
+ * @param rayonY
+ * @return 0 si l'érosion a réussi, -1 sinon
+ */
+int eroder(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY);
+
+/**
+ * Fonction qui dilate une image : maximum du rectangle, comme eroder
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param rayonX
+ * @param rayonY
+ * @return 0 si la dilatation a réussi, -1 sinon
+ */
+int dilater(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY);
+
+/**
+ * Fonction qui calcule l'ouverture d'une image (érosion puis dilatation) : efface les
+ * détails clairs plus petits que le rectangle
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param rayonX
+ * @param rayonY
+ * @return 0 si l'ouverture a réussi, -1 sinon
+ */
+int ouvrir(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY);
+
+/**
+ * Fonction qui calcule la fermeture d'une image (dilatation puis érosion) : bouche les
+ * trous sombres plus petits que le rectangle
+ * @param img
+ * @param dest image de sortie initialisée, différente de img
+ * @param rayonX
+ * @param rayonY
+ * @return 0 si la fermeture a réussi, -1 sinon
+ */
+int fermer(struct imageNB *img, struct imageNB *dest, int rayonX, int rayonY);
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include "operations.h"
+#include "geometrie.h"
+#include "integrale.h"
+#include "lut.h"
+#include "contours.h"
+#include "convolution.h"
+#include "flou.h"
+#include "affine.h"
+#include "echelle.h"
+#include "histo.h"
+
+static const int sobelStandardX[3][3] = {{-1, 0, 1}, {-2, 0, 2}, {-1, 0, 1}};
+static const int sobelStandardY[3][3] = {{-1, -2, -1}, {0, 0, 0}, {1, 2, 1}};
+
+int sobel(struct imageNB *img, struct imageNB *dest, int filtreX[3][3], int filtreY[3][3])
+{
+    // Les noyaux de Sobel habituels passent par le moteur séparable (contours.c)
+    if (memcmp(filtreX, sobelStandardX, sizeof(sobelStandardX)) == 0 &&
+        memcmp(filtreY, sobelStandardY, sizeof(sobelStandardY)) == 0)
+    {
+        return sobelGradient(img, dest, NULL, NORME_L1);
+    }
+
+    // Les autres par le moteur de convolution générique
+    struct noyau kx = {3, 3, {0}, 0, 0, 0};
+    struct noyau ky = {3, 3, {0}, 0, 0, 0};
+    for (int k = 0; k < 9; k++)
+    {
+        kx.coefs[k] = filtreX[k / 3][k % 3];
+        ky.coefs[k] = filtreY[k / 3][k % 3];
+    }
+    return convoluerGradient(img, dest, &kx, &ky);
+}
+
+int translation(struct imageNB *img, struct imageNB *dest, int decal)
+{
+    return translater(img, dest, decal, 0);
+}
+
+int seuillage(struct imageNB *img, struct imageNB *dest, int seuil)
+{
+    struct lut l;
+    lutIdentite(&l);
+    lutSeuillage(&l, seuil);
+    return appliquerLUT(img, dest, &l);
+}
+
+int redimensionner(struct imageNB *img, struct imageNB *dest, int largeur, int hauteur)
+{
+    return redimensionnerImage(img, dest, largeur, hauteur, ECHELLE_AUTO);
+}
+
+int histogramme(struct imageNB *img, struct imageNB *dest)
+{
+    struct histo h;
+    if (calculerHistogramme(img, &h) != 0)
+    {
+        return -1;
+    }
+    return dessinerHistogramme(&h, dest, HISTO_LARGEUR, HISTO_HAUTEUR);
+}
+
+int contraste(struct imageNB *img, struct imageNB *dest, int valeurContraste) {
+    // Appliquer le contraste
+    struct lut l;
+    lutIdentite(&l);
+    lutAjouter(&l, valeurContraste);
+    return appliquerLUT(img, dest, &l);
+}
+
+int luminosite(struct imageNB *img, struct imageNB *dest, int valeurLuminosite) {
+    // Appliquer la luminosité
+    struct lut l;
+    lutIdentite(&l);
+    lutAjouter(&l, valeurLuminosite);
+    return appliquerLUT(img, dest, &l);
+}
+
+int flouter(struct imageNB *img, struct imageNB *dest)
+{
+    // Moyenne 3x3 : flou boîte de rayon 1
+    return flouBoite(img, dest, 1);
+}
+
+int pivoter(struct imageNB *img, struct imageNB *dest, float angle, bool clockwise)
+{
+    struct affine t;
+    affineIdentite(&t);
+    affineRotation(&t, clockwise ? angle : -angle);
+    return transformerAffine(img, dest, &t, INTERP_BILINEAIRE, CADRE_ENGLOBANT);
+}
+
+int negatif(struct imageNB *img, struct imageNB *dest)
+{
+    if (img == NULL || img->color == NULL)
+    {
+        printf("Invalid image structure\n");
+        return -1;
+    }
+
+    struct lut l;
+    lutIdentite(&l);
+    lutNegatif(&l, img->vmax);
+    return appliquerLUT(img, dest, &l);
+}
+
+int pixeliser(struct imageNB *img, struct imageNB *dest, int taillePixel)
+{
+    if (img == NULL || img->color == NULL || taillePixel < 1)
+    {
+        printf("Invalid parameters for pixeliser function\n");
+        return -1;
+    }
+    return pixeliserBlocs(img, dest, taillePixel, taillePixel);
+}
@@ -0,0 +1,124 @@
+#ifndef _OPERATIONS_H_
+#define _OPERATIONS_H_
+
+#include <stdbool.h>
+
+#include "image.h"
+
+/*
+ * Toutes les opérations lisent `img` et écrivent le résultat dans `dest`, qui doit être
+ * initialisée ({0} ou image déjà allouée) : son allocation est réutilisée quand les
+ * dimensions ne changent pas. Les opérations point à point acceptent dest == img.
+ * Elles renvoient 0 en cas de succès, -1 sinon.
+ */
+
+/**
+ * Fonction qui ajoute un filtre de sobel à une image
+ * Avec les noyaux de Sobel standards, le calcul est délégué à sobelGradient (contours.h).
+ * @param img
+ * @param dest
+ * @param filtreX
+ * @param filtreY
+ * @return
+ */
+int sobel(struct imageNB *img, struct imageNB *dest, int filtreX[3][3], int filtreY[3][3]);
+
+/**
+ * Fonction qui fait une translation horizontale sur une image, avec retour de l'autre côté
+ * @param img
+ * @param dest
+ * @param decal en pixels, vers la droite (négatif : vers la gauche)
+ * @return
+ */
+int translation(struct imageNB *img, struct imageNB *dest, int decal);
+
+/**
+ * Fonction qui ajoute du seuillage à une image
+ * @param img
+ * @param dest
+ * @param seuil
+ * @return
+ */
+int seuillage(struct imageNB *img, struct imageNB *dest, int seuil);
+
+/**
+ * Fonction qui redimensionne une image à une taille quelconque
+ * Moyenne des pixels couverts en réduction, Lanczos en agrandissement.
+ * Voir echelle.h pour choisir le filtre.
+ * @param img
+ * @param dest
+ * @param largeur
+ * @param hauteur
+ * @return
+ */
+int redimensionner(struct imageNB *img, struct imageNB *dest, int largeur, int hauteur);
+
+/**
+ * Fonction qui réalise un histogramme d'une image, dessiné en HISTO_LARGEUR x HISTO_HAUTEUR
+ * Voir histo.h pour les statistiques, l'égalisation et CLAHE.
+ * @param img
+ * @param dest
+ * @return
+ */
+int histogramme(struct imageNB *img, struct imageNB *dest);
+
+/**
+ * Fonction qui ajoute du contraste à une image
+ * @param img
+ * @param dest
+ * @param valeurContraste
+ * @return
+ */
+int contraste(struct imageNB *img, struct imageNB *dest, int valeurContraste);
+
+/**
+ * Fonction qui ajoute de la luminosité à une image
+ * @param img
+ * @param dest
+ * @param valeurLuminosite
+ * @return
+ */
+int luminosite(struct imageNB *img, struct imageNB *dest, int valeurLuminosite);
+
+/**
+ * Fonction qui floute une image (moyenne 3x3)
+ * Voir flou.h pour les flous de rayon quelconque et le flou gaussien.
+ * @param img
+ * @param dest
+ * @return
+ */
+int flouter(struct imageNB *img, struct imageNB *dest);
+
+/**
+ * Fonction qui fait faire une rotation à une image, d'un angle quelconque
+ * L'image de sortie englobe toute l'image tournée, les coins ajoutés sont noirs.
+ * Voir affine.h pour les autres transformations et méthodes d'interpolation.
+ * @param img
+ * @param dest
+ * @param angle
+ * @param clockwise
+ * @return
+ */
+int pivoter(struct imageNB *img, struct imageNB *dest, float angle, bool clockwise);
+
+/**
+ * Fonction qui ajoute un effet negatif à une image
+ * @param img
+ * @param dest
+ * @return
+ */
+int negatif(struct imageNB *img, struct imageNB *dest);
+
+/**
+ * Fonction qui pixélise une image
+ * Chaque bloc coûte quatre accès à la table des sommes de l'image, gardée avec elle : les
+ * pixélisations suivantes de la même image, quelle que soit la taille des blocs, la
+ * réutilisent.
+ * @param img
+ * @param dest
+ * @param taillePixel
+ * @return
+ */
+int pixeliser(struct imageNB *img, struct imageNB *dest, int taillePixel);
+
+#endif
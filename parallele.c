@@ -0,0 +1,352 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "parallele.h"
+
+#define NB_THREADS_MAX 256
+
+/**
+ * Intervalle de tâches [debut, fin[ d'un thread, complété pour que les verrous de deux
+ * threads voisins ne partagent pas la même ligne de cache
+ */
+struct file
+{
+    pthread_mutex_t verrou;
+    int debut;
+    int fin;
+    char remplissage[64];
+};
+
+static struct
+{
+    int nb;
+    pthread_t *threads;
+    struct file *files;
+
+    pthread_mutex_t verrou;
+    pthread_cond_t travail;
+    pthread_cond_t termine;
+    unsigned generation;
+    int actifs;
+    int arret;
+
+    void (*tache)(void *ctx, int indice);
+    void *ctx;
+} pool = {.nb = 0, .verrou = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * Un seul parallelFor à la fois utilise le pool ; les autres s'exécutent sur place
+ */
+static pthread_mutex_t occupe = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t verrouInit = PTHREAD_MUTEX_INITIALIZER;
+static __thread int dansPool = 0;
+
+/**
+ * Prend la prochaine tâche de son propre intervalle
+ */
+static int prendre(int moi)
+{
+    struct file *f = &pool.files[moi];
+    int indice = -1;
+    pthread_mutex_lock(&f->verrou);
+    if (f->debut < f->fin)
+    {
+        indice = f->debut++;
+    }
+    pthread_mutex_unlock(&f->verrou);
+    return indice;
+}
+
+/**
+ * Vole la seconde moitié de l'intervalle d'un autre thread ; renvoie 1 si du travail a été pris
+ */
+static int voler(int moi)
+{
+    for (int k = 1; k < pool.nb; k++)
+    {
+        struct file *victime = &pool.files[(moi + k) % pool.nb];
+        int debut = 0, fin = 0;
+
+        pthread_mutex_lock(&victime->verrou);
+        int reste = victime->fin - victime->debut;
+        if (reste > 0)
+        {
+            int part = (reste + 1) / 2;
+            fin = victime->fin;
+            debut = fin - part;
+            victime->fin = debut;
+        }
+        pthread_mutex_unlock(&victime->verrou);
+
+        if (fin > debut)
+        {
+            struct file *f = &pool.files[moi];
+            pthread_mutex_lock(&f->verrou);
+            f->debut = debut;
+            f->fin = fin;
+            pthread_mutex_unlock(&f->verrou);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void travailler(int moi)
+{
+    for (;;)
+    {
+        int indice;
+        while ((indice = prendre(moi)) >= 0)
+        {
+            pool.tache(pool.ctx, indice);
+        }
+        if (!voler(moi))
+        {
+            return;
+        }
+    }
+}
+
+static void *boucleThread(void *arg)
+{
+    int moi = (int)(size_t)arg;
+    unsigned vue = 0;
+    dansPool = 1;
+
+    pthread_mutex_lock(&pool.verrou);
+    for (;;)
+    {
+        while (!pool.arret && pool.generation == vue)
+        {
+            pthread_cond_wait(&pool.travail, &pool.verrou);
+        }
+        if (pool.arret)
+        {
+            break;
+        }
+        vue = pool.generation;
+        pthread_mutex_unlock(&pool.verrou);
+
+        travailler(moi);
+
+        pthread_mutex_lock(&pool.verrou);
+        if (--pool.actifs == 0)
+        {
+            pthread_cond_signal(&pool.termine);
+        }
+    }
+    pthread_mutex_unlock(&pool.verrou);
+    return NULL;
+}
+
+static int nbThreadsParDefaut(void)
+{
+    const char *env = getenv("IMAGE_THREADS");
+    if (env != NULL && atoi(env) > 0)
+    {
+        return atoi(env);
+    }
+    long coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+    return coeurs > 0 ? (int)coeurs : 1;
+}
+
+int parallelInit(int nbThreads)
+{
+    if (nbThreads <= 0)
+    {
+        nbThreads = nbThreadsParDefaut();
+    }
+    if (nbThreads > NB_THREADS_MAX)
+    {
+        nbThreads = NB_THREADS_MAX;
+    }
+
+    parallelFin();
+
+    pool.files = calloc((size_t)nbThreads, sizeof(struct file));
+    pool.threads = calloc((size_t)nbThreads, sizeof(pthread_t));
+    if (pool.files == NULL || pool.threads == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        free(pool.files);
+        free(pool.threads);
+        pool.files = NULL;
+        pool.threads = NULL;
+        return -1;
+    }
+    for (int i = 0; i < nbThreads; i++)
+    {
+        pthread_mutex_init(&pool.files[i].verrou, NULL);
+    }
+    pthread_cond_init(&pool.travail, NULL);
+    pthread_cond_init(&pool.termine, NULL);
+    pool.arret = 0;
+    pool.generation = 0;
+    pool.nb = 1;
+
+    // Le thread appelant est le thread 0
+    for (int i = 1; i < nbThreads; i++)
+    {
+        if (pthread_create(&pool.threads[i], NULL, boucleThread, (void *)(size_t)i) != 0)
+        {
+            printf("Unable to start thread %d, using %d threads\n", i, i);
+            break;
+        }
+        pool.nb = i + 1;
+    }
+    return 0;
+}
+
+void parallelFin(void)
+{
+    if (pool.nb == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool.verrou);
+    pool.arret = 1;
+    pthread_cond_broadcast(&pool.travail);
+    pthread_mutex_unlock(&pool.verrou);
+
+    for (int i = 1; i < pool.nb; i++)
+    {
+        pthread_join(pool.threads[i], NULL);
+    }
+    for (int i = 0; i < pool.nb; i++)
+    {
+        pthread_mutex_destroy(&pool.files[i].verrou);
+    }
+    pthread_cond_destroy(&pool.travail);
+    pthread_cond_destroy(&pool.termine);
+    free(pool.files);
+    free(pool.threads);
+    pool.files = NULL;
+    pool.threads = NULL;
+    pool.nb = 0;
+}
+
+int parallelThreads(void)
+{
+    pthread_mutex_lock(&verrouInit);
+    if (pool.nb == 0 && parallelInit(0) != 0)
+    {
+        pthread_mutex_unlock(&verrouInit);
+        return 1;
+    }
+    int nb = pool.nb;
+    pthread_mutex_unlock(&verrouInit);
+    return nb;
+}
+
+void parallelFor(int nbTaches, void (*tache)(void *ctx, int indice), void *ctx)
+{
+    if (nbTaches <= 0)
+    {
+        return;
+    }
+
+    if (nbTaches == 1 || dansPool || parallelThreads() == 1 || pthread_mutex_trylock(&occupe) != 0)
+    {
+        for (int i = 0; i < nbTaches; i++)
+        {
+            tache(ctx, i);
+        }
+        return;
+    }
+
+    // Intervalles contigus de départ, un par thread
+    int nb = pool.nb;
+    for (int i = 0; i < nb; i++)
+    {
+        pool.files[i].debut = (int)((long)nbTaches * i / nb);
+        pool.files[i].fin = (int)((long)nbTaches * (i + 1) / nb);
+    }
+
+    pthread_mutex_lock(&pool.verrou);
+    pool.tache = tache;
+    pool.ctx = ctx;
+    pool.actifs = nb - 1;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.travail);
+    pthread_mutex_unlock(&pool.verrou);
+
+    dansPool = 1;
+    travailler(0);
+    dansPool = 0;
+
+    pthread_mutex_lock(&pool.verrou);
+    while (pool.actifs > 0)
+    {
+        pthread_cond_wait(&pool.termine, &pool.verrou);
+    }
+    pthread_mutex_unlock(&pool.verrou);
+
+    pthread_mutex_unlock(&occupe);
+}
+
+/**
+ * Contexte d'un découpage en tuiles
+ */
+struct decoupage
+{
+    int width;
+    int height;
+    int largeur;
+    int hauteur;
+    int colonnes;
+    int (*noyau)(const struct tuile *t, void *ctx);
+    void *ctx;
+    atomic_int erreur;
+};
+
+static void tacheTuile(void *arg, int indice)
+{
+    struct decoupage *d = arg;
+    struct tuile t;
+    t.x0 = (indice % d->colonnes) * d->largeur;
+    t.y0 = (indice / d->colonnes) * d->hauteur;
+    t.x1 = t.x0 + d->largeur < d->width ? t.x0 + d->largeur : d->width;
+    t.y1 = t.y0 + d->hauteur < d->height ? t.y0 + d->hauteur : d->height;
+
+    if (d->noyau(&t, d->ctx) != 0)
+    {
+        atomic_store(&d->erreur, 1);
+    }
+}
+
+int executerTuiles(int width, int height, int halo, int (*noyau)(const struct tuile *t, void *ctx), void *ctx)
+{
+    if (width <= 0 || height <= 0)
+    {
+        return 0;
+    }
+
+    struct decoupage d;
+    d.width = width;
+    d.height = height;
+    d.noyau = noyau;
+    d.ctx = ctx;
+    atomic_init(&d.erreur, 0);
+
+    // Tuiles larges (les noyaux travaillent par lignes), hautes d'au moins 8 halos pour que
+    // les lignes relues au-dessus et en dessous de chaque tuile restent minoritaires
+    d.largeur = width < TUILE_LARGEUR_MAX ? width : TUILE_LARGEUR_MAX;
+    d.hauteur = TUILE_OCTETS / d.largeur;
+    if (d.hauteur < 8)
+    {
+        d.hauteur = 8;
+    }
+    if (d.hauteur < 8 * halo)
+    {
+        d.hauteur = 8 * halo;
+    }
+    d.colonnes = (width + d.largeur - 1) / d.largeur;
+    int lignes = (height + d.hauteur - 1) / d.hauteur;
+
+    parallelFor(d.colonnes * lignes, tacheTuile, &d);
+    return atomic_load(&d.erreur) ? -1 : 0;
+}
@@ -0,0 +1,72 @@
+#ifndef _PARALLELE_H_
+#define _PARALLELE_H_
+
+/**
+ * Taille visée (en octets de sortie) pour une tuile : de quoi tenir dans le cache L2
+ * avec ses lignes source
+ */
+#define TUILE_OCTETS (128 * 1024)
+
+/**
+ * Largeur maximale d'une tuile
+ */
+#define TUILE_LARGEUR_MAX 2048
+
+/**
+ * Rectangle [x0, x1[ x [y0, y1[ de l'image de sortie traité par une tâche
+ */
+struct tuile
+{
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+/**
+ * Fonction qui démarre le pool de threads persistant
+ * Sans appel explicite, le pool est créé au premier besoin avec la valeur de la variable
+ * d'environnement IMAGE_THREADS, ou le nombre de cœurs.
+ * @param nbThreads nombre total de threads (appelant compris) ; 0 pour la valeur par défaut
+ * @return 0 si le pool a démarré, -1 sinon
+ */
+int parallelInit(int nbThreads);
+
+/**
+ * Fonction qui arrête le pool de threads
+ */
+void parallelFin(void);
+
+/**
+ * Fonction qui renvoie le nombre de threads utilisés par le pool
+ * @return
+ */
+int parallelThreads(void);
+
+/**
+ * Fonction qui exécute tache(ctx, i) pour i de 0 à nbTaches - 1 sur tous les threads
+ * Chaque thread commence par un intervalle contigu de tâches puis vole la moitié de
+ * l'intervalle restant des autres threads quand le sien est vide. Les appels imbriqués
+ * (ou concurrents depuis un autre thread) s'exécutent dans le thread appelant.
+ * @param nbTaches
+ * @param tache
+ * @param ctx
+ */
+void parallelFor(int nbTaches, void (*tache)(void *ctx, int indice), void *ctx);
+
+/**
+ * Fonction qui découpe une image de sortie width x height en tuiles et appelle noyau sur
+ * chacune, en parallèle
+ * Les tuiles sont disjointes : le résultat ne dépend ni du nombre de threads ni de l'ordre
+ * d'exécution. `halo` est la portée du voisinage lu par le noyau autour de sa tuile ; les
+ * tuiles sont assez hautes pour que ce halo reste négligeable.
+ * @param width
+ * @param height
+ * @param halo
+ * @param noyau renvoie 0 en cas de succès, -1 sinon
+ * @param ctx
+ * @return 0 si toutes les tuiles ont réussi, -1 sinon
+ */
+int executerTuiles(int width, int height, int halo, int (*noyau)(const struct tuile *t, void *ctx), void *ctx);
+
+#endif
@@ -0,0 +1,737 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "pgm.h"
+#include "dallage.h"
+#include "trace.h"
+#include "reserve.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/**
+ * Taille des blocs lus quand le fichier ne peut pas être projeté en mémoire
+ */
+#define PGM_BLOC (4 << 20)
+
+/**
+ * Taille maximale de l'en-tête lu par ouvrirFluxPGM, et nombre de lignes par lecture ou
+ * écriture vectorisée d'une bande
+ */
+#define PGM_EN_TETE 4096
+#define PGM_LOT 256
+
+static __thread struct pgmStats statsLecture;
+static __thread struct pgmStats statsEcriture;
+static int verbose = 1;
+
+static double maintenant(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void afficherDebit(const char *action, const char *nomImage, const struct pgmStats *stats)
+{
+    if (!verbose)
+    {
+        return;
+    }
+    double mo = stats->octets / (1024.0 * 1024.0);
+    double debit = stats->secondes > 0 ? mo / stats->secondes : 0;
+    printf("%s %s: %.2f MB in %.3f ms (%.1f MB/s%s)\n", action, nomImage, mo, stats->secondes * 1e3, debit,
+           stats->mmap ? ", mmap" : "");
+}
+
+/**
+ * Saute les blancs et les commentaires de l'en-tête
+ */
+static size_t sauterBlancs(const unsigned char *buffer, size_t taille, size_t pos)
+{
+    while (pos < taille)
+    {
+        if (buffer[pos] == '#')
+        {
+            while (pos < taille && buffer[pos] != '\n' && buffer[pos] != '\r')
+            {
+                pos++;
+            }
+        }
+        else if (buffer[pos] == ' ' || buffer[pos] == '\t' || buffer[pos] == '\n' || buffer[pos] == '\r' ||
+                 buffer[pos] == '\v' || buffer[pos] == '\f')
+        {
+            pos++;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return pos;
+}
+
+/**
+ * Lit un entier positif de l'en-tête
+ */
+static size_t lireEntier(const unsigned char *buffer, size_t taille, size_t pos, int *valeur)
+{
+    pos = sauterBlancs(buffer, taille, pos);
+    if (pos >= taille || buffer[pos] < '0' || buffer[pos] > '9')
+    {
+        return 0;
+    }
+
+    long n = 0;
+    while (pos < taille && buffer[pos] >= '0' && buffer[pos] <= '9')
+    {
+        n = n * 10 + (buffer[pos] - '0');
+        if (n > INT_MAX)
+        {
+            return 0;
+        }
+        pos++;
+    }
+    *valeur = (int)n;
+    return pos;
+}
+
+size_t parsePGMHeader(const unsigned char *buffer, size_t taille, int *width, int *height, int *vmax)
+{
+    if (taille < 2 || buffer[0] != 'P' || buffer[1] != '5')
+    {
+        return 0;
+    }
+
+    size_t pos = 2;
+    if ((pos = lireEntier(buffer, taille, pos, width)) == 0 ||
+        (pos = lireEntier(buffer, taille, pos, height)) == 0 ||
+        (pos = lireEntier(buffer, taille, pos, vmax)) == 0)
+    {
+        return 0;
+    }
+
+    // Un seul blanc sépare maxval des pixels (qui peuvent eux-mêmes valoir '\n' ou ' ')
+    if (pos >= taille || !(buffer[pos] == ' ' || buffer[pos] == '\t' || buffer[pos] == '\n' || buffer[pos] == '\r'))
+    {
+        return 0;
+    }
+    return pos + 1;
+}
+
+/**
+ * Vérifie les dimensions lues dans l'en-tête
+ */
+static int verifierEnTete(const char *nomImage, int width, int height, int vmax)
+{
+    if (width <= 0 || height <= 0 || vmax <= 0 || vmax > 255)
+    {
+        printf("Unsupported PGM header in %s (%d x %d, maxval %d)\n", nomImage, width, height, vmax);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Chargement par blocs, utilisé quand mmap n'est pas disponible (tube, fichier spécial...)
+ */
+static int loadPGMBlocs(struct imageNB *img, char *nomImage, int fd)
+{
+    // L'en-tête tient toujours dans le premier bloc, sauf commentaires démesurés
+    unsigned char *bloc = reservePrendre(PGM_BLOC);
+    if (bloc == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+
+    size_t lu = 0;
+    ssize_t n;
+    while (lu < PGM_BLOC && (n = read(fd, bloc + lu, PGM_BLOC - lu)) > 0)
+    {
+        lu += (size_t)n;
+    }
+
+    int width, height, vmax;
+    size_t debut = parsePGMHeader(bloc, lu, &width, &height, &vmax);
+    if (debut == 0)
+    {
+        printf("Unknown format\n");
+        reserveRendre(bloc);
+        return -1;
+    }
+    if (verifierEnTete(nomImage, width, height, vmax) != 0 || allocImage(img, width, height, IMAGE_BORDURE) != 0)
+    {
+        reserveRendre(bloc);
+        return -1;
+    }
+    img->vmax = vmax;
+
+    // Copie ligne par ligne du contenu déjà lu, puis lecture directe dans les lignes restantes
+    size_t disponible = lu - debut;
+    const unsigned char *src = bloc + debut;
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char *ligne = imageRow(img, y);
+        size_t copie = disponible < (size_t)width ? disponible : (size_t)width;
+        memcpy(ligne, src, copie);
+        src += copie;
+        disponible -= copie;
+
+        while (copie < (size_t)width)
+        {
+            n = read(fd, ligne + copie, width - copie);
+            if (n <= 0)
+            {
+                printf("Truncated PGM file: %s\n", nomImage);
+                reserveRendre(bloc);
+                freeImageMemory(img);
+                return -1;
+            }
+            copie += (size_t)n;
+            lu += (size_t)n;
+        }
+    }
+
+    reserveRendre(bloc);
+    statsLecture.octets = lu;
+    return 0;
+}
+
+int loadPGM(struct imageNB *img, char *nomImage)
+{
+    double debutChrono = maintenant();
+    img->data = NULL;
+    img->color = NULL;
+
+    int fd = open(nomImage, O_RDONLY);
+    if (fd < 0)
+    {
+        printf("--> %s not found \n", nomImage);
+        return -1;
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "load");
+
+    struct stat st;
+    void *carte = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        carte = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    int resultat;
+    if (carte != MAP_FAILED)
+    {
+        size_t taille = (size_t)st.st_size;
+        const unsigned char *buffer = carte;
+        madvise(carte, taille, MADV_SEQUENTIAL);
+
+        int width, height, vmax;
+        size_t debut = parsePGMHeader(buffer, taille, &width, &height, &vmax);
+        if (debut == 0)
+        {
+            printf("Unknown format\n");
+            resultat = -1;
+        }
+        else if (verifierEnTete(nomImage, width, height, vmax) != 0)
+        {
+            resultat = -1;
+        }
+        else if (taille - debut < (size_t)width * height)
+        {
+            printf("Truncated PGM file: %s\n", nomImage);
+            resultat = -1;
+        }
+        else if (allocImage(img, width, height, IMAGE_BORDURE) != 0)
+        {
+            resultat = -1;
+        }
+        else
+        {
+            img->vmax = vmax;
+            const unsigned char *src = buffer + debut;
+            for (int y = 0; y < height; y++)
+            {
+                memcpy(imageRow(img, y), src, width);
+                src += width;
+            }
+            statsLecture.octets = taille;
+            resultat = 0;
+        }
+        munmap(carte, taille);
+        statsLecture.mmap = 1;
+    }
+    else
+    {
+        resultat = loadPGMBlocs(img, nomImage, fd);
+        statsLecture.mmap = 0;
+    }
+    close(fd);
+    if (resultat == 0)
+    {
+        traceOctets(statsLecture.octets, 0);
+    }
+    traceFermer(&zone);
+
+    if (resultat == 0)
+    {
+        statsLecture.secondes = maintenant() - debutChrono;
+        if (verbose)
+        {
+            printf("P5\nHeight = %d\nWidth = %d, %d\n", img->height, img->width, img->vmax);
+        }
+        afficherDebit("Loaded", nomImage, &statsLecture);
+    }
+    return resultat;
+}
+
+/**
+ * Écrit toutes les entrées d'un tableau iovec, en reprenant après les écritures partielles
+ */
+static int ecrireTout(int fd, struct iovec *iov, int nb)
+{
+    while (nb > 0)
+    {
+        int lot = nb < IOV_MAX ? nb : IOV_MAX;
+        ssize_t n = writev(fd, iov, lot);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        // Avance dans le tableau selon le nombre d'octets réellement écrits
+        size_t reste = (size_t)n;
+        while (nb > 0 && reste >= iov->iov_len)
+        {
+            reste -= iov->iov_len;
+            iov++;
+            nb--;
+        }
+        if (nb > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + reste;
+            iov->iov_len -= reste;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Lit toutes les entrées d'un tableau iovec à partir de position, en reprenant après les
+ * lectures partielles
+ */
+static int lireTout(int fd, struct iovec *iov, int nb, off_t position)
+{
+    while (nb > 0)
+    {
+        ssize_t n = preadv(fd, iov, nb < IOV_MAX ? nb : IOV_MAX, position);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        position += n;
+        size_t reste = (size_t)n;
+        while (nb > 0 && reste >= iov->iov_len)
+        {
+            reste -= iov->iov_len;
+            iov++;
+            nb--;
+        }
+        if (nb > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + reste;
+            iov->iov_len -= reste;
+        }
+    }
+    return 0;
+}
+
+int savePGM(struct imageNB *img, char *nomImage)
+{
+    double debutChrono = maintenant();
+
+    int fd = open(nomImage, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        printf("Unable to create file: %s \n", nomImage);
+        return -1;
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "save");
+
+    char enTete[64];
+    int tailleEnTete = snprintf(enTete, sizeof(enTete), "P5\n%d %d\n255\n", img->width, img->height);
+
+    // Une entrée pour l'en-tête puis une par ligne (les lignes ne sont pas contiguës à cause de la bordure)
+    struct iovec *iov = reservePrendre((size_t)(img->height + 1) * sizeof(struct iovec));
+    if (iov == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        close(fd);
+        traceFermer(&zone);
+        return -1;
+    }
+    iov[0].iov_base = enTete;
+    iov[0].iov_len = (size_t)tailleEnTete;
+    for (int y = 0; y < img->height; y++)
+    {
+        iov[y + 1].iov_base = imageRow(img, y);
+        iov[y + 1].iov_len = (size_t)img->width;
+    }
+
+    int resultat = ecrireTout(fd, iov, img->height + 1);
+    reserveRendre(iov);
+    if (close(fd) != 0)
+    {
+        resultat = -1;
+    }
+    if (resultat == 0)
+    {
+        traceOctets(0, (size_t)tailleEnTete + (size_t)img->width * img->height);
+    }
+    traceFermer(&zone);
+    if (resultat != 0)
+    {
+        printf("Unable to write file: %s \n", nomImage);
+        return -1;
+    }
+
+    statsEcriture.octets = (size_t)tailleEnTete + (size_t)img->width * img->height;
+    statsEcriture.secondes = maintenant() - debutChrono;
+    statsEcriture.mmap = 0;
+    afficherDebit("Saved", nomImage, &statsEcriture);
+    return 0;
+}
+
+/**
+ * Octet du masque (pixel x + i au bit i) vers l'octet PBM (pixel x + i au bit 7 - i, 1 = noir)
+ */
+static uint8_t octetPBM(uint8_t octet)
+{
+    uint8_t retourne = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        retourne |= (uint8_t)(((octet >> i) & 1) << (7 - i));
+    }
+    return (uint8_t)~retourne;
+}
+
+int saveMasquePBM(const struct masque *m, char *nomImage)
+{
+    double debutChrono = maintenant();
+    if (m == NULL || m->bits == NULL)
+    {
+        printf("Invalid parameters for saveMasquePBM\n");
+        return -1;
+    }
+
+    int fd = open(nomImage, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        printf("Unable to create file: %s \n", nomImage);
+        return -1;
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "save");
+
+    char enTete[64];
+    int tailleEnTete = snprintf(enTete, sizeof(enTete), "P4\n%d %d\n", m->largeur, m->hauteur);
+
+    // Les lignes du fichier sont converties d'un bloc, puis écrites avec l'en-tête
+    size_t octetsLigne = ((size_t)m->largeur + 7) / 8;
+    size_t octets = octetsLigne * m->hauteur;
+    uint8_t *pixels = reservePrendre(octets);
+    if (pixels == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        close(fd);
+        traceFermer(&zone);
+        return -1;
+    }
+    uint8_t table[256];
+    for (int v = 0; v < 256; v++)
+    {
+        table[v] = octetPBM((uint8_t)v);
+    }
+    // Les bits au-delà de la largeur restent à 0 dans le fichier
+    uint8_t dernier = m->largeur % 8 == 0 ? 0xFF : (uint8_t)(0xFF << (8 - m->largeur % 8));
+    for (int y = 0; y < m->hauteur; y++)
+    {
+        const uint8_t *src = m->bits + (size_t)y * m->pas;
+        uint8_t *dst = pixels + (size_t)y * octetsLigne;
+        for (size_t i = 0; i < octetsLigne; i++)
+        {
+            dst[i] = table[src[i]];
+        }
+        dst[octetsLigne - 1] &= dernier;
+    }
+
+    struct iovec iov[2] = {{enTete, (size_t)tailleEnTete}, {pixels, octets}};
+    int resultat = ecrireTout(fd, iov, 2);
+    reserveRendre(pixels);
+    if (close(fd) != 0)
+    {
+        resultat = -1;
+    }
+    if (resultat == 0)
+    {
+        traceOctets(0, (size_t)tailleEnTete + octets);
+    }
+    traceFermer(&zone);
+    if (resultat != 0)
+    {
+        printf("Unable to write file: %s \n", nomImage);
+        return -1;
+    }
+
+    statsEcriture.octets = (size_t)tailleEnTete + octets;
+    statsEcriture.secondes = maintenant() - debutChrono;
+    statsEcriture.mmap = 0;
+    afficherDebit("Saved", nomImage, &statsEcriture);
+    return 0;
+}
+
+int estNomPBM(const char *nomImage)
+{
+    size_t n = strlen(nomImage);
+    return n >= 4 && strcasecmp(nomImage + n - 4, ".pbm") == 0;
+}
+
+int loadImage(struct imageNB *img, char *nomImage)
+{
+    if (!estNomDallage(nomImage))
+    {
+        return loadPGM(img, nomImage);
+    }
+    double debutChrono = maintenant();
+    if (loadDallage(img, nomImage, &statsLecture.octets) != 0)
+    {
+        return -1;
+    }
+    statsLecture.secondes = maintenant() - debutChrono;
+    statsLecture.mmap = 0;
+    if (verbose)
+    {
+        printf("IMT\nHeight = %d\nWidth = %d, %d\n", img->height, img->width, img->vmax);
+    }
+    afficherDebit("Loaded", nomImage, &statsLecture);
+    return 0;
+}
+
+int saveImage(struct imageNB *img, char *nomImage)
+{
+    if (estNomDallage(nomImage))
+    {
+        double debutChrono = maintenant();
+        if (saveDallage(img, nomImage, 0, &statsEcriture.octets) != 0)
+        {
+            return -1;
+        }
+        statsEcriture.secondes = maintenant() - debutChrono;
+        statsEcriture.mmap = 0;
+        afficherDebit("Saved", nomImage, &statsEcriture);
+        return 0;
+    }
+    if (!estNomPBM(nomImage))
+    {
+        return savePGM(img, nomImage);
+    }
+    struct masque m;
+    if (masqueSeuil(img, &m, 127) != 0)
+    {
+        return -1;
+    }
+    int resultat = saveMasquePBM(&m, nomImage);
+    masqueLiberer(&m);
+    return resultat;
+}
+
+int ouvrirFluxPGM(struct fluxPGM *f, const char *nomImage)
+{
+    f->fd = open(nomImage, O_RDONLY);
+    if (f->fd < 0)
+    {
+        printf("--> %s not found \n", nomImage);
+        return -1;
+    }
+
+    // L'en-tête tient dans le début du fichier, sauf commentaires démesurés
+    unsigned char enTete[PGM_EN_TETE];
+    ssize_t lu = pread(f->fd, enTete, sizeof(enTete), 0);
+    size_t debut = lu > 0 ? parsePGMHeader(enTete, (size_t)lu, &f->width, &f->height, &f->vmax) : 0;
+    if (debut == 0)
+    {
+        printf("Unknown format\n");
+        close(f->fd);
+        return -1;
+    }
+    if (verifierEnTete(nomImage, f->width, f->height, f->vmax) != 0)
+    {
+        close(f->fd);
+        return -1;
+    }
+    f->debut = debut;
+    f->lignes = -1;
+    return 0;
+}
+
+int lireRegionPGM(struct fluxPGM *f, struct imageNB *img, int x0, int y0, int x1, int y1)
+{
+    if (x0 < 0 || y0 < 0 || x1 > f->width || y1 > f->height || x1 <= x0 || y1 <= y0)
+    {
+        printf("Invalid parameters for lireRegionPGM\n");
+        return -1;
+    }
+    if (reallocImage(img, x1 - x0, y1 - y0) != 0)
+    {
+        return -1;
+    }
+    img->vmax = f->vmax;
+
+    int largeur = x1 - x0;
+    struct traceZone zone;
+    traceOuvrir(&zone, largeur == f->width ? "read strip" : "read region");
+
+    // Lignes entières : une lecture vectorisée par lot de lignes, directement dans les lignes
+    // de l'image ; sinon une lecture par ligne, limitée aux colonnes voulues
+    int lot = largeur == f->width ? PGM_LOT : 1;
+    struct iovec iov[PGM_LOT];
+    for (int y = 0; y < y1 - y0; y += lot)
+    {
+        int nb = y1 - y0 - y < lot ? y1 - y0 - y : lot;
+        for (int k = 0; k < nb; k++)
+        {
+            iov[k].iov_base = imageRow(img, y + k);
+            iov[k].iov_len = (size_t)largeur;
+        }
+        off_t position = (off_t)(f->debut + (size_t)(y0 + y) * f->width + x0);
+        if (lireTout(f->fd, iov, nb, position) != 0)
+        {
+            printf("Truncated PGM file\n");
+            traceFermer(&zone);
+            return -1;
+        }
+    }
+    traceOctets((size_t)(y1 - y0) * largeur, 0);
+    traceFermer(&zone);
+    return 0;
+}
+
+int lireBandePGM(struct fluxPGM *f, struct imageNB *img, int y0, int y1)
+{
+    return lireRegionPGM(f, img, 0, y0, f->width, y1);
+}
+
+int creerFluxPGM(struct fluxPGM *f, const char *nomImage, int width, int height)
+{
+    f->fd = open(nomImage, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (f->fd < 0)
+    {
+        printf("Unable to create file: %s \n", nomImage);
+        return -1;
+    }
+
+    char enTete[64];
+    int tailleEnTete = snprintf(enTete, sizeof(enTete), "P5\n%d %d\n255\n", width, height);
+    struct iovec iov = {enTete, (size_t)tailleEnTete};
+    if (ecrireTout(f->fd, &iov, 1) != 0)
+    {
+        printf("Unable to write file: %s \n", nomImage);
+        close(f->fd);
+        return -1;
+    }
+    f->width = width;
+    f->height = height;
+    f->vmax = 255;
+    f->debut = (size_t)tailleEnTete;
+    f->lignes = 0;
+    return 0;
+}
+
+int ecrireBandePGM(struct fluxPGM *f, const struct imageNB *img, int y0, int y1)
+{
+    if (img->width != f->width || y0 < 0 || y1 > img->height || f->lignes + y1 - y0 > f->height)
+    {
+        printf("Invalid parameters for ecrireBandePGM\n");
+        return -1;
+    }
+
+    struct traceZone zone;
+    traceOuvrir(&zone, "write strip");
+
+    struct iovec iov[PGM_LOT];
+    for (int y = y0; y < y1; y += PGM_LOT)
+    {
+        int nb = y1 - y < PGM_LOT ? y1 - y : PGM_LOT;
+        for (int k = 0; k < nb; k++)
+        {
+            iov[k].iov_base = imageRow(img, y + k);
+            iov[k].iov_len = (size_t)img->width;
+        }
+        if (ecrireTout(f->fd, iov, nb) != 0)
+        {
+            printf("Unable to write file\n");
+            traceFermer(&zone);
+            return -1;
+        }
+    }
+    f->lignes += y1 - y0;
+    traceOctets(0, (size_t)(y1 - y0) * f->width);
+    traceFermer(&zone);
+    return 0;
+}
+
+int fermerFluxPGM(struct fluxPGM *f)
+{
+    int resultat = 0;
+    if (f->lignes >= 0 && f->lignes != f->height)
+    {
+        printf("Incomplete PGM file: %d of %d rows written\n", f->lignes, f->height);
+        resultat = -1;
+    }
+    if (close(f->fd) != 0)
+    {
+        resultat = -1;
+    }
+    f->fd = -1;
+    return resultat;
+}
+
+const struct pgmStats *pgmLoadStats(void)
+{
+    return &statsLecture;
+}
+
+const struct pgmStats *pgmSaveStats(void)
+{
+    return &statsEcriture;
+}
+
+void pgmSetVerbose(int actif)
+{
+    verbose = actif;
+}
@@ -0,0 +1,177 @@
+#ifndef _PGM_H_
+#define _PGM_H_
+
+#include <stddef.h>
+
+#include "image.h"
+#include "masque.h"
+
+/**
+ * Statistiques de la dernière lecture / écriture d'un fichier .pgm
+ */
+struct pgmStats
+{
+    size_t octets;
+    double secondes;
+    int mmap;
+};
+
+/**
+ * Fichier .pgm (P5) lu ou écrit par bandes de lignes, sans jamais charger toute l'image
+ */
+struct fluxPGM
+{
+    int fd;
+    int width;
+    int height;
+    int vmax;
+    size_t debut; // position du premier pixel dans le fichier
+    int lignes;   // lignes déjà écrites
+};
+
+/**
+ * Fonction pour charger une image au format .pgm (P5)
+ * Le fichier est projeté en mémoire (mmap) quand c'est possible, sinon lu par gros blocs.
+ * @param img
+ * @param nomImage
+ * @return 0 si le chargement a réussi, -1 sinon
+ */
+int loadPGM(struct imageNB *img, char *nomImage);
+
+/**
+ * Fonction pour enregistrer une image au format .pgm (P5)
+ * L'en-tête et toutes les lignes sont écrits avec des écritures vectorisées (writev).
+ * @param img
+ * @param nomImage
+ * @return 0 si l'enregistrement a réussi, -1 sinon
+ */
+int savePGM(struct imageNB *img, char *nomImage);
+
+/**
+ * Fonction pour enregistrer un masque au format .pbm (P4), huit pixels par octet
+ * Les bits de chaque ligne sont retournés (le format commence par le bit de poids fort) et
+ * inversés (1 y est noir) : le fichier s'affiche comme le seuillage 8 bits.
+ * @param m
+ * @param nomImage
+ * @return 0 si l'enregistrement a réussi, -1 sinon
+ */
+int saveMasquePBM(const struct masque *m, char *nomImage);
+
+/**
+ * Fonction qui indique si un nom de fichier désigne un masque .pbm
+ * @param nomImage
+ * @return 1 si le nom se termine par .pbm, 0 sinon
+ */
+int estNomPBM(const char *nomImage);
+
+/**
+ * Fonction pour charger une image selon l'extension du nom : .imt est une image dallée (voir
+ * loadDallage), tout autre nom passe par loadPGM
+ * @param img
+ * @param nomImage
+ * @return 0 si le chargement a réussi, -1 sinon
+ */
+int loadImage(struct imageNB *img, char *nomImage);
+
+/**
+ * Fonction pour enregistrer une image selon l'extension du nom : .pbm enregistre le masque
+ * des pixels supérieurs à 127 (voir saveMasquePBM), .imt une image dallée (voir saveDallage),
+ * tout autre nom passe par savePGM
+ * @param img
+ * @param nomImage
+ * @return 0 si l'enregistrement a réussi, -1 sinon
+ */
+int saveImage(struct imageNB *img, char *nomImage);
+
+/**
+ * Fonction qui lit l'en-tête d'un fichier .pgm (P5)
+ * Gère les commentaires et s'arrête après l'unique blanc qui précède les pixels.
+ * @param buffer
+ * @param taille
+ * @param width
+ * @param height
+ * @param vmax
+ * @return la position du premier pixel, ou 0 si l'en-tête est invalide
+ */
+size_t parsePGMHeader(const unsigned char *buffer, size_t taille, int *width, int *height, int *vmax);
+
+/**
+ * Fonction qui ouvre un fichier .pgm (P5) pour le lire par bandes
+ * Seul l'en-tête est lu.
+ * @param f
+ * @param nomImage
+ * @return 0 si l'ouverture a réussi, -1 sinon
+ */
+int ouvrirFluxPGM(struct fluxPGM *f, const char *nomImage);
+
+/**
+ * Fonction qui lit les lignes [y0, y1[ du fichier dans img, redimensionnée à width x (y1 - y0)
+ * @param f
+ * @param img image initialisée
+ * @param y0
+ * @param y1
+ * @return 0 si la lecture a réussi, -1 sinon
+ */
+int lireBandePGM(struct fluxPGM *f, struct imageNB *img, int y0, int y1);
+
+/**
+ * Fonction qui lit le rectangle [x0, x1[ x [y0, y1[ du fichier dans img, redimensionnée à
+ * (x1 - x0) x (y1 - y0) ; seuls les octets du rectangle sont lus
+ * @param f
+ * @param img image initialisée
+ * @param x0
+ * @param y0
+ * @param x1
+ * @param y1
+ * @return 0 si la lecture a réussi, -1 sinon
+ */
+int lireRegionPGM(struct fluxPGM *f, struct imageNB *img, int x0, int y0, int x1, int y1);
+
+/**
+ * Fonction qui crée un fichier .pgm (P5) de width x height pixels et écrit son en-tête
+ * Les lignes sont ensuite ajoutées dans l'ordre avec ecrireBandePGM.
+ * @param f
+ * @param nomImage
+ * @param width
+ * @param height
+ * @return 0 si la création a réussi, -1 sinon
+ */
+int creerFluxPGM(struct fluxPGM *f, const char *nomImage, int width, int height);
+
+/**
+ * Fonction qui ajoute les lignes [y0, y1[ de img à la fin du fichier
+ * @param f
+ * @param img
+ * @param y0
+ * @param y1
+ * @return 0 si l'écriture a réussi, -1 sinon
+ */
+int ecrireBandePGM(struct fluxPGM *f, const struct imageNB *img, int y0, int y1);
+
+/**
+ * Fonction qui ferme un fichier ouvert par ouvrirFluxPGM ou creerFluxPGM
+ * En écriture, vérifie que toutes les lignes annoncées ont été écrites.
+ * @param f
+ * @return 0 si la fermeture a réussi, -1 sinon
+ */
+int fermerFluxPGM(struct fluxPGM *f);
+
+/**
+ * Fonction qui renvoie les statistiques du dernier chargement fait par le thread appelant
+ * @return
+ */
+const struct pgmStats *pgmLoadStats(void);
+
+/**
+ * Fonction qui renvoie les statistiques du dernier enregistrement fait par le thread appelant
+ * @return
+ */
+const struct pgmStats *pgmSaveStats(void);
+
+/**
+ * Active ou désactive l'affichage du débit après chaque lecture / écriture
+ * @param actif
+ */
+void pgmSetVerbose(int actif);
+
+#endif
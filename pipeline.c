@@ -0,0 +1,1123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+
+#include "pipeline.h"
+#include "pgm.h"
+#include "dallage.h"
+#include "operations.h"
+#include "contours.h"
+#include "flou.h"
+#include "affine.h"
+#include "geometrie.h"
+#include "integrale.h"
+#include "convolution.h"
+#include "median.h"
+#include "morphologie.h"
+#include "seuil.h"
+#include "echelle.h"
+#include "histo.h"
+#include "trace.h"
+#include "cache.h"
+#include "reserve.h"
+
+static int opSobel(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    return sobelGradient(img, dest, NULL, (nbArgs > 0 && args[0] == 2) ? NORME_L2 : NORME_L1);
+}
+
+static int opDirection(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    if (sobelGradient(img, NULL, dest, NORME_L1) != 0)
+    {
+        return -1;
+    }
+
+    // Codes 0..3 étalés sur 0, 64, 128, 192 pour être visibles
+    struct lut l;
+    lutIdentite(&l);
+    for (int i = 0; i < 256; i++)
+    {
+        l.table[i] = (unsigned char)(i < 4 ? i * 64 : 255);
+    }
+    return appliquerLUT(dest, dest, &l);
+}
+
+static int opTranslation(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    return translater(img, dest, (int)args[0], nbArgs > 1 ? (int)args[1] : 0);
+}
+
+static int opRetourner(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int sens = nbArgs > 0 ? (int)args[0] : 0;
+    return retourner(img, dest, sens != 1, sens != 0);
+}
+
+static int opTransposer(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    return transposer(img, dest);
+}
+
+static int opNettete(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    return convoluerPredefini(img, dest, NOYAU_NETTETE);
+}
+
+static int opRelief(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    return convoluerPredefini(img, dest, NOYAU_RELIEF);
+}
+
+static int opLaplacien(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    return convoluerPredefini(img, dest, NOYAU_LAPLACIEN);
+}
+
+static int opLisser(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int taille = nbArgs > 0 ? (int)args[0] : 3;
+    if (taille != 3 && taille != 5)
+    {
+        printf("Invalid parameters for lisser\n");
+        return -1;
+    }
+    return convoluerPredefini(img, dest, taille == 3 ? NOYAU_GAUSSIEN_3 : NOYAU_GAUSSIEN_5);
+}
+
+static int opNoyau(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    // decalage suivi des coefficients d'un noyau carré de côté impair
+    struct noyau k = {0};
+    int nb = nbArgs - 1;
+    k.largeur = 1;
+    while (k.largeur * k.largeur < nb)
+    {
+        k.largeur += 2;
+    }
+    // Le côté est limité à CONVOLUTION_TAILLE_MAX (rayon dans la bordure de l'image)
+    if (k.largeur * k.largeur != nb || k.largeur > CONVOLUTION_TAILLE_MAX)
+    {
+        printf("Invalid parameters for noyau (odd square kernel, at most %dx%d)\n", CONVOLUTION_TAILLE_MAX,
+               CONVOLUTION_TAILLE_MAX);
+        return -1;
+    }
+    k.hauteur = k.largeur;
+    k.decalage = (int)args[0];
+    for (int i = 0; i < nb; i++)
+    {
+        k.coefs[i] = (int)args[i + 1];
+    }
+    return convoluer(img, dest, &k);
+}
+
+/**
+ * Applique un noyau réel normalisé (somme des coefficients à 1) de côté 2 rayon + 1 dont le
+ * coefficient (dx, dy) est poids(dx, dy, parametres)
+ */
+static int appliquerEtalement(struct imageNB *img, struct imageNB *dest, int rayon,
+                              double (*poids)(double dx, double dy, const double *parametres),
+                              const double *parametres, int methode)
+{
+    int cote = 2 * rayon + 1;
+    if (rayon < 0 || cote > NOYAU_REEL_TAILLE_MAX || methode < METHODE_AUTO || methode > METHODE_FOURIER)
+    {
+        printf("Invalid parameters for convoluerReel\n");
+        return -1;
+    }
+    double *coefs = reservePrendre((size_t)cote * cote * sizeof(double));
+    if (coefs == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    double somme = 0;
+    for (int j = 0; j < cote; j++)
+    {
+        for (int i = 0; i < cote; i++)
+        {
+            coefs[j * cote + i] = poids(i - rayon, j - rayon, parametres);
+            somme += coefs[j * cote + i];
+        }
+    }
+    for (int i = 0; i < cote * cote; i++)
+    {
+        coefs[i] /= somme;
+    }
+    struct noyauReel k = {cote, cote, coefs, 0};
+    int resultat = convoluerReel(img, dest, &k, 0, (enum methodeConvolution)methode);
+    reserveRendre(coefs);
+    return resultat;
+}
+
+static double poidsDisque(double dx, double dy, const double *parametres)
+{
+    // Part approchée du pixel couverte par le disque
+    double couverture = parametres[0] + 0.5 - sqrt(dx * dx + dy * dy);
+    return couverture < 0 ? 0 : couverture > 1 ? 1 : couverture;
+}
+
+static double poidsBouge(double dx, double dy, const double *parametres)
+{
+    // Segment de longueur parametres[0] centré, d'angle parametres[1] (sens trigonométrique)
+    double c = cos(parametres[1] * M_PI / 180), s = sin(parametres[1] * M_PI / 180);
+    double le = dx * c - dy * s;
+    double travers = fabs(dx * s + dy * c);
+    double longueur = parametres[0] / 2 + 0.5 - fabs(le);
+    longueur = longueur < 0 ? 0 : longueur > 1 ? 1 : longueur;
+    return travers < 1 ? (1 - travers) * longueur : 0;
+}
+
+static int opDisque(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    if (args[0] <= 0)
+    {
+        printf("Invalid parameters for disque\n");
+        return -1;
+    }
+    return appliquerEtalement(img, dest, (int)ceil(args[0]), poidsDisque, args, nbArgs > 1 ? (int)args[1] : 0);
+}
+
+static int opBouge(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    if (args[0] < 1)
+    {
+        printf("Invalid parameters for bouge\n");
+        return -1;
+    }
+    double parametres[2] = {args[0], nbArgs > 1 ? args[1] : 0};
+    return appliquerEtalement(img, dest, (int)ceil(args[0] / 2), poidsBouge, parametres,
+                              nbArgs > 2 ? (int)args[2] : 0);
+}
+
+/**
+ * filtre : le noyau de l'étape, en convolution ou en corrélation (filtre adapté)
+ */
+static int appliquerFiltre(const struct etape *etape, struct imageNB *img, struct imageNB *dest)
+{
+    int correlation = etape->nbArgs > 0 ? (int)etape->args[0] : 0;
+    int methode = etape->nbArgs > 1 ? (int)etape->args[1] : METHODE_AUTO;
+    if ((correlation != 0 && correlation != 1) || methode < METHODE_AUTO || methode > METHODE_FOURIER)
+    {
+        printf("Invalid parameters for filtre\n");
+        return -1;
+    }
+    return convoluerReel(img, dest, &etape->noyau, correlation, (enum methodeConvolution)methode);
+}
+
+static int opMedian(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    return median(img, dest, nbArgs > 0 ? (int)args[0] : 1);
+}
+
+static int opOtsu(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    return seuillageOtsu(img, dest);
+}
+
+/**
+ * Rayon et paramètre de sauvola (k) ou d'adaptatif (c), avec leurs valeurs par défaut
+ */
+static void parametresSeuilLocal(const double *args, int nbArgs, int sauvola, int *rayon, double *parametre)
+{
+    *rayon = nbArgs > 0 ? (int)args[0] : 7;
+    *parametre = nbArgs > 1 ? args[1] : (sauvola ? SAUVOLA_K : 0);
+}
+
+static int opSauvola(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int rayon;
+    double k;
+    parametresSeuilLocal(args, nbArgs, 1, &rayon, &k);
+    return seuillageLocal(img, dest, SEUIL_SAUVOLA, rayon, k);
+}
+
+static int opAdaptatif(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int rayon;
+    double c;
+    parametresSeuilLocal(args, nbArgs, 0, &rayon, &c);
+    return seuillageLocal(img, dest, SEUIL_MOYENNE, rayon, c);
+}
+
+/**
+ * Rayons horizontal et vertical d'une opération morphologique (1 par défaut, le vertical
+ * égal à l'horizontal s'il est omis)
+ */
+static void rayonsMorphologie(const double *args, int nbArgs, int *rayonX, int *rayonY)
+{
+    *rayonX = nbArgs > 0 ? (int)args[0] : 1;
+    *rayonY = nbArgs > 1 ? (int)args[1] : *rayonX;
+}
+
+static int opEroder(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int rx, ry;
+    rayonsMorphologie(args, nbArgs, &rx, &ry);
+    return eroder(img, dest, rx, ry);
+}
+
+static int opDilater(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int rx, ry;
+    rayonsMorphologie(args, nbArgs, &rx, &ry);
+    return dilater(img, dest, rx, ry);
+}
+
+static int opOuvrir(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int rx, ry;
+    rayonsMorphologie(args, nbArgs, &rx, &ry);
+    return ouvrir(img, dest, rx, ry);
+}
+
+static int opFermer(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int rx, ry;
+    rayonsMorphologie(args, nbArgs, &rx, &ry);
+    return fermer(img, dest, rx, ry);
+}
+
+static int opSeuillage(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return seuillage(img, dest, (int)args[0]);
+}
+
+static int opRedimensionner(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    enum filtreEchelle filtre = nbArgs > 2 ? (enum filtreEchelle)args[2] : ECHELLE_AUTO;
+    return redimensionnerImage(img, dest, (int)args[0], (int)args[1], filtre);
+}
+
+static int opEchelle(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    enum filtreEchelle filtre = nbArgs > 1 ? (enum filtreEchelle)args[1] : ECHELLE_AUTO;
+    int largeur = (int)lround(img->width * args[0]);
+    int hauteur = (int)lround(img->height * args[0]);
+    return redimensionnerImage(img, dest, largeur > 0 ? largeur : 1, hauteur > 0 ? hauteur : 1, filtre);
+}
+
+static int opVignette(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return vignette(img, dest, (int)args[0]);
+}
+
+static int opRecadrer(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return vueImage(img, dest, (int)args[0], (int)args[1], (int)args[2], (int)args[3]);
+}
+
+static int opHistogramme(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    if (nbArgs < 2)
+    {
+        return histogramme(img, dest);
+    }
+    struct histo h;
+    if (calculerHistogramme(img, &h) != 0)
+    {
+        return -1;
+    }
+    return dessinerHistogramme(&h, dest, (int)args[0], (int)args[1]);
+}
+
+static int opStatistiques(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    struct histo h;
+    if (calculerHistogramme(img, &h) != 0)
+    {
+        return -1;
+    }
+    printf("Mean = %.2f, Stddev = %.2f, Min = %d, P1 = %d, Median = %d, P99 = %d, Max = %d\n", histoMoyenne(&h),
+           sqrt(histoVariance(&h)), histoCentile(&h, 0), histoCentile(&h, 1), histoCentile(&h, 50),
+           histoCentile(&h, 99), histoCentile(&h, 100));
+    if (dest != img)
+    {
+        copyImage(img, dest);
+        return dest->data != NULL ? 0 : -1;
+    }
+    return 0;
+}
+
+static int opEgaliser(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    return egaliserHistogramme(img, dest);
+}
+
+static int opClahe(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    int tuilesX = nbArgs > 0 ? (int)args[0] : 8;
+    int tuilesY = nbArgs > 1 ? (int)args[1] : tuilesX;
+    return clahe(img, dest, tuilesX, tuilesY, nbArgs > 2 ? args[2] : 2.0);
+}
+
+static int opContraste(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return contraste(img, dest, (int)args[0]);
+}
+
+static int opLuminosite(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return luminosite(img, dest, (int)args[0]);
+}
+
+static int opFlouter(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    return flouBoite(img, dest, nbArgs > 0 ? (int)args[0] : 1);
+}
+
+static int opGaussien(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return flouGaussien(img, dest, args[0]);
+}
+
+static int opPivoter(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    if (nbArgs < 3)
+    {
+        return pivoter(img, dest, (float)args[0], nbArgs > 1 ? args[1] != 0 : true);
+    }
+    struct affine t;
+    affineIdentite(&t);
+    affineRotation(&t, args[1] != 0 ? args[0] : -args[0]);
+    return transformerAffine(img, dest, &t, (enum interpolation)args[2], CADRE_ENGLOBANT);
+}
+
+static int opAffine(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    struct affine t = {{args[0], args[1], args[2], args[3], args[4], args[5]}};
+    enum interpolation interp = nbArgs > 6 ? (enum interpolation)args[6] : INTERP_BILINEAIRE;
+    enum cadre cadre = (nbArgs > 7 && args[7] != 0) ? CADRE_SOURCE : CADRE_ENGLOBANT;
+    return transformerAffine(img, dest, &t, interp, cadre);
+}
+
+static int opNegatif(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    return negatif(img, dest);
+}
+
+static int opPixeliser(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    return pixeliserBlocs(img, dest, (int)args[0], nbArgs > 1 ? (int)args[1] : (int)args[0]);
+}
+
+static int opBlocs(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    return moyenneBlocs(img, dest, (int)args[0], nbArgs > 1 ? (int)args[1] : (int)args[0]);
+}
+
+static void lutOpAjouter(struct lut *l, const double *args, int nbArgs, int vmax)
+{
+    (void)nbArgs;
+    (void)vmax;
+    lutAjouter(l, (int)args[0]);
+}
+
+static void lutOpSeuillage(struct lut *l, const double *args, int nbArgs, int vmax)
+{
+    (void)nbArgs;
+    (void)vmax;
+    lutSeuillage(l, (int)args[0]);
+}
+
+static void lutOpNegatif(struct lut *l, const double *args, int nbArgs, int vmax)
+{
+    (void)args;
+    (void)nbArgs;
+    lutNegatif(l, vmax);
+}
+
+static void lutOpGamma(struct lut *l, const double *args, int nbArgs, int vmax)
+{
+    (void)nbArgs;
+    lutGamma(l, args[0], vmax);
+}
+
+static void lutOpCourbe(struct lut *l, const double *args, int nbArgs, int vmax)
+{
+    (void)vmax;
+    lutCourbe(l, args, nbArgs / 2);
+}
+
+static int opGamma(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    struct lut l;
+    lutIdentite(&l);
+    lutOpGamma(&l, args, nbArgs, img->vmax);
+    return appliquerLUT(img, dest, &l);
+}
+
+static int opCourbe(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs)
+{
+    struct lut l;
+    lutIdentite(&l);
+    lutOpCourbe(&l, args, nbArgs, img->vmax);
+    return appliquerLUT(img, dest, &l);
+}
+
+static int haloUn(const double *args, int nbArgs)
+{
+    (void)args;
+    (void)nbArgs;
+    return 1;
+}
+
+static int haloLisser(const double *args, int nbArgs)
+{
+    return nbArgs > 0 && (int)args[0] == 5 ? 2 : 1;
+}
+
+static int haloNoyau(const double *args, int nbArgs)
+{
+    (void)args;
+    int cote = 1;
+    while (cote * cote < nbArgs - 1)
+    {
+        cote += 2;
+    }
+    return cote / 2;
+}
+
+static int haloDisque(const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return (int)ceil(args[0]);
+}
+
+static int haloBouge(const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return (int)ceil(args[0] / 2);
+}
+
+static int haloMedian(const double *args, int nbArgs)
+{
+    return nbArgs > 0 ? (int)args[0] : 1;
+}
+
+static int haloSauvola(const double *args, int nbArgs)
+{
+    return nbArgs > 0 ? (int)args[0] : 7;
+}
+
+static int haloAdaptatif(const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    return (int)args[0];
+}
+
+static int haloMorphologie(const double *args, int nbArgs)
+{
+    int rx, ry;
+    rayonsMorphologie(args, nbArgs, &rx, &ry);
+    return ry;
+}
+
+static int haloMorphologieDouble(const double *args, int nbArgs)
+{
+    return 2 * haloMorphologie(args, nbArgs);
+}
+
+static int haloTranslation(const double *args, int nbArgs)
+{
+    // Un décalage vertical fait revenir les lignes du bas en haut : toute l'image est nécessaire
+    return nbArgs > 1 && (int)args[1] != 0 ? -1 : 0;
+}
+
+static int haloRetourner(const double *args, int nbArgs)
+{
+    return nbArgs > 0 && (int)args[0] != 0 ? -1 : 0;
+}
+
+static int haloFlouter(const double *args, int nbArgs)
+{
+    return nbArgs > 0 ? (int)args[0] : 1;
+}
+
+static int haloGaussien(const double *args, int nbArgs)
+{
+    (void)nbArgs;
+    int rayons[FLOU_PASSES_GAUSS];
+    // Un sigma trop grand est refusé par flouGaussien ; le halo reste calculable
+    rayonsGaussiens(fmin(args[0], FLOU_RAYON_MAX), FLOU_PASSES_GAUSS, rayons);
+    int somme = 0;
+    for (int i = 0; i < FLOU_PASSES_GAUSS; i++)
+    {
+        somme += rayons[i];
+    }
+    return somme;
+}
+
+static const struct operation operations[] = {
+    {"sobel", 0, 1, 0, opSobel, "sobel[:norme(1|2)]", NULL, haloUn},
+    {"direction", 0, 0, 0, opDirection, "direction", NULL, haloUn},
+    {"translation", 1, 2, 0, opTranslation, "translation:dx[,dy]", NULL, haloTranslation},
+    {"retourner", 0, 1, 0, opRetourner, "retourner[:sens(0 horizontal|1 vertical|2 les deux)]", NULL, haloRetourner},
+    {"transposer", 0, 0, 0, opTransposer, "transposer", NULL, NULL},
+    {"seuillage", 1, 1, 1, opSeuillage, "seuillage:seuil", lutOpSeuillage, NULL},
+    {"otsu", 0, 0, 1, opOtsu, "otsu (seuil automatique)", NULL, NULL},
+    {"sauvola", 0, 2, 0, opSauvola, "sauvola[:rayon[,k]] (seuil local, moyenne et ecart-type)", NULL, haloSauvola},
+    {"adaptatif", 1, 2, 0, opAdaptatif, "adaptatif:rayon[,c] (seuil local : moyenne - c)", NULL, haloAdaptatif},
+    {"redimensionner", 2, 3, 0, opRedimensionner, "redimensionner:largeur,hauteur[,filtre(0 auto|1 moyenne|2 bilineaire|3 lanczos)]", NULL, NULL},
+    {"echelle", 1, 2, 0, opEchelle, "echelle:facteur[,filtre]", NULL, NULL},
+    {"vignette", 1, 1, 0, opVignette, "vignette:cote", NULL, NULL},
+    {"recadrer", 4, 4, 0, opRecadrer, "recadrer:x,y,largeur,hauteur (vue, sans copie)", NULL, NULL},
+    {"histogramme", 0, 2, 0, opHistogramme, "histogramme[:largeur,hauteur]", NULL, NULL},
+    {"statistiques", 0, 0, 1, opStatistiques, "statistiques (affiche moyenne, ecart-type, centiles)", NULL, NULL},
+    {"egaliser", 0, 0, 1, opEgaliser, "egaliser", NULL, NULL},
+    {"clahe", 0, 3, 0, opClahe, "clahe[:tuilesX[,tuilesY[,limite]]]", NULL, NULL},
+    {"contraste", 1, 1, 1, opContraste, "contraste:valeur", lutOpAjouter, NULL},
+    {"luminosite", 1, 1, 1, opLuminosite, "luminosite:valeur", lutOpAjouter, NULL},
+    {"flouter", 0, 1, 0, opFlouter, "flouter[:rayon] (jusqu'a 127)", NULL, haloFlouter},
+    {"gaussien", 1, 1, 0, opGaussien, "gaussien:sigma (jusqu'a 127)", NULL, haloGaussien},
+    {"lisser", 0, 1, 0, opLisser, "lisser[:taille(3|5)] (gaussien binomial)", NULL, haloLisser},
+    {"nettete", 0, 0, 0, opNettete, "nettete", NULL, haloUn},
+    {"relief", 0, 0, 0, opRelief, "relief", NULL, haloUn},
+    {"laplacien", 0, 0, 0, opLaplacien, "laplacien", NULL, haloUn},
+    {"noyau", 2, PIPELINE_MAX_ARGS, 0, opNoyau, "noyau:decalage,c1[,...,cN] (carre impair, jusqu'a 15x15)", NULL, haloNoyau},
+    {"disque", 1, 2, 0, opDisque, "disque:rayon[,methode(0 auto|1 directe|2 fourier)] (flou de mise au point)", NULL, haloDisque},
+    {"bouge", 1, 3, 0, opBouge, "bouge:longueur[,angle[,methode]] (flou de bouge)", NULL, haloBouge},
+    {"filtre", 0, 2, 0, NULL, "filtre:fichier[,correlation(0|1)[,methode(0 auto|1 directe|2 fourier)]] (noyau .pgm ou texte)", NULL, NULL},
+    {"median", 0, 1, 0, opMedian, "median[:rayon]", NULL, haloMedian},
+    {"eroder", 0, 2, 0, opEroder, "eroder[:rayon[,rayonY]] (minimum)", NULL, haloMorphologie},
+    {"dilater", 0, 2, 0, opDilater, "dilater[:rayon[,rayonY]] (maximum)", NULL, haloMorphologie},
+    {"ouvrir", 0, 2, 0, opOuvrir, "ouvrir[:rayon[,rayonY]] (erosion puis dilatation)", NULL, haloMorphologieDouble},
+    {"fermer", 0, 2, 0, opFermer, "fermer[:rayon[,rayonY]] (dilatation puis erosion)", NULL, haloMorphologieDouble},
+    {"pivoter", 1, 3, 0, opPivoter, "pivoter:angle[,horaire(1|0)[,interpolation(0|1|2)]]", NULL, NULL},
+    {"affine", 6, 8, 0, opAffine, "affine:a,b,tx,c,d,ty[,interpolation(0|1|2)[,cadre source(1|0)]]", NULL, NULL},
+    {"negatif", 0, 0, 1, opNegatif, "negatif", lutOpNegatif, NULL},
+    {"pixeliser", 1, 2, 1, opPixeliser, "pixeliser:largeur[,hauteur]", NULL, NULL},
+    {"blocs", 1, 2, 0, opBlocs, "blocs:largeur[,hauteur] (moyenne de chaque bloc)", NULL, NULL},
+    {"gamma", 1, 1, 1, opGamma, "gamma:g", lutOpGamma, NULL},
+    {"courbe", 2, PIPELINE_MAX_ARGS, 1, opCourbe, "courbe:x0,y0,x1,y1,...", lutOpCourbe, NULL},
+};
+
+#define NB_OPERATIONS (int)(sizeof(operations) / sizeof(operations[0]))
+
+const struct operation *trouverOperation(const char *nom)
+{
+    for (int i = 0; i < NB_OPERATIONS; i++)
+    {
+        if (strcmp(operations[i].nom, nom) == 0)
+        {
+            return &operations[i];
+        }
+    }
+    return NULL;
+}
+
+void afficherOperations(FILE *sortie)
+{
+    for (int i = 0; i < NB_OPERATIONS; i++)
+    {
+        fprintf(sortie, "  %s\n", operations[i].aide);
+    }
+}
+
+/**
+ * Paramètres numériques d'une étape, séparés par des virgules après ':'
+ */
+static int lireParametres(struct etape *etape, const char *nom, const char *texte, const char *pos)
+{
+    while (*pos == ':' || *pos == ',')
+    {
+        pos++;
+        char *fin;
+        double valeur = strtod(pos, &fin);
+        if (fin == pos)
+        {
+            printf("Invalid parameter in pipeline step: %s\n", texte);
+            return -1;
+        }
+        if (etape->nbArgs >= PIPELINE_MAX_ARGS)
+        {
+            printf("Too many parameters for %s (max %d)\n", nom, PIPELINE_MAX_ARGS);
+            return -1;
+        }
+        etape->args[etape->nbArgs++] = valeur;
+        pos = fin;
+    }
+    if (*pos != '\0')
+    {
+        printf("Invalid parameter in pipeline step: %s\n", texte);
+        return -1;
+    }
+
+    if (etape->nbArgs < etape->op->minArgs || etape->nbArgs > etape->op->maxArgs)
+    {
+        printf("Wrong number of parameters for %s (usage: %s)\n", nom, etape->op->aide);
+        return -1;
+    }
+    if (etape->op->compilerLUT == lutOpCourbe && etape->nbArgs % 2 != 0)
+    {
+        printf("courbe expects x,y pairs (usage: %s)\n", etape->op->aide);
+        return -1;
+    }
+    return 0;
+}
+
+int pipelineAjouter(struct pipeline *p, const char *texte)
+{
+    if (p->nbEtapes >= PIPELINE_MAX_ETAPES)
+    {
+        printf("Too many pipeline steps (max %d)\n", PIPELINE_MAX_ETAPES);
+        return -1;
+    }
+
+    char nom[64];
+    size_t longueur = strcspn(texte, ":");
+    if (longueur == 0 || longueur >= sizeof(nom))
+    {
+        printf("Invalid pipeline step: %s\n", texte);
+        return -1;
+    }
+    memcpy(nom, texte, longueur);
+    nom[longueur] = '\0';
+
+    struct etape *etape = &p->etapes[p->nbEtapes];
+    etape->op = trouverOperation(nom);
+    etape->nbArgs = 0;
+    etape->noyau.coefs = NULL;
+    if (etape->op == NULL)
+    {
+        printf("Unknown operation: %s\n", nom);
+        return -1;
+    }
+
+    // filtre : le noyau est chargé une fois pour toutes, son fichier précède les paramètres
+    const char *pos = texte + longueur;
+    if (etape->op->executer == NULL)
+    {
+        char fichier[1024];
+        size_t n = *pos == ':' ? strcspn(pos + 1, ",") : 0;
+        if (n == 0 || n >= sizeof(fichier))
+        {
+            printf("Wrong number of parameters for %s (usage: %s)\n", nom, etape->op->aide);
+            return -1;
+        }
+        memcpy(fichier, pos + 1, n);
+        fichier[n] = '\0';
+        if (chargerNoyauReel(fichier, &etape->noyau) != 0)
+        {
+            return -1;
+        }
+        pos += 1 + n;
+    }
+    if (lireParametres(etape, nom, texte, pos) != 0)
+    {
+        libererNoyauReel(&etape->noyau);
+        return -1;
+    }
+    p->nbEtapes++;
+    return 0;
+}
+
+int pipelineCharger(struct pipeline *p, const char *nomFichier)
+{
+    FILE *fichier = fopen(nomFichier, "r");
+    if (fichier == NULL)
+    {
+        printf("--> %s not found \n", nomFichier);
+        return -1;
+    }
+
+    // Une ligne contient au moins une étape entière, noyau 15x15 compris
+    char ligne[8192];
+    int resultat = 0;
+    while (resultat == 0 && fgets(ligne, sizeof(ligne), fichier) != NULL)
+    {
+        if (strchr(ligne, '\n') == NULL && !feof(fichier))
+        {
+            printf("Line too long in %s\n", nomFichier);
+            resultat = -1;
+            break;
+        }
+        // Ignore les commentaires
+        char *commentaire = strchr(ligne, '#');
+        if (commentaire != NULL)
+        {
+            *commentaire = '\0';
+        }
+
+        char *reste;
+        for (char *mot = strtok_r(ligne, " \t\r\n", &reste); mot != NULL && resultat == 0;
+             mot = strtok_r(NULL, " \t\r\n", &reste))
+        {
+            resultat = pipelineAjouter(p, mot);
+        }
+    }
+
+    fclose(fichier);
+    return resultat;
+}
+
+void pipelineLiberer(struct pipeline *p)
+{
+    for (int i = 0; i < p->nbEtapes; i++)
+    {
+        libererNoyauReel(&p->etapes[i].noyau);
+    }
+    p->nbEtapes = 0;
+}
+
+/**
+ * Exécute les nbEtapes premières étapes, sans passer par le cache
+ */
+static int executerEtapes(const struct pipeline *p, int nbEtapes, struct imageNB *img, struct imageNB *tampon)
+{
+    for (int i = 0; i < nbEtapes; i++)
+    {
+        const struct etape *etape = &p->etapes[i];
+
+        if (etape->op->compilerLUT != NULL)
+        {
+            // Compose toutes les étapes point à point qui se suivent, puis une seule passe
+            struct lut l;
+            lutIdentite(&l);
+            int j = i;
+            for (; j < nbEtapes && p->etapes[j].op->compilerLUT != NULL; j++)
+            {
+                p->etapes[j].op->compilerLUT(&l, p->etapes[j].args, p->etapes[j].nbArgs, img->vmax);
+            }
+            struct traceZone zone;
+            traceOuvrir(&zone, "lut");
+            int resultat = appliquerLUT(img, img, &l);
+            traceFermer(&zone);
+            if (resultat != 0)
+            {
+                printf("Pipeline steps %d-%d (point operations) failed\n", i + 1, j);
+                return -1;
+            }
+            i = j - 1;
+            continue;
+        }
+
+        struct traceZone zone;
+        traceOuvrir(&zone, etape->op->nom);
+        int resultat = etape->op->executer == NULL
+                           ? appliquerFiltre(etape, img, tampon)
+                           : etape->op->executer(img, etape->op->enPlace ? img : tampon, etape->args, etape->nbArgs);
+        traceFermer(&zone);
+        if (resultat != 0)
+        {
+            printf("Pipeline step %d (%s) failed\n", i + 1, etape->op->nom);
+            return -1;
+        }
+        if (etape->op->enPlace)
+        {
+            continue;
+        }
+
+        // Le résultat devient la source de l'étape suivante
+        struct imageNB tmp = *img;
+        *img = *tampon;
+        *tampon = tmp;
+    }
+    return 0;
+}
+
+/**
+ * Ajoute du texte à la suite des n premiers caractères de texte
+ * @return 0 si le texte tient dans le tampon, -1 sinon
+ */
+static int ajouterTexte(char *texte, size_t taille, size_t *n, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int ecrits = vsnprintf(texte + *n, taille - *n, format, args);
+    va_end(args);
+    if (ecrits < 0 || (size_t)ecrits >= taille - *n)
+    {
+        return -1;
+    }
+    *n += (size_t)ecrits;
+    return 0;
+}
+
+/**
+ * Recette du pipeline pour le cache : chaque étape et ses paramètres
+ * @return 0 si la recette tient dans le tampon et que le pipeline peut être mis en cache,
+ * -1 sinon (statistiques n'a d'effet qu'en dehors de l'image)
+ */
+static int recettePipeline(const struct pipeline *p, char *texte, size_t taille)
+{
+    size_t n = 0;
+    for (int i = 0; i < p->nbEtapes; i++)
+    {
+        const struct etape *etape = &p->etapes[i];
+        if (etape->op->executer == opStatistiques ||
+            ajouterTexte(texte, taille, &n, "%s%s", i > 0 ? " " : "", etape->op->nom) != 0)
+        {
+            return -1;
+        }
+        // Le noyau d'un filtre compte par son contenu, pas par le nom de son fichier
+        const struct noyauReel *k = &etape->noyau;
+        if (k->coefs != NULL &&
+            ajouterTexte(texte, taille, &n, "@%dx%d:%016llx", k->largeur, k->hauteur,
+                         (unsigned long long)empreinteCoefs(k->coefs, (size_t)k->largeur * k->hauteur)) != 0)
+        {
+            return -1;
+        }
+        for (int k = 0; k < etape->nbArgs; k++)
+        {
+            if (ajouterTexte(texte, taille, &n, "%c%.17g", k == 0 ? ':' : ',', etape->args[k]) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int pipelineExecuter(const struct pipeline *p, struct imageNB *img, struct imageNB *tampon)
+{
+    // Le résultat est cherché dans le cache d'après les pixels d'entrée et la recette
+    char recette[PIPELINE_RECETTE];
+    struct cleCache cle;
+    int enCache = p->nbEtapes > 0 && cacheActif() && recettePipeline(p, recette, sizeof(recette)) == 0;
+    if (enCache)
+    {
+        cacheCle(img, recette, &cle);
+        if (cacheChercher(&cle, img))
+        {
+            return 0;
+        }
+    }
+    if (executerEtapes(p, p->nbEtapes, img, tampon) != 0)
+    {
+        return -1;
+    }
+    if (enCache)
+    {
+        cacheAjouter(&cle, img);
+    }
+    return 0;
+}
+
+int pipelineExecuterMasque(const struct pipeline *p, struct imageNB *img, struct imageNB *tampon, struct masque *m)
+{
+    m->bits = NULL;
+    const struct etape *fin = p->nbEtapes > 0 ? &p->etapes[p->nbEtapes - 1] : NULL;
+    int (*executer)(struct imageNB *, struct imageNB *, const double *, int) = fin != NULL ? fin->op->executer : NULL;
+    int direct = executer == opSeuillage || executer == opOtsu || executer == opSauvola || executer == opAdaptatif;
+
+    // Avec le cache, l'image 8 bits du résultat est calculée (ou reprise) pour y rester
+    if (!direct || cacheActif())
+    {
+        if (pipelineExecuter(p, img, tampon) != 0)
+        {
+            return -1;
+        }
+        return masqueSeuil(img, m, 127);
+    }
+
+    if (executerEtapes(p, p->nbEtapes - 1, img, tampon) != 0)
+    {
+        return -1;
+    }
+    struct traceZone zone;
+    traceOuvrir(&zone, fin->op->nom);
+    int resultat;
+    if (executer == opSeuillage || executer == opOtsu)
+    {
+        int seuil = executer == opSeuillage ? (int)fin->args[0] : seuilOtsu(img);
+        resultat = seuil >= 0 ? masqueSeuil(img, m, seuil) : -1;
+    }
+    else
+    {
+        int rayon;
+        double parametre;
+        parametresSeuilLocal(fin->args, fin->nbArgs, executer == opSauvola, &rayon, &parametre);
+        resultat = masqueLocal(img, m, executer == opSauvola ? SEUIL_SAUVOLA : SEUIL_MOYENNE, rayon, parametre);
+    }
+    traceFermer(&zone);
+    if (resultat != 0)
+    {
+        printf("Pipeline step %d (%s) failed\n", p->nbEtapes, fin->op->nom);
+    }
+    return resultat;
+}
+
+/**
+ * Calcule le rayon du voisinage dont dépend chaque pixel de sortie d'une étape
+ * Le halo des opérations est vertical ; horizontalement, seules la morphologie (rayonX),
+ * la translation et le retournement diffèrent.
+ * @param etape
+ * @param horizontal 1 pour le voisinage horizontal, 0 pour le vertical
+ * @return le rayon, ou -1 si l'étape a besoin de toute l'image dans cette direction
+ */
+static int haloEtape(const struct etape *etape, int horizontal)
+{
+    const struct operation *op = etape->op;
+    const struct noyauReel *k = &etape->noyau;
+    if (op->compilerLUT != NULL)
+    {
+        return 0;
+    }
+    if (k->coefs != NULL)
+    {
+        return (horizontal ? k->largeur : k->hauteur) / 2;
+    }
+    if (op->halo == NULL)
+    {
+        return -1;
+    }
+    if (!horizontal)
+    {
+        return op->halo(etape->args, etape->nbArgs);
+    }
+
+    int rx, ry;
+    if (op->halo == haloMorphologie || op->halo == haloMorphologieDouble)
+    {
+        rayonsMorphologie(etape->args, etape->nbArgs, &rx, &ry);
+        return op->halo == haloMorphologie ? rx : 2 * rx;
+    }
+    if (op->halo == haloTranslation)
+    {
+        return (int)etape->args[0] != 0 ? -1 : 0;
+    }
+    if (op->halo == haloRetourner)
+    {
+        return etape->nbArgs == 0 || (int)etape->args[0] != 1 ? -1 : 0;
+    }
+    return op->halo(etape->args, etape->nbArgs);
+}
+
+int pipelineHalo(const struct pipeline *p)
+{
+    int halo = 0;
+    for (int i = 0; i < p->nbEtapes; i++)
+    {
+        int h = haloEtape(&p->etapes[i], 0);
+        if (h < 0)
+        {
+            return -1;
+        }
+        halo += h;
+    }
+    return halo;
+}
+
+int pipelineVoisinage(const struct pipeline *p, int *margeX, int *margeY)
+{
+    *margeX = 0;
+    *margeY = pipelineHalo(p);
+    for (int i = 0; i < p->nbEtapes && *margeY >= 0; i++)
+    {
+        int h = haloEtape(&p->etapes[i], 1);
+        if (h < 0)
+        {
+            return -1;
+        }
+        *margeX += h;
+    }
+    return *margeY >= 0 ? 0 : -1;
+}
+
+int pipelineExecuterBandes(const struct pipeline *p, const char *entree, const char *sortie, int lignesParBande)
+{
+    int halo = pipelineHalo(p);
+    if (halo < 0)
+    {
+        printf("This pipeline needs the whole image and cannot run in strips\n");
+        return -1;
+    }
+    if (estNomPBM(sortie) || estNomDallage(sortie))
+    {
+        printf("PBM and IMT output need the whole image and cannot be written in strips\n");
+        return -1;
+    }
+
+    // Une image dallée en entrée est lue bande par bande, dalles touchées seulement
+    struct fluxPGM lecture, ecriture;
+    struct dallage dallage;
+    int dalle = estNomDallage(entree);
+    if ((dalle ? ouvrirDallage(&dallage, entree) : ouvrirFluxPGM(&lecture, entree)) != 0)
+    {
+        return -1;
+    }
+    int width = dalle ? dallage.width : lecture.width;
+    int height = dalle ? dallage.height : lecture.height;
+    if (creerFluxPGM(&ecriture, sortie, width, height) != 0)
+    {
+        if (dalle)
+        {
+            fermerDallage(&dallage);
+        }
+        else
+        {
+            fermerFluxPGM(&lecture);
+        }
+        return -1;
+    }
+    if (lignesParBande <= 0)
+    {
+        lignesParBande = PIPELINE_OCTETS_BANDE / width;
+        lignesParBande = lignesParBande > 2 * halo ? lignesParBande : 2 * halo;
+        lignesParBande = lignesParBande > 1 ? lignesParBande : 1;
+    }
+
+    struct imageNB bande = {0};
+    struct imageNB tampon = {0};
+    int resultat = 0;
+    for (int y0 = 0; y0 < height && resultat == 0; y0 += lignesParBande)
+    {
+        int y1 = y0 + lignesParBande < height ? y0 + lignesParBande : height;
+        int haut = y0 - halo > 0 ? y0 - halo : 0;
+        int bas = y1 + halo < height ? y1 + halo : height;
+
+        resultat = dalle ? lireRegionDallage(&dallage, &bande, 0, haut, width, bas)
+                         : lireBandePGM(&lecture, &bande, haut, bas);
+        if (resultat == 0)
+        {
+            resultat = executerEtapes(p, p->nbEtapes, &bande, &tampon);
+        }
+        if (resultat == 0)
+        {
+            resultat = ecrireBandePGM(&ecriture, &bande, y0 - haut, y1 - haut);
+        }
+    }
+
+    freeImageMemory(&bande);
+    freeImageMemory(&tampon);
+    if (dalle)
+    {
+        fermerDallage(&dallage);
+    }
+    else
+    {
+        fermerFluxPGM(&lecture);
+    }
+    if (fermerFluxPGM(&ecriture) != 0)
+    {
+        resultat = -1;
+    }
+    return resultat;
+}
@@ -0,0 +1,169 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <stdio.h>
+
+#include "image.h"
+#include "lut.h"
+#include "convolution.h"
+#include "masque.h"
+
+/**
+ * Paramètres au plus par étape : le décalage et les coefficients d'un noyau de côté
+ * CONVOLUTION_TAILLE_MAX (voir l'opération noyau)
+ */
+#define PIPELINE_MAX_ARGS (1 + CONVOLUTION_TAILLE_MAX * CONVOLUTION_TAILLE_MAX)
+#define PIPELINE_MAX_ETAPES 64
+
+/**
+ * Longueur maximale de la recette (étapes et paramètres) d'un pipeline mis en cache
+ */
+#define PIPELINE_RECETTE 4096
+
+/**
+ * Taille visée d'une bande en mode flux, quand le nombre de lignes n'est pas imposé
+ */
+#define PIPELINE_OCTETS_BANDE (32 << 20)
+
+/**
+ * Description d'une opération utilisable dans un pipeline
+ * `executer` lit img et écrit dans dest ; si `enPlace` vaut 1, l'opération accepte dest == img.
+ * Les opérations point à point fournissent aussi `compilerLUT`, qui compose leur effet dans
+ * une table : le pipeline fusionne alors les étapes consécutives en une seule passe.
+ * `halo` renvoie le nombre de lignes voisines dont chaque ligne de sortie dépend, ou -1 si
+ * l'opération a besoin de toute l'image avec ces paramètres ; il vaut NULL pour les opérations
+ * qui ont toujours besoin de toute l'image (ou qui changent sa taille), qui ne peuvent donc
+ * pas être exécutées par bandes. Les opérations point à point n'en ont pas besoin.
+ * `executer` vaut NULL pour filtre, dont le noyau, lu dans un fichier, est porté par l'étape.
+ */
+struct operation
+{
+    const char *nom;
+    int minArgs;
+    int maxArgs;
+    int enPlace;
+    int (*executer)(struct imageNB *img, struct imageNB *dest, const double *args, int nbArgs);
+    const char *aide;
+    void (*compilerLUT)(struct lut *l, const double *args, int nbArgs, int vmax);
+    int (*halo)(const double *args, int nbArgs);
+};
+
+/**
+ * Une étape du pipeline : une opération et ses paramètres
+ */
+struct etape
+{
+    const struct operation *op;
+    double args[PIPELINE_MAX_ARGS];
+    int nbArgs;
+    struct noyauReel noyau; // filtre : noyau chargé à l'ajout de l'étape (coefs NULL sinon)
+};
+
+/**
+ * Liste ordonnée d'étapes
+ */
+struct pipeline
+{
+    struct etape etapes[PIPELINE_MAX_ETAPES];
+    int nbEtapes;
+};
+
+/**
+ * Fonction qui cherche une opération par son nom
+ * @param nom
+ * @return l'opération, ou NULL si elle n'existe pas
+ */
+const struct operation *trouverOperation(const char *nom);
+
+/**
+ * Fonction qui affiche la liste des opérations disponibles
+ * @param sortie
+ */
+void afficherOperations(FILE *sortie);
+
+/**
+ * Fonction qui ajoute une étape décrite par "nom[:arg1[,arg2...]]" (ex. "seuillage:128")
+ * Le premier paramètre de filtre est un nom de fichier, lu jusqu'à la virgule suivante.
+ * @param p
+ * @param texte
+ * @return 0 si l'étape est valide, -1 sinon
+ */
+int pipelineAjouter(struct pipeline *p, const char *texte);
+
+/**
+ * Fonction qui charge un fichier de pipeline : une étape par mot, '#' commence un commentaire
+ * @param p
+ * @param nomFichier
+ * @return 0 si le fichier est valide, -1 sinon
+ */
+int pipelineCharger(struct pipeline *p, const char *nomFichier);
+
+/**
+ * Fonction qui libère les noyaux chargés par les étapes et vide le pipeline
+ * @param p
+ */
+void pipelineLiberer(struct pipeline *p);
+
+/**
+ * Fonction qui exécute toutes les étapes en mémoire
+ * Les étapes point à point consécutives sont fusionnées en une seule table de correspondance.
+ * Les deux images servent alternativement de source et de destination ; à la fin, le
+ * résultat est dans *img. Les allocations sont conservées d'une étape à l'autre.
+ * Si le cache est actif (voir cache.h), un résultat déjà calculé pour les mêmes pixels et
+ * les mêmes étapes est repris sans rien recalculer.
+ * @param p
+ * @param img
+ * @param tampon image de travail initialisée ({0} ou déjà allouée)
+ * @return 0 si toutes les étapes ont réussi, -1 sinon
+ */
+int pipelineExecuter(const struct pipeline *p, struct imageNB *img, struct imageNB *tampon);
+
+/**
+ * Fonction qui exécute toutes les étapes et rend le masque d'un bit par pixel du résultat
+ * (les pixels au-dessus de 127, voir masqueSeuil)
+ * Si la dernière étape est un seuil (seuillage, otsu, sauvola ou adaptatif), elle écrit
+ * directement le masque, sans l'image 8 bits de son résultat. Si le cache est actif, le
+ * résultat passe par pipelineExecuter pour être mis en cache.
+ * @param p
+ * @param img image d'entrée ; elle reçoit un résultat intermédiaire
+ * @param tampon image de travail initialisée ({0} ou déjà allouée)
+ * @param m masque à libérer avec masqueLiberer
+ * @return 0 si toutes les étapes ont réussi, -1 sinon
+ */
+int pipelineExecuterMasque(const struct pipeline *p, struct imageNB *img, struct imageNB *tampon, struct masque *m);
+
+/**
+ * Fonction qui calcule le nombre de lignes de recouvrement nécessaires pour exécuter le
+ * pipeline par bandes : la somme des halos de toutes les étapes
+ * @param p
+ * @return le recouvrement, ou -1 si une étape a besoin de toute l'image
+ */
+int pipelineHalo(const struct pipeline *p);
+
+/**
+ * Fonction qui calcule le voisinage dont dépend chaque pixel du résultat, dans les deux
+ * directions : une région lue avec ces marges autour d'elle donne, une fois recadrée, le même
+ * résultat que l'image entière
+ * @param p
+ * @param margeX
+ * @param margeY
+ * @return 0 si les marges sont finies, -1 si une étape a besoin de toute l'image (ou en
+ * change la taille)
+ */
+int pipelineVoisinage(const struct pipeline *p, int *margeX, int *margeY);
+
+/**
+ * Fonction qui exécute le pipeline sur un fichier, par bandes de lignes
+ * Chaque bande est lue avec le recouvrement nécessaire au-dessus et en dessous, traitée en
+ * mémoire, puis seules ses propres lignes sont écrites : le résultat est identique à celui
+ * du traitement de l'image entière, et la mémoire utilisée ne dépend que de la taille des bandes.
+ * L'entrée peut être une image dallée ; la sortie est toujours un fichier .pgm.
+ * @param p
+ * @param entree
+ * @param sortie
+ * @param lignesParBande 0 pour une taille automatique
+ * @return 0 si le traitement a réussi, -1 sinon
+ */
+int pipelineExecuterBandes(const struct pipeline *p, const char *entree, const char *sortie, int lignesParBande);
+
+#endif
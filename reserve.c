@@ -0,0 +1,224 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "reserve.h"
+#include "trace.h"
+
+/**
+ * Plus petite classe : 2^RESERVE_LOG_MIN octets
+ */
+#define RESERVE_LOG_MIN 12
+
+/**
+ * Quatre classes par puissance de deux, jusqu'à 2^(RESERVE_LOG_MIN + RESERVE_PUISSANCES)
+ */
+#define RESERVE_PUISSANCES 40
+#define RESERVE_CLASSES (4 * RESERVE_PUISSANCES)
+
+#define RESERVE_LIMITE_DEFAUT ((size_t)256 << 20)
+
+/**
+ * En-tête placé devant chaque tampon ; il occupe RESERVE_ALIGNEMENT octets pour que le
+ * tampon reste aligné
+ */
+struct entete
+{
+    size_t capacite;
+    int classe;
+    atomic_int references;
+    struct entete *suivant;
+};
+
+_Static_assert(sizeof(struct entete) <= RESERVE_ALIGNEMENT, "en-tete trop grand");
+
+static struct
+{
+    pthread_mutex_t verrou;
+    int initialisee;
+    size_t limite;
+    size_t gardes;
+    struct entete *libres[RESERVE_CLASSES];
+} reserve = {.verrou = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * Calcule la classe d'une taille et la capacité correspondante
+ * @return l'indice de la classe, ou -1 si la taille dépasse la plus grande classe
+ */
+static int classe(size_t octets, size_t *capacite)
+{
+    if (octets < ((size_t)1 << RESERVE_LOG_MIN))
+    {
+        octets = (size_t)1 << RESERVE_LOG_MIN;
+    }
+
+    // 2^k < octets <= 2^(k+1), découpé en quatre pas de 2^(k-2)
+    int k = 63 - __builtin_clzll((unsigned long long)(octets - 1));
+    size_t base = (size_t)1 << k;
+    size_t pas = base / 4;
+    size_t q = (octets - base + pas - 1) / pas;
+    int indice = (k - (RESERVE_LOG_MIN - 1)) * 4 + (int)q - 1;
+
+    if (indice >= RESERVE_CLASSES)
+    {
+        *capacite = (octets + RESERVE_ALIGNEMENT - 1) / RESERVE_ALIGNEMENT * RESERVE_ALIGNEMENT;
+        return -1;
+    }
+    *capacite = base + q * pas;
+    return indice;
+}
+
+/**
+ * Lit la limite par défaut, le verrou étant pris
+ */
+static void initialiser(void)
+{
+    if (reserve.initialisee)
+    {
+        return;
+    }
+    reserve.limite = RESERVE_LIMITE_DEFAUT;
+    const char *env = getenv("IMAGE_POOL");
+    if (env != NULL && env[0] != '\0')
+    {
+        reserve.limite = (size_t)strtoull(env, NULL, 10) << 20;
+    }
+    reserve.initialisee = 1;
+}
+
+/**
+ * Libère des tampons, les plus grands d'abord, jusqu'à ne plus garder que `cible` octets,
+ * le verrou étant pris
+ */
+static void evincer(size_t cible)
+{
+    for (int c = RESERVE_CLASSES - 1; c >= 0 && reserve.gardes > cible; c--)
+    {
+        while (reserve.libres[c] != NULL && reserve.gardes > cible)
+        {
+            struct entete *e = reserve.libres[c];
+            reserve.libres[c] = e->suivant;
+            reserve.gardes -= e->capacite;
+            traceLiberation(e->capacite + RESERVE_ALIGNEMENT);
+            free(e);
+        }
+    }
+}
+
+void *reservePrendre(size_t octets)
+{
+    if (octets > SIZE_MAX / 2)
+    {
+        return NULL;
+    }
+    size_t capacite;
+    int c = classe(octets, &capacite);
+
+    // Un tampon de la classe voulue, ou à défaut de la suivante (au plus 25 % de plus)
+    struct entete *e = NULL;
+    if (c >= 0)
+    {
+        pthread_mutex_lock(&reserve.verrou);
+        for (int i = c; i < RESERVE_CLASSES && i <= c + 1 && e == NULL; i++)
+        {
+            if (reserve.libres[i] != NULL)
+            {
+                e = reserve.libres[i];
+                reserve.libres[i] = e->suivant;
+                reserve.gardes -= e->capacite;
+            }
+        }
+        pthread_mutex_unlock(&reserve.verrou);
+    }
+    if (e != NULL)
+    {
+        traceReutilisation();
+        atomic_store_explicit(&e->references, 1, memory_order_relaxed);
+        return (unsigned char *)e + RESERVE_ALIGNEMENT;
+    }
+
+    e = aligned_alloc(RESERVE_ALIGNEMENT, capacite + RESERVE_ALIGNEMENT);
+    if (e == NULL)
+    {
+        // La mémoire gardée en réserve est peut-être ce qui manque
+        reserveVider();
+        e = aligned_alloc(RESERVE_ALIGNEMENT, capacite + RESERVE_ALIGNEMENT);
+        if (e == NULL)
+        {
+            return NULL;
+        }
+    }
+    traceAllocation(capacite + RESERVE_ALIGNEMENT);
+    e->capacite = capacite;
+    e->classe = c;
+    atomic_init(&e->references, 1);
+    e->suivant = NULL;
+    return (unsigned char *)e + RESERVE_ALIGNEMENT;
+}
+
+void reserveRendre(void *tampon)
+{
+    if (tampon == NULL)
+    {
+        return;
+    }
+    struct entete *e = (struct entete *)((unsigned char *)tampon - RESERVE_ALIGNEMENT);
+    if (atomic_fetch_sub_explicit(&e->references, 1, memory_order_acq_rel) > 1)
+    {
+        return;
+    }
+
+    if (e->classe >= 0)
+    {
+        pthread_mutex_lock(&reserve.verrou);
+        initialiser();
+        if (reserve.gardes + e->capacite <= reserve.limite)
+        {
+            e->suivant = reserve.libres[e->classe];
+            reserve.libres[e->classe] = e;
+            reserve.gardes += e->capacite;
+            e = NULL;
+        }
+        pthread_mutex_unlock(&reserve.verrou);
+    }
+    if (e != NULL)
+    {
+        traceLiberation(e->capacite + RESERVE_ALIGNEMENT);
+        free(e);
+    }
+}
+
+void reserveRetenir(void *tampon)
+{
+    struct entete *e = (struct entete *)((unsigned char *)tampon - RESERVE_ALIGNEMENT);
+    atomic_fetch_add_explicit(&e->references, 1, memory_order_relaxed);
+}
+
+int reservePartage(const void *tampon)
+{
+    struct entete *e = (struct entete *)((unsigned char *)tampon - RESERVE_ALIGNEMENT);
+    return atomic_load_explicit(&e->references, memory_order_acquire) > 1;
+}
+
+size_t reserveCapacite(const void *tampon)
+{
+    const struct entete *e = (const struct entete *)((const unsigned char *)tampon - RESERVE_ALIGNEMENT);
+    return e->capacite;
+}
+
+void reserveLimite(size_t octets)
+{
+    pthread_mutex_lock(&reserve.verrou);
+    initialiser();
+    reserve.limite = octets;
+    evincer(octets);
+    pthread_mutex_unlock(&reserve.verrou);
+}
+
+void reserveVider(void)
+{
+    pthread_mutex_lock(&reserve.verrou);
+    evincer(0);
+    pthread_mutex_unlock(&reserve.verrou);
+}
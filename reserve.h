@@ -0,0 +1,68 @@
+#ifndef _RESERVE_H_
+#define _RESERVE_H_
+
+#include <stddef.h>
+
+/**
+ * Réserve de tampons alignés, recyclés d'une opération (et d'une image) à l'autre
+ *
+ * Les tailles sont arrondies à des classes (quatre par puissance de deux, au plus 25 % de
+ * perte) et chaque classe garde une liste des tampons rendus. Une fois les tailles d'un
+ * traitement vues une première fois, les opérations suivantes ne font plus d'allocation.
+ * Les tampons gardés en réserve ne dépassent pas une limite (256 Mo par défaut, ou la
+ * valeur en Mo de la variable d'environnement IMAGE_POOL ; 0 désactive la réserve).
+ */
+
+/**
+ * Alignement (en octets) des tampons de la réserve
+ */
+#define RESERVE_ALIGNEMENT 64
+
+/**
+ * Fonction qui prend un tampon d'au moins `octets` octets, aligné sur RESERVE_ALIGNEMENT
+ * Le contenu n'est pas initialisé.
+ * @param octets
+ * @return le tampon, ou NULL si la mémoire manque
+ */
+void *reservePrendre(size_t octets);
+
+/**
+ * Fonction qui rend un tampon à la réserve (NULL est accepté)
+ * Un tampon retenu par plusieurs propriétaires n'est recyclé qu'au dernier rendu.
+ * @param tampon pris par reservePrendre
+ */
+void reserveRendre(void *tampon);
+
+/**
+ * Fonction qui ajoute un propriétaire à un tampon ; chacun le rend avec reserveRendre
+ * @param tampon pris par reservePrendre
+ */
+void reserveRetenir(void *tampon);
+
+/**
+ * Fonction qui indique si un tampon a plusieurs propriétaires
+ * @param tampon pris par reservePrendre
+ * @return 1 si le tampon est partagé, 0 sinon
+ */
+int reservePartage(const void *tampon);
+
+/**
+ * Fonction qui renvoie la taille utilisable d'un tampon (sa classe, au moins la taille demandée)
+ * @param tampon pris par reservePrendre
+ * @return
+ */
+size_t reserveCapacite(const void *tampon);
+
+/**
+ * Fonction qui fixe le nombre maximal d'octets gardés en réserve
+ * Les tampons en trop sont libérés.
+ * @param octets
+ */
+void reserveLimite(size_t octets);
+
+/**
+ * Fonction qui libère tous les tampons gardés en réserve
+ */
+void reserveVider(void);
+
+#endif
@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "seuil.h"
+#include "operations.h"
+#include "histo.h"
+#include "integrale.h"
+#include "derives.h"
+#include "parallele.h"
+#include "reserve.h"
+
+_Static_assert((2 * SEUIL_RAYON_MAX + 1) * (2 * SEUIL_RAYON_MAX + 1) <= INTEGRALE_CARRES_AIRE_MAX,
+               "fenetre trop grande pour la table des carres");
+
+struct contexteSeuil
+{
+    const struct imageNB *img;
+    const struct integrale *somme;
+    const struct integrale *carres;
+    struct imageNB *dest;
+    struct masque *m;
+    enum methodeSeuil methode;
+    int rayon;
+    double c;     // SEUIL_MOYENNE
+    double unK;   // SEUIL_SAUVOLA : 1 - k
+    double kSurR; // SEUIL_SAUVOLA : k / R
+};
+
+int seuilOtsu(const struct imageNB *img)
+{
+    struct histo h;
+    if (img == NULL || img->color == NULL)
+    {
+        printf("Invalid parameters for seuilOtsu\n");
+        return -1;
+    }
+    if (calculerHistogramme(img, &h) != 0)
+    {
+        return -1;
+    }
+
+    double sommeTotale = 0;
+    for (int v = 0; v < HISTO_NIVEAUX; v++)
+    {
+        sommeTotale += (double)v * h.compte[v];
+    }
+
+    // Variance interclasse (à un facteur total² près) de [0, t] et ]t, 255]
+    int seuil = 127;
+    double meilleure = 0;
+    uint64_t n0 = 0;
+    double somme0 = 0;
+    for (int t = 0; t < HISTO_NIVEAUX - 1; t++)
+    {
+        n0 += h.compte[t];
+        somme0 += (double)t * h.compte[t];
+        uint64_t n1 = h.total - n0;
+        if (n0 == 0 || n1 == 0)
+        {
+            continue;
+        }
+        double ecart = somme0 / n0 - (sommeTotale - somme0) / n1;
+        double variance = (double)n0 * n1 * ecart * ecart;
+        if (variance > meilleure)
+        {
+            meilleure = variance;
+            seuil = t;
+        }
+    }
+    return seuil;
+}
+
+int seuillageOtsu(struct imageNB *img, struct imageNB *dest)
+{
+    int seuil = seuilOtsu(img);
+    if (seuil < 0)
+    {
+        return -1;
+    }
+    return seuillage(img, dest, seuil);
+}
+
+/**
+ * Décision pour un pixel p dont la fenêtre de n pixels a pour somme s et somme des carrés q
+ * Sauvola sans racine : avec a = n p - (1 - k) s et b = k s / R, p dépasse le seuil si
+ * a > b sqrt(n q - s²) / n, soit a > 0 et (a n)² > b² (n q - s²) ; b >= 0 car 0 <= k <= 1.
+ */
+static inline unsigned char decider(const struct contexteSeuil *ctx, int p, uint32_t s, uint32_t q, double n)
+{
+    if (ctx->methode == SEUIL_MOYENNE)
+    {
+        return n * (p + ctx->c) > s ? 255 : 0;
+    }
+    double a = n * p - ctx->unK * s;
+    double b = ctx->kSurR * s;
+    return a > 0 && (a * n) * (a * n) > b * b * (n * q - (double)s * s) ? 255 : 0;
+}
+
+/**
+ * Pixels [x0, x1[ de la ligne y, écrits à partir de dst[0]
+ */
+static void ligneLocale(const struct contexteSeuil *ctx, int y, int x0, int x1, unsigned char *dst)
+{
+    const struct imageNB *img = ctx->img;
+    int r = ctx->rayon, w = img->width;
+    int haut = y - r > 0 ? y - r : 0;
+    int bas = y + r + 1 < img->height ? y + r + 1 : img->height;
+    const uint32_t *sHaut = ctx->somme->somme + (size_t)haut * ctx->somme->pas;
+    const uint32_t *sBas = ctx->somme->somme + (size_t)bas * ctx->somme->pas;
+    const uint32_t *qHaut = ctx->carres->somme + (size_t)haut * ctx->carres->pas;
+    const uint32_t *qBas = ctx->carres->somme + (size_t)bas * ctx->carres->pas;
+    const unsigned char *src = imageRow(img, y);
+
+    for (int x = x0; x < x1; x++)
+    {
+        int gauche = x - r > 0 ? x - r : 0;
+        int droite = x + r + 1 < w ? x + r + 1 : w;
+        uint32_t s = sBas[droite] - sBas[gauche] - sHaut[droite] + sHaut[gauche];
+        uint32_t q = qBas[droite] - qBas[gauche] - qHaut[droite] + qHaut[gauche];
+        dst[x - x0] = decider(ctx, src[x], s, q, (double)(droite - gauche) * (bas - haut));
+    }
+}
+
+static int tuileLocale(const struct tuile *t, void *arg)
+{
+    const struct contexteSeuil *ctx = arg;
+    if (ctx->m == NULL)
+    {
+        for (int y = t->y0; y < t->y1; y++)
+        {
+            ligneLocale(ctx, y, t->x0, t->x1, imageRow(ctx->dest, y) + t->x0);
+        }
+        return 0;
+    }
+
+    // Masque : une ligne de décisions, puis empaquetée (les tuiles commencent sur un octet)
+    unsigned char *ligne = reservePrendre((size_t)(t->x1 - t->x0));
+    if (ligne == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+    for (int y = t->y0; y < t->y1; y++)
+    {
+        ligneLocale(ctx, y, t->x0, t->x1, ligne);
+        masqueEmpaqueter(ligne, ctx->m->bits + (size_t)y * ctx->m->pas + t->x0 / 8, t->x1 - t->x0, 127);
+    }
+    reserveRendre(ligne);
+    return 0;
+}
+
+/**
+ * Vérifie les paramètres et prépare les tables des sommes de img
+ */
+static int preparer(struct contexteSeuil *ctx, struct imageNB *img, enum methodeSeuil methode, int rayon,
+                    double parametre, const char *nom)
+{
+    if (img == NULL || img->color == NULL || rayon < 1 || rayon > SEUIL_RAYON_MAX ||
+        (methode != SEUIL_MOYENNE && methode != SEUIL_SAUVOLA) ||
+        (methode == SEUIL_SAUVOLA && (parametre < 0 || parametre > 1)))
+    {
+        printf("Invalid parameters for %s\n", nom);
+        return -1;
+    }
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->img = img;
+    ctx->methode = methode;
+    ctx->rayon = rayon;
+    ctx->c = parametre;
+    ctx->unK = 1 - parametre;
+    ctx->kSurR = parametre / SAUVOLA_R;
+    ctx->somme = integraleImage(img);
+    ctx->carres = integraleCarresImage(img);
+    return ctx->somme != NULL && ctx->carres != NULL ? 0 : -1;
+}
+
+int seuillageLocal(struct imageNB *img, struct imageNB *dest, enum methodeSeuil methode, int rayon,
+                   double parametre)
+{
+    struct contexteSeuil ctx;
+    if (dest == img)
+    {
+        printf("Invalid parameters for seuillageLocal\n");
+        return -1;
+    }
+    if (preparer(&ctx, img, methode, rayon, parametre, "seuillageLocal") != 0)
+    {
+        return -1;
+    }
+    if (reallocImage(dest, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    dest->vmax = img->vmax;
+    ctx.dest = dest;
+    return executerTuiles(img->width, img->height, 0, tuileLocale, &ctx);
+}
+
+int masqueLocal(struct imageNB *img, struct masque *m, enum methodeSeuil methode, int rayon, double parametre)
+{
+    struct contexteSeuil ctx;
+    m->bits = NULL;
+    if (preparer(&ctx, img, methode, rayon, parametre, "masqueLocal") != 0 ||
+        masqueAllouer(m, img->width, img->height) != 0)
+    {
+        return -1;
+    }
+    ctx.m = m;
+    if (executerTuiles(img->width, img->height, 0, tuileLocale, &ctx) != 0)
+    {
+        masqueLiberer(m);
+        return -1;
+    }
+    return 0;
+}
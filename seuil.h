@@ -0,0 +1,81 @@
+#ifndef _SEUIL_H_
+#define _SEUIL_H_
+
+#include "image.h"
+#include "masque.h"
+
+/**
+ * Rayon maximal des seuillages locaux : la fenêtre (2 * rayon + 1)² doit tenir dans
+ * INTEGRALE_CARRES_AIRE_MAX pixels pour que la somme des carrés soit exacte
+ */
+#define SEUIL_RAYON_MAX 128
+
+/**
+ * Coefficient k de Sauvola par défaut
+ */
+#define SAUVOLA_K 0.34
+
+/**
+ * Dynamique de l'écart type (R) dans la formule de Sauvola
+ */
+#define SAUVOLA_R 128.0
+
+/**
+ * Seuillages locaux
+ *
+ * SEUIL_MOYENNE : un pixel est blanc s'il dépasse la moyenne de sa fenêtre moins c.
+ * SEUIL_SAUVOLA : un pixel est blanc s'il dépasse m (1 + k (s / R - 1)), où m et s sont la
+ * moyenne et l'écart type de sa fenêtre.
+ */
+enum methodeSeuil
+{
+    SEUIL_MOYENNE,
+    SEUIL_SAUVOLA
+};
+
+/**
+ * Fonction qui calcule le seuil d'Otsu d'une image : celui qui sépare l'histogramme en deux
+ * classes de variance interclasse maximale
+ * L'histogramme est compté en parallèle (calculerHistogramme), puis les 256 seuils possibles
+ * sont essayés en une passe sur les sommes cumulées.
+ * @param img
+ * @return le seuil (les pixels qui le dépassent forment la classe claire), ou -1 en cas d'erreur
+ */
+int seuilOtsu(const struct imageNB *img);
+
+/**
+ * Fonction qui seuille une image au seuil d'Otsu (voir seuillage)
+ * @param img
+ * @param dest image de sortie initialisée, éventuellement img
+ * @return 0 si le seuillage a réussi, -1 sinon
+ */
+int seuillageOtsu(struct imageNB *img, struct imageNB *dest);
+
+/**
+ * Fonction qui seuille chaque pixel selon la fenêtre (2 * rayon + 1)² qui l'entoure
+ * La moyenne et la variance de chaque fenêtre se lisent dans les tables des sommes et des
+ * sommes des carrés de img (calculées à la première demande et gardées avec l'image) : le
+ * coût par pixel ne dépend pas du rayon. Près des bords, la fenêtre est réduite à sa partie
+ * dans l'image. Le calcul est réparti en tuiles sur tous les threads.
+ * @param img
+ * @param dest image de sortie initialisée, différente de img : 255 ou 0
+ * @param methode
+ * @param rayon entre 1 et SEUIL_RAYON_MAX
+ * @param parametre c pour SEUIL_MOYENNE, k pour SEUIL_SAUVOLA
+ * @return 0 si le seuillage a réussi, -1 sinon
+ */
+int seuillageLocal(struct imageNB *img, struct imageNB *dest, enum methodeSeuil methode, int rayon,
+                   double parametre);
+
+/**
+ * Fonction qui calcule le même seuillage que seuillageLocal dans un masque d'un bit par pixel
+ * @param img
+ * @param m masque à libérer avec masqueLiberer
+ * @param methode
+ * @param rayon entre 1 et SEUIL_RAYON_MAX
+ * @param parametre
+ * @return 0 si le seuillage a réussi, -1 sinon
+ */
+int masqueLocal(struct imageNB *img, struct masque *m, enum methodeSeuil methode, int rayon, double parametre);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+/*
+ * Détection des jeux d'instructions. Les noyaux AVX2 sont compilés avec l'attribut
+ * CIBLE_AVX2 (sans option -mavx2 globale) et choisis à l'exécution avec cpuAVX2(),
+ * le binaire reste donc utilisable sur les machines qui n'ont que SSE2.
+ */
+#if defined(__GNUC__) && defined(__SSE2__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#define CIBLE_AVX2 __attribute__((target("avx2")))
+
+static inline int cpuAVX2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+#else
+static inline int cpuAVX2(void)
+{
+    return 0;
+}
+#endif
+
+#endif
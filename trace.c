@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "trace.h"
+
+#define TRACE_NOM 32
+
+int traceActive = 0;
+
+/**
+ * Un événement : une zone terminée ('X') ou un relevé de la mémoire des tampons ('C')
+ */
+struct evenement
+{
+    char type;
+    char nom[TRACE_NOM];
+    int thread;
+    double debut;
+    double duree;
+    size_t lus;
+    size_t ecrits;
+};
+
+static struct
+{
+    pthread_mutex_t verrou;
+    char *destination;
+    double origine;
+
+    struct evenement *evenements;
+    size_t nb;
+    size_t capacite;
+
+    size_t lus;
+    size_t ecrits;
+    size_t allocations;
+    size_t liberations;
+    size_t reutilisations;
+    size_t memoire;
+    size_t pic;
+} trace = {.verrou = PTHREAD_MUTEX_INITIALIZER};
+
+static atomic_int prochainThread = 0;
+static __thread int numeroThread = -1;
+
+static double maintenant(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int threadCourant(void)
+{
+    if (numeroThread < 0)
+    {
+        numeroThread = atomic_fetch_add(&prochainThread, 1);
+    }
+    return numeroThread;
+}
+
+/**
+ * Ajoute un événement, le verrou étant pris
+ */
+static void ajouter(const struct evenement *e)
+{
+    if (trace.nb == trace.capacite)
+    {
+        size_t capacite = trace.capacite ? 2 * trace.capacite : 1024;
+        struct evenement *nouveaux = realloc(trace.evenements, capacite * sizeof(*nouveaux));
+        if (nouveaux == NULL)
+        {
+            return;
+        }
+        trace.evenements = nouveaux;
+        trace.capacite = capacite;
+    }
+    trace.evenements[trace.nb++] = *e;
+}
+
+int traceInit(const char *destination)
+{
+    static int enregistre = 0;
+    if (destination == NULL)
+    {
+        destination = getenv("IMAGE_TRACE");
+    }
+    if (destination == NULL || destination[0] == '\0')
+    {
+        return 0;
+    }
+
+    pthread_mutex_lock(&trace.verrou);
+    free(trace.destination);
+    trace.destination = strdup(destination);
+    if (trace.nb == 0)
+    {
+        trace.origine = maintenant();
+    }
+    pthread_mutex_unlock(&trace.verrou);
+    if (trace.destination == NULL)
+    {
+        printf("ERROR allocating memory\n");
+        return -1;
+    }
+
+    if (!enregistre)
+    {
+        atexit(traceTerminer);
+        enregistre = 1;
+    }
+    traceActive = 1;
+    return 0;
+}
+
+void traceOuvrirZone(struct traceZone *z, const char *nom)
+{
+    z->nom = nom;
+    pthread_mutex_lock(&trace.verrou);
+    z->lus = trace.lus;
+    z->ecrits = trace.ecrits;
+    pthread_mutex_unlock(&trace.verrou);
+    z->debut = maintenant();
+}
+
+void traceFermerZone(struct traceZone *z)
+{
+    struct evenement e;
+    double fin = maintenant();
+    e.type = 'X';
+    snprintf(e.nom, sizeof(e.nom), "%s", z->nom);
+    e.thread = threadCourant();
+    e.debut = z->debut;
+    e.duree = fin - z->debut;
+
+    pthread_mutex_lock(&trace.verrou);
+    e.lus = trace.lus - z->lus;
+    e.ecrits = trace.ecrits - z->ecrits;
+    ajouter(&e);
+    pthread_mutex_unlock(&trace.verrou);
+    z->nom = NULL;
+}
+
+void traceNoterOctets(size_t lus, size_t ecrits)
+{
+    pthread_mutex_lock(&trace.verrou);
+    trace.lus += lus;
+    trace.ecrits += ecrits;
+    pthread_mutex_unlock(&trace.verrou);
+}
+
+/**
+ * Relevé de la mémoire des tampons après une allocation ou une libération, le verrou étant pris
+ */
+static void releverMemoire(void)
+{
+    struct evenement e = {0};
+    e.type = 'C';
+    snprintf(e.nom, sizeof(e.nom), "buffer memory");
+    e.debut = maintenant();
+    e.lus = trace.memoire;
+    ajouter(&e);
+}
+
+void traceNoterAllocation(size_t octets)
+{
+    pthread_mutex_lock(&trace.verrou);
+    trace.allocations++;
+    trace.memoire += octets;
+    if (trace.memoire > trace.pic)
+    {
+        trace.pic = trace.memoire;
+    }
+    releverMemoire();
+    pthread_mutex_unlock(&trace.verrou);
+}
+
+void traceNoterLiberation(size_t octets)
+{
+    pthread_mutex_lock(&trace.verrou);
+    trace.liberations++;
+    trace.memoire = trace.memoire > octets ? trace.memoire - octets : 0;
+    releverMemoire();
+    pthread_mutex_unlock(&trace.verrou);
+}
+
+void traceNoterReutilisation(void)
+{
+    pthread_mutex_lock(&trace.verrou);
+    trace.reutilisations++;
+    pthread_mutex_unlock(&trace.verrou);
+}
+
+static void ecrireChrome(FILE *f)
+{
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < trace.nb; i++)
+    {
+        const struct evenement *e = &trace.evenements[i];
+        double ts = (e->debut - trace.origine) * 1e6;
+        if (e->type == 'X')
+        {
+            fprintf(f,
+                    "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"args\":{\"bytesRead\":%zu,\"bytesWritten\":%zu}}",
+                    e->nom, e->thread, ts, e->duree * 1e6, e->lus, e->ecrits);
+        }
+        else
+        {
+            fprintf(f, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"bytes\":%zu}}", e->nom, ts,
+                    e->lus);
+        }
+        fprintf(f, "%s\n", i + 1 < trace.nb ? "," : "");
+    }
+    fprintf(f,
+            "],\"otherData\":{\"bytesRead\":%zu,\"bytesWritten\":%zu,\"bufferAllocations\":%zu,\"bufferFrees\":%zu,"
+            "\"bufferReuses\":%zu,\"peakBufferMemory\":%zu}}\n",
+            trace.lus, trace.ecrits, trace.allocations, trace.liberations, trace.reutilisations, trace.pic);
+}
+
+static void ecrireResume(FILE *f)
+{
+    fprintf(f, "\n%-20s %8s %12s %12s %12s %12s %10s %10s\n", "Zone", "Calls", "Total ms", "Mean ms", "Min ms",
+            "Max ms", "Read MB", "Written MB");
+
+    // Regroupement par nom, dans l'ordre de première apparition
+    int *vu = calloc(trace.nb + 1, sizeof(int));
+    for (size_t i = 0; vu != NULL && i < trace.nb; i++)
+    {
+        const struct evenement *e = &trace.evenements[i];
+        if (e->type != 'X' || vu[i])
+        {
+            continue;
+        }
+        size_t appels = 0, lus = 0, ecrits = 0;
+        double total = 0, min = e->duree, max = e->duree;
+        for (size_t j = i; j < trace.nb; j++)
+        {
+            const struct evenement *a = &trace.evenements[j];
+            if (a->type == 'X' && strcmp(a->nom, e->nom) == 0)
+            {
+                vu[j] = 1;
+                appels++;
+                total += a->duree;
+                min = a->duree < min ? a->duree : min;
+                max = a->duree > max ? a->duree : max;
+                lus += a->lus;
+                ecrits += a->ecrits;
+            }
+        }
+        fprintf(f, "%-20s %8zu %12.3f %12.3f %12.3f %12.3f %10.2f %10.2f\n", e->nom, appels, total * 1e3,
+                total * 1e3 / appels, min * 1e3, max * 1e3, lus / 1048576.0, ecrits / 1048576.0);
+    }
+    free(vu);
+
+    fprintf(f, "\nBytes read: %.2f MB, written: %.2f MB\n", trace.lus / 1048576.0, trace.ecrits / 1048576.0);
+    fprintf(f, "Buffer allocations: %zu, frees: %zu, reused: %zu, peak buffer memory: %.2f MB\n",
+            trace.allocations, trace.liberations, trace.reutilisations, trace.pic / 1048576.0);
+}
+
+void traceTerminer(void)
+{
+    if (!traceActive)
+    {
+        return;
+    }
+    traceActive = 0;
+
+    pthread_mutex_lock(&trace.verrou);
+    if (strcmp(trace.destination, "-") == 0)
+    {
+        ecrireResume(stdout);
+    }
+    else
+    {
+        FILE *f = fopen(trace.destination, "w");
+        if (f == NULL)
+        {
+            printf("Unable to create file: %s \n", trace.destination);
+        }
+        else
+        {
+            ecrireChrome(f);
+            fclose(f);
+        }
+    }
+
+    free(trace.evenements);
+    free(trace.destination);
+    trace.evenements = NULL;
+    trace.destination = NULL;
+    trace.nb = 0;
+    trace.capacite = 0;
+    pthread_mutex_unlock(&trace.verrou);
+}
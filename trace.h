@@ -0,0 +1,125 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <stddef.h>
+
+/**
+ * Instrumentation : zones chronométrées, octets lus et écrits, allocations de tampons (et
+ * réutilisations par la réserve) et pic de mémoire. Elle est activée par la variable
+ * d'environnement IMAGE_TRACE ou par traceInit :
+ *  - "-" affiche un tableau récapitulatif à la fin du programme ;
+ *  - tout autre texte est le nom d'un fichier JSON au format Chrome trace (chrome://tracing,
+ *    Perfetto), écrit à la fin du programme.
+ * Désactivée, chaque point de mesure ne coûte qu'un test.
+ */
+extern int traceActive;
+
+/**
+ * Zone chronométrée, ouverte par traceOuvrir et fermée par traceFermer
+ */
+struct traceZone
+{
+    const char *nom;
+    double debut;
+    size_t lus;
+    size_t ecrits;
+};
+
+/**
+ * Fonction qui active l'instrumentation
+ * @param destination "-", un nom de fichier JSON, ou NULL pour lire IMAGE_TRACE
+ * @return 0 si l'instrumentation est prête (ou reste désactivée), -1 sinon
+ */
+int traceInit(const char *destination);
+
+/**
+ * Fonction qui écrit le résultat de l'instrumentation et la désactive
+ * Appelée automatiquement à la sortie du programme.
+ */
+void traceTerminer(void);
+
+/*
+ * Implémentations appelées par les fonctions inline ci-dessous quand l'instrumentation est active
+ */
+void traceOuvrirZone(struct traceZone *z, const char *nom);
+void traceFermerZone(struct traceZone *z);
+void traceNoterOctets(size_t lus, size_t ecrits);
+void traceNoterAllocation(size_t octets);
+void traceNoterLiberation(size_t octets);
+void traceNoterReutilisation(void);
+
+/**
+ * Fonction qui ouvre une zone chronométrée
+ * @param z
+ * @param nom chaîne constante
+ */
+static inline void traceOuvrir(struct traceZone *z, const char *nom)
+{
+    z->nom = NULL;
+    if (traceActive)
+    {
+        traceOuvrirZone(z, nom);
+    }
+}
+
+/**
+ * Fonction qui ferme une zone chronométrée
+ * @param z
+ */
+static inline void traceFermer(struct traceZone *z)
+{
+    if (z->nom != NULL)
+    {
+        traceFermerZone(z);
+    }
+}
+
+/**
+ * Fonction qui compte des octets lus ou écrits dans des fichiers
+ * @param lus
+ * @param ecrits
+ */
+static inline void traceOctets(size_t lus, size_t ecrits)
+{
+    if (traceActive)
+    {
+        traceNoterOctets(lus, ecrits);
+    }
+}
+
+/**
+ * Fonction qui compte l'allocation d'un tampon sur le tas
+ * @param octets
+ */
+static inline void traceAllocation(size_t octets)
+{
+    if (traceActive)
+    {
+        traceNoterAllocation(octets);
+    }
+}
+
+/**
+ * Fonction qui compte la libération d'un tampon
+ * @param octets
+ */
+static inline void traceLiberation(size_t octets)
+{
+    if (traceActive)
+    {
+        traceNoterLiberation(octets);
+    }
+}
+
+/**
+ * Fonction qui compte un tampon repris dans la réserve au lieu d'être alloué
+ */
+static inline void traceReutilisation(void)
+{
+    if (traceActive)
+    {
+        traceNoterReutilisation();
+    }
+}
+
+#endif
@@ -0,0 +1,48 @@
+#!/bin/sh
+# Vérifie que -r donne le résultat de l'image entière recadré, pour des rectangles qui
+# touchent chaque bord et des étapes point à point suivies de filtres de voisinage, et que
+# le repli (pipeline qui a besoin de toute l'image) traite le rectangle comme une image seule.
+# Usage : verifier_region.sh image_processing image.pgm dossier_temporaire
+
+programme=$1
+image=$2
+dossier=$3
+mkdir -p "$dossier" || exit 1
+
+largeur=$(sed -n 2p "$image" | cut -d' ' -f1)
+hauteur=$(sed -n 2p "$image" | cut -d' ' -f2)
+cote=60
+droite=$((largeur - cote))
+bas=$((hauteur - cote))
+echecs=0
+
+comparer()
+{
+    if ! cmp -s "$dossier/a.pgm" "$dossier/b.pgm"; then
+        echo "FAILED: $1"
+        echecs=$((echecs + 1))
+    fi
+}
+
+for rectangle in 0,0 $droite,0 0,$bas $droite,$bas 0,100 $droite,100 100,0 100,$bas 100,100; do
+    region=$rectangle,$cote,$cote
+    for etapes in "negatif sobel" "contraste:80 nettete" "gamma:0.5 flouter:3" "luminosite:40 median:2 laplacien" \
+        "negatif eroder:3,1 seuillage:100 lisser"; do
+        # shellcheck disable=SC2086
+        "$programme" -q -i "$image" -o "$dossier/a.pgm" $etapes "recadrer:$region"
+        # shellcheck disable=SC2086
+        "$programme" -q -i "$image" -o "$dossier/b.pgm" -r "$region" $etapes
+        comparer "-r $region $etapes"
+    done
+
+    # Repli : le rectangle seul, comme un fichier à part
+    "$programme" -q -i "$image" -o "$dossier/seul.pgm" "recadrer:$region"
+    "$programme" -q -i "$dossier/seul.pgm" -o "$dossier/a.pgm" negatif sobel retourner:1
+    "$programme" -q -i "$image" -o "$dossier/b.pgm" -r "$region" negatif sobel retourner:1
+    comparer "-r $region negatif sobel retourner:1"
+done
+
+if [ $echecs -ne 0 ]; then
+    exit 1
+fi
+echo "Regions: OK"